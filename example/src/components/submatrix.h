@@ -23,14 +23,16 @@ static inline char* component_submatrix(Matrix* m, bool* rows, bool* cols, size_
 		}
 	}
 
-	size_t name_len = strlen(m->name);
+	const char* name = Matrix_get_name(m);
+
+	size_t name_len = strlen(name);
 	size_t label_space = name_len * (row + 1) + (max_width + 1) * col;
 	size_t size = (max_width + 1) * col * row + 1;
 	char*  str =
 		malloc(size + label_space + (2 * (row * col + 2)) * sizeof("\x1b[100m\x1b[49m") + 1);
 	char* ptr = str;
 
-	ptr += sprintf(ptr, "%s ", m->name);
+	ptr += sprintf(ptr, "%s ", name);
 	ptr += sprintf(ptr, "\x1b[90m");
 
 	for (uint32_t i = 1; i <= col; ++i) {
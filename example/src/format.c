@@ -17,14 +17,16 @@ char* Matrix_to_string(Matrix* m, int32_t hightlight_row, int32_t hightlight_col
 		}
 	}
 
-	size_t name_len = strlen(m->name);
+	const char* name = Matrix_get_name(m);
+
+	size_t name_len = strlen(name);
 	size_t label_space = name_len * (row + 1) + (max_width + 1) * col;
 	size_t size = (max_width + 1) * col * row + 1;
 	char*  str =
 		malloc(size + label_space + (2 * (row + col + 2)) * sizeof("\x1b[100m\x1b[49m") + 1);
 	char* ptr = str;
 
-	ptr += sprintf(ptr, "%s ", m->name);
+	ptr += sprintf(ptr, "%s ", name);
 	ptr += sprintf(ptr, "\x1b[90m");
 	for (uint32_t i = 1; i <= col; ++i) {
 		if ((int32_t)i == hightlight_col + 1) {
@@ -9,8 +9,9 @@ void matrices_init() {
 void matrices_free() { free(matrices.matrices); }
 
 bool matrices_add(Matrix* m) {
+	const char* name = Matrix_get_name(m);
 	for (u32 i = 0; i < matrices.size; ++i) {
-		if (strcmp(matrices.matrices[i]->name, m->name) == 0) {
+		if (strcmp(matrices.matrices[i]->name, name) == 0) {
 			return false;
 		}
 	}
@@ -5,6 +5,43 @@ char* ERR_NEED_2 = "\x1b[101m At least two matrices must be created. \x1b[m\n";
 char* ERR_SAME_SHAPE = "\x1b[101m Matrices must have the same shape. \x1b[m\n";
 char* ERR_NOT_MULTIPLYABLE = "\x1b[101m Matrices must be multiplyable. \x1b[m\n";
 
+static volatile sig_atomic_t interrupted = 0;
+static struct sigaction		 previous_interrupt;
+
+static void interrupt_running(int signal) {
+	(void)signal;
+	interrupted = 1;
+}
+
+static void show_progress(void* user, uint64_t done, uint64_t total) {
+	(void)user;
+	fprintf(stderr, "\r    %3" PRIu64 "%% (Ctrl-C to cancel)", total ? done * 100 / total : 100);
+}
+
+// Ctrl-C cancels the running operation instead of quitting while it runs
+static MatrixContext* begin_cancellable() {
+	MatrixContext* ctx = matrix_context_new();
+	matrix_context_on_progress(ctx, show_progress, NULL);
+	interrupted = 0;
+	matrix_context_cancel_on(ctx, &interrupted);
+	struct sigaction interrupt = {0};
+	interrupt.sa_handler = interrupt_running;
+	sigemptyset(&interrupt.sa_mask);
+	sigaction(SIGINT, &interrupt, &previous_interrupt);
+	return ctx;
+}
+
+static Matrix* end_cancellable(MatrixContext* ctx, Result result) {
+	sigaction(SIGINT, &previous_interrupt, NULL);
+	matrix_context_free(ctx);
+	fprintf(stderr, "\r\x1b[K");
+	if (is_err(result)) {
+		fprintf(stderr, "\x1b[101m Operation stopped: %s. \x1b[m\n", result.err);
+		return NULL;
+	}
+	return result.val;
+}
+
 void op_list() {
 	if (matrices.size == 0) {
 		fprintf(stderr, "%s", ERR_NO_MATRIX);
@@ -300,7 +337,11 @@ void op_multiply() {
 		return;
 	}
 
-	Matrix* p = Matrix_multiply(m1, m2);
+	MatrixContext* ctx = begin_cancellable();
+	Matrix*		   p = end_cancellable(ctx, Matrix_multiply_ctx(m1, m2, ctx));
+	if (p == NULL) {
+		return;
+	}
 	if (matrices_add(p) == false) {
 		fprintf(stderr, "Failed to create matrix, duplicate name.\n");
 		Matrix_free(p);
@@ -369,7 +410,11 @@ void op_exp() {
 		}
 	}
 
-	Matrix* result = Matrix_exp(m, exp);
+	MatrixContext* ctx = begin_cancellable();
+	Matrix*		   result = end_cancellable(ctx, Matrix_exp_ctx(m, exp, ctx));
+	if (result == NULL) {
+		return;
+	}
 	if (matrices_add(result) == false) {
 		fprintf(stderr, "Failed to create matrix, duplicate name.\n");
 		Matrix_free(result);
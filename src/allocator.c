@@ -0,0 +1,157 @@
+#include "allocator.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ArenaBlock {
+	struct ArenaBlock* next;
+	u64				   capacity;
+	u64				   used;
+	max_align_t		   data[];
+} ArenaBlock;
+
+typedef union {
+	u64			bytes;
+	max_align_t align;
+} ArenaHeader;
+
+struct MatrixArena {
+	MatrixAllocator allocator;
+	ArenaBlock*		head;
+	u64				block;
+	u64				used;
+};
+
+static void* system_alloc(void* ctx, u64 bytes) {
+	(void)ctx;
+	return malloc(bytes ? bytes : 1);
+}
+
+static void* system_resize(void* ctx, void* ptr, u64 bytes) {
+	(void)ctx;
+	return realloc(ptr, bytes ? bytes : 1);
+}
+
+static void system_release(void* ctx, void* ptr) {
+	(void)ctx;
+	free(ptr);
+}
+
+const MatrixAllocator matrix_allocator_system = {system_alloc, system_resize, system_release, NULL};
+
+static const MatrixAllocator* process_allocator = &matrix_allocator_system;
+static _Thread_local const MatrixAllocator* thread_allocator;
+static _Thread_local MatrixArena*			thread_arena;
+
+const MatrixAllocator* matrix_allocator_get() { return process_allocator; }
+
+void matrix_allocator_set(const MatrixAllocator* allocator) {
+	process_allocator = allocator ? allocator : &matrix_allocator_system;
+}
+
+const MatrixAllocator* matrix_allocator_push(const MatrixAllocator* allocator) {
+	const MatrixAllocator* previous = thread_allocator;
+	thread_allocator = allocator;
+	return previous;
+}
+
+void matrix_allocator_pop(const MatrixAllocator* previous) { thread_allocator = previous; }
+
+const MatrixAllocator* matrix_allocator_resolve(const MatrixAllocator* type) {
+	if (thread_allocator) {
+		return thread_allocator;
+	}
+	return type ? type : process_allocator;
+}
+
+void* matrix_alloc(const MatrixAllocator* allocator, u64 bytes) {
+	return allocator->alloc(allocator->ctx, bytes);
+}
+
+void* matrix_resize(const MatrixAllocator* allocator, void* ptr, u64 bytes) {
+	return allocator->resize(allocator->ctx, ptr, bytes);
+}
+
+void matrix_release(const MatrixAllocator* allocator, void* ptr) {
+	if (ptr) {
+		allocator->release(allocator->ctx, ptr);
+	}
+}
+
+static void* arena_alloc(void* ctx, u64 bytes) {
+	MatrixArena* arena = ctx;
+	u64			 size = sizeof(ArenaHeader) + (bytes + sizeof(max_align_t) - 1) /
+											  sizeof(max_align_t) * sizeof(max_align_t);
+	ArenaBlock*	 block = arena->head;
+	if (block == NULL || block->capacity - block->used < size) {
+		u64 capacity = size > arena->block ? size : arena->block;
+		block = malloc(sizeof(ArenaBlock) + capacity);
+		block->next = arena->head;
+		block->capacity = capacity;
+		block->used = 0;
+		arena->head = block;
+	}
+	ArenaHeader* header = (ArenaHeader*)((char*)block->data + block->used);
+	header->bytes = bytes;
+	block->used += size;
+	arena->used += size;
+	return header + 1;
+}
+
+static void* arena_resize(void* ctx, void* ptr, u64 bytes) {
+	void* copy = arena_alloc(ctx, bytes);
+	if (ptr) {
+		u64 old = ((ArenaHeader*)ptr - 1)->bytes;
+		memcpy(copy, ptr, old < bytes ? old : bytes);
+	}
+	return copy;
+}
+
+static void arena_release(void* ctx, void* ptr) {
+	(void)ctx;
+	(void)ptr;
+}
+
+MatrixArena* matrix_arena_new(u64 block) {
+	MatrixArena* arena = malloc(sizeof(MatrixArena));
+	arena->allocator = (MatrixAllocator){arena_alloc, arena_resize, arena_release, arena};
+	arena->head = NULL;
+	arena->block = block ? block : 1 << 16;
+	arena->used = 0;
+	return arena;
+}
+
+void matrix_arena_reset(MatrixArena* arena) {
+	ArenaBlock* block = arena->head;
+	while (block && block->next) {
+		ArenaBlock* next = block->next;
+		free(block);
+		block = next;
+	}
+	if (block) {
+		block->used = 0;
+	}
+	arena->head = block;
+	arena->used = 0;
+}
+
+void matrix_arena_free(MatrixArena* arena) {
+	matrix_arena_reset(arena);
+	free(arena->head);
+	free(arena);
+}
+
+u64 matrix_arena_used(const MatrixArena* arena) { return arena->used; }
+
+const MatrixAllocator* matrix_arena_allocator(MatrixArena* arena) { return &arena->allocator; }
+
+MatrixArena* matrix_arena_begin(MatrixArena* arena) {
+	MatrixArena* previous = thread_arena;
+	thread_arena = arena;
+	return previous;
+}
+
+void matrix_arena_end(MatrixArena* previous) { thread_arena = previous; }
+
+MatrixArena* matrix_arena_current() { return thread_arena; }
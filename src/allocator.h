@@ -0,0 +1,105 @@
+/**
+ * @file allocator.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Pluggable allocators and bump arenas for temporaries.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include "oxidation.h"
+
+/**
+ * @brief A set of allocation hooks. `resize` has the contract of `realloc` and `release` the one
+ * of `free`. `ctx` is passed to every hook, for example a jemalloc arena index or a pool.
+ */
+typedef struct MatrixAllocator {
+	void* (*alloc)(void* ctx, u64 bytes);
+	void* (*resize)(void* ctx, void* ptr, u64 bytes);
+	void (*release)(void* ctx, void* ptr);
+	void* ctx;
+} MatrixAllocator;
+
+/**
+ * @brief The allocator backed by `malloc`, `realloc` and `free`.
+ */
+extern const MatrixAllocator matrix_allocator_system;
+
+/**
+ * @brief The process-wide allocator, used by every matrix type without an allocator of its own.
+ */
+const MatrixAllocator* matrix_allocator_get();
+
+/**
+ * @brief Set the process-wide allocator, NULL restores `matrix_allocator_system`. Set it before
+ * creating matrices, since a matrix releases its struct and name through the allocator in use.
+ */
+void matrix_allocator_set(const MatrixAllocator* allocator);
+
+/**
+ * @brief Route element storage allocated by the calling thread to `allocator` until the matching
+ * `matrix_allocator_pop`, whatever the matrix type. Returns the previous override, usually NULL.
+ */
+const MatrixAllocator* matrix_allocator_push(const MatrixAllocator* allocator);
+
+/**
+ * @brief Restore the override returned by `matrix_allocator_push`.
+ */
+void matrix_allocator_pop(const MatrixAllocator* previous);
+
+/**
+ * @brief The allocator for new element storage: the calling thread's override if any, otherwise
+ * `type` if it is not NULL, otherwise the process-wide allocator.
+ */
+const MatrixAllocator* matrix_allocator_resolve(const MatrixAllocator* type);
+
+void* matrix_alloc(const MatrixAllocator* allocator, u64 bytes);
+void* matrix_resize(const MatrixAllocator* allocator, void* ptr, u64 bytes);
+void  matrix_release(const MatrixAllocator* allocator, void* ptr);
+
+/**
+ * @brief A bump allocator whose allocations are all released at once by `matrix_arena_reset`.
+ */
+typedef struct MatrixArena MatrixArena;
+
+/**
+ * @brief Create an arena that grows in blocks of at least `block` bytes.
+ */
+MatrixArena* matrix_arena_new(u64 block);
+
+/**
+ * @brief Release every allocation of `arena` at once, keeping one block for reuse.
+ */
+void matrix_arena_reset(MatrixArena* arena);
+
+void matrix_arena_free(MatrixArena* arena);
+
+/**
+ * @brief Number of bytes handed out by `arena` since it was created or reset.
+ */
+u64 matrix_arena_used(const MatrixArena* arena);
+
+/**
+ * @brief The arena as an allocator. `release` does nothing and `resize` copies into a new
+ * allocation, the memory comes back when the arena is reset.
+ */
+const MatrixAllocator* matrix_arena_allocator(MatrixArena* arena);
+
+/**
+ * @brief Take the temporaries of the calling thread, such as kernel workspaces, transposed copies
+ * and the intermediate powers of `_exp`, from `arena` until the matching `matrix_arena_end`.
+ * Results are still allocated normally. Returns the previous arena, usually NULL.
+ */
+MatrixArena* matrix_arena_begin(MatrixArena* arena);
+
+/**
+ * @brief Restore the arena returned by `matrix_arena_begin`.
+ */
+void matrix_arena_end(MatrixArena* previous);
+
+/**
+ * @brief The arena temporaries of the calling thread come from, or NULL.
+ */
+MatrixArena* matrix_arena_current();
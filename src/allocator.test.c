@@ -0,0 +1,69 @@
+#include "allocator.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fixture.test.h"
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+int main() {
+	srand(1481);
+
+	Counter			counter = {0, 0};
+	MatrixAllocator counting = counting_allocator(&counter);
+	Matrix_use_allocator(&counting);
+	Matrix* a = Matrix_from_1d((f64[]){1, 2, 0, 3}, 2, 2);
+	Matrix* b = Matrix_clone(a);
+	Matrix_rename(b, "a name too long to be stored inline");
+	Matrix_set(b, 0, 1, 5);
+	assert(counter.allocs >= 5);
+	Matrix_free(b);
+	Matrix_free(a);
+	assert(counter.allocs == counter.releases);
+	Matrix_use_allocator(NULL);
+
+	counter = (Counter){0, 0};
+	matrix_allocator_set(&counting);
+	Matrix* c = Matrix_identity(3);
+	assert(counter.allocs == 2);
+	Matrix_free(c);
+	assert(counter.releases == 2);
+	matrix_allocator_set(NULL);
+
+	u32		size = 60;
+	Matrix* m = Matrix_new(size, size);
+	for (u32 i = 0; i < 200; ++i) {
+		Matrix_set(m, rand() % size, rand() % size, (f64)(rand() % 3) / 4);
+	}
+	Matrix* expected = Matrix_exp(m, 7);
+	Matrix* product = Matrix_multiply(m, expected);
+
+	MatrixArena* arena = matrix_arena_new(0);
+	MatrixArena* previous = matrix_arena_begin(arena);
+	assert(matrix_arena_current() == arena);
+	Matrix* scoped = Matrix_exp(m, 7);
+	assert(matrix_arena_used(arena) > 0);
+	Matrix* scoped_product = Matrix_multiply_masked(m, scoped, m, false);
+	Matrix_multiply_into(scoped_product, m, scoped);
+	matrix_arena_end(previous);
+	assert(matrix_arena_current() == NULL);
+	assert(buffer_allocator(scoped->data) == &matrix_allocator_system);
+
+	matrix_arena_reset(arena);
+	assert(matrix_arena_used(arena) == 0);
+	assert(Matrix_equal(scoped, expected));
+	assert(Matrix_equal(scoped_product, product));
+	matrix_arena_free(arena);
+
+	Matrix_free(scoped_product);
+	Matrix_free(scoped);
+	Matrix_free(product);
+	Matrix_free(expected);
+	Matrix_free(m);
+
+	return EXIT_SUCCESS;
+}
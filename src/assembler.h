@@ -0,0 +1,248 @@
+/**
+ * @file assembler.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Assembling a matrix from contributions added by many threads at once.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "oxidation.h"
+#include "parallel.h"
+#include "trace.h"
+#include "utils.h"
+
+/**
+ * @brief Number of row buckets per thread `_finalize` sorts, more buckets balance skewed rows.
+ */
+#define MATRIX_ASSEMBLER_BUCKETS 4
+
+/**
+ * @brief An assembler collects `(row, col, val)` contributions in one append buffer per thread,
+ * so adding is a lock-free append as long as there are no more threads than shards. `_add`
+ * returns false, and drops the contribution, when it lies outside the matrix or its buffer cannot
+ * grow. `_finalize` sums the contributions to the same position into a regular matrix, and must
+ * not run while other threads are still adding. Its buffers come from the allocator of the type.
+ */
+#define MATRIX_ASSEMBLER_STRUCT(_name, _data_type, _index_type)                                    \
+	typedef struct _name##AssemblerShard {                                                         \
+		_name##Element* data;                                                                      \
+		u64				count;                                                                     \
+		u64				capacity;                                                                  \
+		u32				lock;                                                                      \
+		u8				pad[64 - sizeof(void*) - 2 * sizeof(u64) - sizeof(u32)];                   \
+	} _name##AssemblerShard;                                                                       \
+                                                                                                   \
+	typedef struct _name##Assembler {                                                              \
+		_index_type			   row;                                                                \
+		_index_type			   col;                                                                \
+		u32					   shards;                                                             \
+		_name##AssemblerShard* shard;                                                              \
+		void*				   block;                                                              \
+		const MatrixAllocator* allocator;                                                          \
+	} _name##Assembler;
+
+#define MATRIX_ASSEMBLER_METHOD(_name, _data_type, _index_type)                                    \
+	typedef struct _name##AssemblerPass {                                                          \
+		_name##Assembler* a;                                                                       \
+		u64				  buckets;                                                                 \
+		u64*			  offset;                                                                  \
+		_name##Element*	  sorted;                                                                  \
+		u64*			  unique;                                                                  \
+		_name##Element*	  out;                                                                     \
+	} _name##AssemblerPass;                                                                        \
+                                                                                                   \
+	/* the shards are aligned to a cache line by hand, since the allocator hooks only promise the  \
+	 * alignment of malloc */                                                                      \
+	_name##Assembler* _name##Assembler_new(_index_type row, _index_type col) {                     \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		const MatrixAllocator* allocator = _name##_allocator();                                    \
+		_name##Assembler*	   a = matrix_alloc(allocator, sizeof(_name##Assembler));              \
+		if (a == NULL) {                                                                           \
+			return NULL;                                                                           \
+		}                                                                                          \
+		a->row = row;                                                                              \
+		a->col = col;                                                                              \
+		a->shards = parallel_threads() * 2;                                                        \
+		a->allocator = allocator;                                                                  \
+		a->block = matrix_alloc(allocator, sizeof(_name##AssemblerShard) * a->shards + 63);        \
+		if (a->block == NULL) {                                                                    \
+			matrix_release(allocator, a);                                                          \
+			return NULL;                                                                           \
+		}                                                                                          \
+		a->shard = (_name##AssemblerShard*)(((uintptr_t)a->block + 63) & ~(uintptr_t)63);          \
+		memset(a->shard, 0, sizeof(_name##AssemblerShard) * a->shards);                            \
+		MATRIX_TRACE_ALLOC(sizeof(_name##Assembler));                                              \
+		MATRIX_TRACE_ALLOC(sizeof(_name##AssemblerShard) * a->shards + 63);                        \
+		return a;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##Assembler_free(_name##Assembler* a) {                                              \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		for (u32 i = 0; i < a->shards; ++i) {                                                      \
+			MATRIX_TRACE_RELEASE(sizeof(_name##Element) * a->shard[i].capacity);                   \
+			matrix_release(a->allocator, a->shard[i].data);                                        \
+		}                                                                                          \
+		MATRIX_TRACE_RELEASE(sizeof(_name##AssemblerShard) * a->shards + 63);                      \
+		MATRIX_TRACE_RELEASE(sizeof(_name##Assembler));                                            \
+		matrix_release(a->allocator, a->block);                                                    \
+		matrix_release(a->allocator, a);                                                           \
+	}                                                                                              \
+                                                                                                   \
+	bool _name##Assembler_add(_name##Assembler* a, _index_type row, _index_type col,               \
+							  _data_type val) {                                                    \
+		if (row >= a->row || col >= a->col) {                                                      \
+			return false;                                                                          \
+		}                                                                                          \
+		_name##AssemblerShard* s = &a->shard[parallel_thread_index() % a->shards];                 \
+		while (__atomic_exchange_n(&s->lock, 1, __ATOMIC_ACQUIRE)) {                               \
+			sched_yield();                                                                         \
+		}                                                                                          \
+		if (s->count == s->capacity) {                                                             \
+			u64				capacity = s->capacity ? s->capacity * 2 : 256;                        \
+			_name##Element* data =                                                                 \
+				matrix_resize(a->allocator, s->data, sizeof(_name##Element) * capacity);           \
+			if (data == NULL) {                                                                    \
+				__atomic_store_n(&s->lock, 0, __ATOMIC_RELEASE);                                   \
+				return false;                                                                      \
+			}                                                                                      \
+			MATRIX_TRACE_RESIZE(sizeof(_name##Element) * s->capacity,                              \
+								sizeof(_name##Element) * capacity);                                \
+			s->data = data;                                                                        \
+			s->capacity = capacity;                                                                \
+		}                                                                                          \
+		s->data[s->count++] = (_name##Element){row, col, val};                                     \
+		__atomic_store_n(&s->lock, 0, __ATOMIC_RELEASE);                                           \
+		return true;                                                                               \
+	}                                                                                              \
+                                                                                                   \
+	static inline u64 _name##Assembler_bucket(_name##AssemblerPass* p, _index_type row) {          \
+		return (u64)row * p->buckets / (u64)p->a->row;                                             \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##Assembler_count(void* ctx, u64 begin, u64 end) {                            \
+		_name##AssemblerPass* p = ctx;                                                             \
+		for (u64 s = begin; s < end; ++s) {                                                        \
+			u64* count = p->offset + s * p->buckets;                                               \
+			for (u64 i = 0; i < p->a->shard[s].count; ++i) {                                       \
+				++count[_name##Assembler_bucket(p, p->a->shard[s].data[i].row)];                   \
+			}                                                                                      \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##Assembler_scatter(void* ctx, u64 begin, u64 end) {                          \
+		_name##AssemblerPass* p = ctx;                                                             \
+		for (u64 s = begin; s < end; ++s) {                                                        \
+			u64* pos = p->offset + s * p->buckets;                                                 \
+			for (u64 i = 0; i < p->a->shard[s].count; ++i) {                                       \
+				_name##Element e = p->a->shard[s].data[i];                                         \
+				p->sorted[pos[_name##Assembler_bucket(p, e.row)]++] = e;                           \
+			}                                                                                      \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##Assembler_reduce(void* ctx, u64 begin, u64 end) {                           \
+		_name##AssemblerPass* p = ctx;                                                             \
+		u64					  shards = p->a->shards;                                               \
+		for (u64 b = begin; b < end; ++b) {                                                        \
+			u64				lo = b ? p->offset[shards * p->buckets + b - 1] : 0;                   \
+			u64				hi = p->offset[shards * p->buckets + b];                               \
+			_name##Element* e = p->sorted + lo;                                                    \
+			_name##Element* tmp = scratch_alloc(sizeof(_name##Element) * (hi - lo));               \
+			_name##Element* s = _name##_kernel_sort(e, hi - lo, tmp);                              \
+			u64				n = 0;                                                                 \
+			for (u64 i = 0; i < hi - lo;) {                                                        \
+				_name##Element sum = s[i++];                                                       \
+				while (i < hi - lo && s[i].row == sum.row && s[i].col == sum.col) {                \
+					sum.val += s[i++].val;                                                         \
+				}                                                                                  \
+				n = _name##_kernel_emit(e, n, sum.row, sum.col, sum.val);                          \
+			}                                                                                      \
+			scratch_free(tmp);                                                                     \
+			p->unique[b] = n;                                                                      \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##Assembler_gather(void* ctx, u64 begin, u64 end) {                           \
+		_name##AssemblerPass* p = ctx;                                                             \
+		u64					  shards = p->a->shards;                                               \
+		for (u64 b = begin; b < end; ++b) {                                                        \
+			u64 lo = b ? p->offset[shards * p->buckets + b - 1] : 0;                               \
+			u64 at = b ? p->unique[p->buckets + b - 1] : 0;                                        \
+			memcpy(p->out + at, p->sorted + lo, sizeof(_name##Element) * p->unique[b]);            \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	void _name##Assembler_finalize_into(_name* out, _name##Assembler* a) {                         \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		u64 shards = a->shards, buckets = (u64)parallel_threads() * MATRIX_ASSEMBLER_BUCKETS;      \
+		u64 total = 0;                                                                             \
+		for (u64 s = 0; s < shards; ++s) {                                                         \
+			total += a->shard[s].count;                                                            \
+		}                                                                                          \
+		if (total == 0) {                                                                          \
+			_name##_reserve(out, 0);                                                               \
+			out->data[0] = (_name##Element){a->row, a->col, 0};                                    \
+			return;                                                                                \
+		}                                                                                          \
+		buckets = buckets < (u64)a->row ? buckets : (u64)a->row;                                   \
+                                                                                                   \
+		/* offset holds the bucket counts of every shard, then the end of every bucket */          \
+		u64* offset = scratch_alloc(sizeof(u64) * (shards + 1) * buckets);                         \
+		u64* unique = scratch_alloc(sizeof(u64) * 2 * buckets);                                    \
+		_name##Element* sorted = scratch_alloc(sizeof(_name##Element) * total);                    \
+		memset(offset, 0, sizeof(u64) * shards * buckets);                                         \
+		_name##AssemblerPass p = {a, buckets, offset, sorted, unique, NULL};                       \
+		parallel_for(shards, 1, _name##Assembler_count, &p);                                       \
+		u64* end = offset + shards * buckets;                                                      \
+		u64	 pos = 0;                                                                              \
+		for (u64 b = 0; b < buckets; ++b) {                                                        \
+			for (u64 s = 0; s < shards; ++s) {                                                     \
+				u64 count = offset[s * buckets + b];                                               \
+				offset[s * buckets + b] = pos;                                                     \
+				pos += count;                                                                      \
+			}                                                                                      \
+			end[b] = pos;                                                                          \
+		}                                                                                          \
+		parallel_for(shards, 1, _name##Assembler_scatter, &p);                                     \
+		parallel_for(buckets, 1, _name##Assembler_reduce, &p);                                     \
+                                                                                                   \
+		u64 nnz = 0;                                                                               \
+		for (u64 b = 0; b < buckets; ++b) {                                                        \
+			nnz += unique[b];                                                                      \
+			unique[buckets + b] = nnz;                                                             \
+		}                                                                                          \
+		_name##_reserve(out, nnz);                                                                 \
+		p.out = out->data + 1;                                                                     \
+		parallel_for(buckets, 1, _name##Assembler_gather, &p);                                     \
+		out->data[0] = (_name##Element){a->row, a->col, nnz};                                      \
+                                                                                                   \
+		scratch_free(sorted);                                                                      \
+		scratch_free(unique);                                                                      \
+		scratch_free(offset);                                                                      \
+		for (u64 s = 0; s < shards; ++s) {                                                         \
+			a->shard[s].count = 0;                                                                 \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##Assembler_finalize(_name##Assembler* a) {                                        \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* m = _name##_new(a->row, a->col);                                                    \
+		_name##Assembler_finalize_into(m, a);                                                      \
+		return m;                                                                                  \
+	}
+
+#define MATRIX_ASSEMBLER_METHOD_DECLARE(_name, _data_type, _index_type)                            \
+	_name##Assembler* _name##Assembler_new(_index_type row, _index_type col);                      \
+	void			  _name##Assembler_free(_name##Assembler* a);                                  \
+	bool			  _name##Assembler_add(_name##Assembler* a, _index_type row, _index_type col,  \
+										   _data_type val);                                        \
+	void			  _name##Assembler_finalize_into(_name* out, _name##Assembler* a);             \
+	_name*			  _name##Assembler_finalize(_name##Assembler* a);
@@ -0,0 +1,92 @@
+#include "assembler.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fixture.test.h"
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+#define SIZE	300
+#define THREADS 8
+#define ADDS	20000
+
+static MatrixAssembler* assembler;
+
+static void* contribute(void* arg) {
+	u32 seed = *(u32*)arg;
+	for (u32 i = 0; i < ADDS; ++i) {
+		seed = seed * 1103515245 + 12345;
+		u32 row = (seed >> 8) % SIZE;
+		seed = seed * 1103515245 + 12345;
+		u32 col = (seed >> 8) % SIZE;
+		bool added = MatrixAssembler_add(assembler, row, col, 1);
+		assert(added);
+	}
+	return NULL;
+}
+
+int main() {
+	parallel_set_threads(4);
+
+	assembler = MatrixAssembler_new(3, 3);
+	MatrixAssembler_add(assembler, 2, 1, 1.5);
+	MatrixAssembler_add(assembler, 0, 0, 2.0);
+	MatrixAssembler_add(assembler, 2, 1, 2.5);
+	MatrixAssembler_add(assembler, 1, 1, 3.0);
+	MatrixAssembler_add(assembler, 1, 1, -3.0);
+	assert(!MatrixAssembler_add(assembler, 3, 0, 9.0));
+	Matrix* m = MatrixAssembler_finalize(assembler);
+	assert(Matrix_validate(m) && m->data[0].val == 2);
+	assert(Matrix_get(m, 0, 0) == 2.0 && Matrix_get(m, 2, 1) == 4.0);
+	MatrixAssembler_finalize_into(m, assembler);
+	assert(m->data[0].row == 3 && m->data[0].val == 0);
+	Matrix_free(m);
+	MatrixAssembler_free(assembler);
+
+	// the shards come from the allocator of the matrix type
+	Counter			counter = {0, 0};
+	MatrixAllocator counting = counting_allocator(&counter);
+	Matrix_use_allocator(&counting);
+	assembler = MatrixAssembler_new(SIZE, SIZE);
+	assert(counter.allocs == 2);
+	pthread_t threads[THREADS];
+	u32		  seeds[THREADS];
+	for (u32 t = 0; t < THREADS; ++t) {
+		seeds[t] = t + 1;
+		pthread_create(&threads[t], NULL, contribute, &seeds[t]);
+	}
+	for (u32 t = 0; t < THREADS; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+	Matrix* counts = MatrixAssembler_finalize(assembler);
+	assert(Matrix_validate(counts));
+
+	Matrix* expected = Matrix_new(SIZE, SIZE);
+	for (u32 t = 0; t < THREADS; ++t) {
+		u32 seed = t + 1;
+		for (u32 i = 0; i < ADDS; ++i) {
+			seed = seed * 1103515245 + 12345;
+			u32 row = (seed >> 8) % SIZE;
+			seed = seed * 1103515245 + 12345;
+			u32 col = (seed >> 8) % SIZE;
+			Matrix_set(expected, row, col, Matrix_get(expected, row, col) + 1);
+		}
+	}
+	assert(Matrix_equal(counts, expected));
+	assert(Matrix_sum(counts) == THREADS * ADDS);
+
+	Matrix_free(expected);
+	Matrix_free(counts);
+	assert(counter.allocs > 2);
+	MatrixAssembler_free(assembler);
+	assert(counting_live(&counter) == 0);
+	Matrix_use_allocator(NULL);
+	parallel_set_threads(0);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,156 @@
+#include "async.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "parallel.h"
+
+struct MatrixFuture {
+	MatrixFutureRun run;
+	void (*release)(void*);
+	void*			value;
+	bool			done;
+	u32				refs;
+	// inputs still running, plus one until the future is submitted
+	u32				pending;
+	MatrixFuture*	input[MATRIX_FUTURE_INPUTS];
+	u32				inputs;
+	MatrixFuture**	dependents;
+	u32				count;
+	u32				capacity;
+	pthread_mutex_t lock;
+	pthread_cond_t	finished;
+	u64				args[];
+};
+
+static MatrixFuture* future_alloc(u64 args) {
+	MatrixFuture* f = malloc(sizeof(MatrixFuture) + (args + sizeof(u64) - 1) / sizeof(u64) * 8);
+	f->run = NULL;
+	f->release = NULL;
+	f->value = NULL;
+	f->done = false;
+	f->refs = 1;
+	f->pending = 1;
+	f->inputs = 0;
+	f->dependents = NULL;
+	f->count = f->capacity = 0;
+	pthread_mutex_init(&f->lock, NULL);
+	pthread_cond_init(&f->finished, NULL);
+	return f;
+}
+
+MatrixFuture* matrix_future_ready(void* value) {
+	MatrixFuture* f = future_alloc(0);
+	f->value = value;
+	f->done = true;
+	f->pending = 0;
+	return f;
+}
+
+void matrix_future_retain(MatrixFuture* f) { __atomic_add_fetch(&f->refs, 1, __ATOMIC_RELAXED); }
+
+static void future_free(MatrixFuture* f) {
+	if (f->release && f->value) {
+		f->release(f->value);
+	}
+	free(f->dependents);
+	pthread_mutex_destroy(&f->lock);
+	pthread_cond_destroy(&f->finished);
+	free(f);
+}
+
+void matrix_future_release(MatrixFuture* f) {
+	if (__atomic_sub_fetch(&f->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+		future_free(f);
+	}
+}
+
+static void future_schedule(MatrixFuture* f);
+
+static void future_arrive(MatrixFuture* f) {
+	if (__atomic_sub_fetch(&f->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+		future_schedule(f);
+	}
+}
+
+static void future_execute(void* ctx, u64 begin, u64 end) {
+	(void)begin;
+	(void)end;
+	MatrixFuture* f = ctx;
+	f->run(f);
+	// the inputs are released first, so intermediates nobody else holds are freed right away
+	for (u32 i = 0; i < f->inputs; ++i) {
+		matrix_future_release(f->input[i]);
+		f->input[i] = NULL;
+	}
+
+	pthread_mutex_lock(&f->lock);
+	f->done = true;
+	MatrixFuture** dependents = f->dependents;
+	u32			   count = f->count;
+	f->dependents = NULL;
+	f->count = f->capacity = 0;
+	pthread_cond_broadcast(&f->finished);
+	pthread_mutex_unlock(&f->lock);
+	// dropped only after unlocking, since a handle released meanwhile may leave this reference
+	// as the last one, and the value then goes away here instead of in that release
+	matrix_future_release(f);
+
+	for (u32 i = 0; i < count; ++i) {
+		future_arrive(dependents[i]);
+	}
+	free(dependents);
+}
+
+static void future_schedule(MatrixFuture* f) { parallel_spawn(future_execute, f); }
+
+MatrixFuture* matrix_future_new(MatrixFutureRun run, void (*release)(void*),
+								MatrixFuture* const* inputs, u32 count, u64 args) {
+	MatrixFuture* f = future_alloc(args);
+	f->run = run;
+	f->release = release;
+	// one reference for the caller, one until the future has run
+	f->refs = 2;
+	for (u32 i = 0; i < count && i < MATRIX_FUTURE_INPUTS; ++i) {
+		MatrixFuture* input = inputs[i];
+		matrix_future_retain(input);
+		f->input[f->inputs++] = input;
+
+		pthread_mutex_lock(&input->lock);
+		if (!input->done) {
+			if (input->count == input->capacity) {
+				input->capacity = input->capacity ? input->capacity * 2 : 4;
+				input->dependents =
+					realloc(input->dependents, sizeof(MatrixFuture*) * input->capacity);
+			}
+			input->dependents[input->count++] = f;
+			__atomic_add_fetch(&f->pending, 1, __ATOMIC_RELAXED);
+		}
+		pthread_mutex_unlock(&input->lock);
+	}
+	return f;
+}
+
+void matrix_future_submit(MatrixFuture* f) { future_arrive(f); }
+
+void* matrix_future_args(MatrixFuture* f) { return f->args; }
+
+void* matrix_future_input(MatrixFuture* f, u32 i) { return f->input[i]->value; }
+
+void matrix_future_resolve(MatrixFuture* f, void* value) { f->value = value; }
+
+bool matrix_future_done(MatrixFuture* f) {
+	pthread_mutex_lock(&f->lock);
+	bool done = f->done;
+	pthread_mutex_unlock(&f->lock);
+	return done;
+}
+
+void* matrix_future_wait(MatrixFuture* f) {
+	pthread_mutex_lock(&f->lock);
+	while (!f->done) {
+		pthread_cond_wait(&f->finished, &f->lock);
+	}
+	pthread_mutex_unlock(&f->lock);
+	return f->value;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file async.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Futures for matrix operations that run on the pool once their inputs are ready.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include "oxidation.h"
+
+/**
+ * @brief Number of futures an asynchronous operation may depend on.
+ */
+#define MATRIX_FUTURE_INPUTS 2
+
+/**
+ * @brief A handle to a value that an operation produces later. The operation runs on the thread
+ * pool as soon as every future it depends on is done, so independent operations overlap. A future
+ * is reference counted: the handle returned to the caller holds one reference, and every operation
+ * that depends on it holds another until it is done. Its value is released with the last
+ * reference, so an intermediate whose handle was released is freed as soon as its consumers
+ * finish.
+ */
+typedef struct MatrixFuture MatrixFuture;
+
+typedef void (*MatrixFutureRun)(MatrixFuture* f);
+
+/**
+ * @brief A future that is already done with `value`, which it does not own.
+ */
+MatrixFuture* matrix_future_ready(void* value);
+
+/**
+ * @brief Create a future that runs `run` once the `count` futures in `inputs` are done, and owns
+ * the value it resolves to, released with `release`. `args` bytes are reserved for the arguments
+ * of `run`. The future is not scheduled before `matrix_future_submit`, so fill in the arguments
+ * first.
+ */
+MatrixFuture* matrix_future_new(MatrixFutureRun run, void (*release)(void*),
+								MatrixFuture* const* inputs, u32 count, u64 args);
+
+void matrix_future_submit(MatrixFuture* f);
+
+/**
+ * @brief The argument bytes reserved by `matrix_future_new`.
+ */
+void* matrix_future_args(MatrixFuture* f);
+
+/**
+ * @brief The value of the `i`-th input. Only valid inside `run`, where every input is done.
+ */
+void* matrix_future_input(MatrixFuture* f, u32 i);
+
+/**
+ * @brief Set the value of the future. Called by `run`.
+ */
+void matrix_future_resolve(MatrixFuture* f, void* value);
+
+/**
+ * @brief Whether the future is done, without waiting.
+ */
+bool matrix_future_done(MatrixFuture* f);
+
+/**
+ * @brief Wait until the future is done and return its value, which stays valid until the future
+ * is released. Must not be called from a task running on the thread pool.
+ */
+void* matrix_future_wait(MatrixFuture* f);
+
+void matrix_future_retain(MatrixFuture* f);
+
+/**
+ * @brief Drop a reference. The operation still runs if it is pending, and its value is released
+ * once nothing depends on it anymore.
+ */
+void matrix_future_release(MatrixFuture* f);
+
+#define MATRIX_ASYNC_METHOD(_name, _data_type, _index_type)                                        \
+	typedef struct _name##AsyncArgs {                                                              \
+		_data_type scalar;                                                                         \
+		i64		   exp;                                                                            \
+	} _name##AsyncArgs;                                                                            \
+                                                                                                   \
+	static void _name##_async_free(void* m) { _name##_free(m); }                                   \
+                                                                                                   \
+	static MatrixFuture* _name##_async_submit(MatrixFutureRun run, MatrixFuture* a,                \
+											  MatrixFuture* b, _data_type scalar, i64 exp) {       \
+		MatrixFuture* inputs[MATRIX_FUTURE_INPUTS] = {a, b};                                       \
+		u64			  args = sizeof(_name##AsyncArgs);                                             \
+		MatrixFuture* f = matrix_future_new(run, _name##_async_free, inputs, b ? 2 : 1, args);     \
+		*(_name##AsyncArgs*)matrix_future_args(f) = (_name##AsyncArgs){scalar, exp};               \
+		matrix_future_submit(f);                                                                   \
+		return f;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_async_multiply(MatrixFuture* f) {                                          \
+		matrix_future_resolve(                                                                     \
+			f, _name##_multiply(matrix_future_input(f, 0), matrix_future_input(f, 1)));            \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_async_add(MatrixFuture* f) {                                               \
+		matrix_future_resolve(f,                                                                   \
+							  _name##_add(matrix_future_input(f, 0), matrix_future_input(f, 1)));  \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_async_hadamard(MatrixFuture* f) {                                          \
+		matrix_future_resolve(                                                                     \
+			f, _name##_hadamard(matrix_future_input(f, 0), matrix_future_input(f, 1)));            \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_async_scale(MatrixFuture* f) {                                             \
+		_name##AsyncArgs* args = matrix_future_args(f);                                            \
+		matrix_future_resolve(f, _name##_scale(matrix_future_input(f, 0), args->scalar));          \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_async_transpose(MatrixFuture* f) {                                         \
+		matrix_future_resolve(f, _name##_transpose(matrix_future_input(f, 0)));                    \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_async_exp(MatrixFuture* f) {                                               \
+		_name##AsyncArgs* args = matrix_future_args(f);                                            \
+		matrix_future_resolve(f, _name##_exp(matrix_future_input(f, 0), args->exp));               \
+	}                                                                                              \
+                                                                                                   \
+	MatrixFuture* _name##_async(_name* m) { return matrix_future_ready(m); }                       \
+                                                                                                   \
+	_name* _name##_await(MatrixFuture* f) { return matrix_future_wait(f); }                        \
+                                                                                                   \
+	MatrixFuture* _name##_multiply_async(MatrixFuture* a, MatrixFuture* b) {                       \
+		return _name##_async_submit(_name##_async_multiply, a, b, 0, 0);                           \
+	}                                                                                              \
+                                                                                                   \
+	MatrixFuture* _name##_add_async(MatrixFuture* a, MatrixFuture* b) {                            \
+		return _name##_async_submit(_name##_async_add, a, b, 0, 0);                                \
+	}                                                                                              \
+                                                                                                   \
+	MatrixFuture* _name##_hadamard_async(MatrixFuture* a, MatrixFuture* b) {                       \
+		return _name##_async_submit(_name##_async_hadamard, a, b, 0, 0);                           \
+	}                                                                                              \
+                                                                                                   \
+	MatrixFuture* _name##_scale_async(MatrixFuture* a, _data_type scalar) {                        \
+		return _name##_async_submit(_name##_async_scale, a, NULL, scalar, 0);                      \
+	}                                                                                              \
+                                                                                                   \
+	MatrixFuture* _name##_transpose_async(MatrixFuture* a) {                                       \
+		return _name##_async_submit(_name##_async_transpose, a, NULL, 0, 0);                       \
+	}                                                                                              \
+                                                                                                   \
+	MatrixFuture* _name##_exp_async(MatrixFuture* a, i64 exp) {                                    \
+		return _name##_async_submit(_name##_async_exp, a, NULL, 0, exp);                           \
+	}
+
+#define MATRIX_ASYNC_METHOD_DECLARE(_name, _data_type, _index_type)                                \
+	MatrixFuture* _name##_async(_name* m);                                                         \
+	_name*		  _name##_await(MatrixFuture* f);                                                  \
+	MatrixFuture* _name##_multiply_async(MatrixFuture* a, MatrixFuture* b);                        \
+	MatrixFuture* _name##_add_async(MatrixFuture* a, MatrixFuture* b);                             \
+	MatrixFuture* _name##_hadamard_async(MatrixFuture* a, MatrixFuture* b);                        \
+	MatrixFuture* _name##_scale_async(MatrixFuture* a, _data_type scalar);                         \
+	MatrixFuture* _name##_transpose_async(MatrixFuture* a);                                        \
+	MatrixFuture* _name##_exp_async(MatrixFuture* a, i64 exp);
@@ -0,0 +1,119 @@
+#include "async.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "fixture.test.h"
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+static Counter counter = {0, 0};
+
+// the worker that ran a future may still hold it for a moment after waking the waiter
+static void settle(u64 expected) {
+	struct timespec pause = {0, 100000};
+	for (u32 i = 0; i < 10000 && counting_live(&counter) != expected; ++i) {
+		nanosleep(&pause, NULL);
+	}
+	assert(counting_live(&counter) == expected);
+}
+
+TEST_FILLED(Matrix)
+
+static void test_graph() {
+	Matrix* a = filled(40, 1);
+	Matrix* b = filled(40, 2);
+	Matrix* c = filled(40, 3);
+	Matrix* d = filled(40, 4);
+
+	Matrix* ab = Matrix_multiply(a, b);
+	Matrix* cd = Matrix_multiply(c, d);
+	Matrix* sum = Matrix_add(ab, cd);
+	Matrix* scaled = Matrix_scale(sum, 0.5);
+	Matrix* expected = Matrix_transpose(scaled);
+
+	u64			  before = counting_live(&counter);
+	MatrixFuture* fa = Matrix_async(a);
+	MatrixFuture* fb = Matrix_async(b);
+	MatrixFuture* fc = Matrix_async(c);
+	MatrixFuture* fd = Matrix_async(d);
+	assert(matrix_future_done(fa) && Matrix_await(fa) == a);
+
+	MatrixFuture* fab = Matrix_multiply_async(fa, fb);
+	MatrixFuture* fcd = Matrix_multiply_async(fc, fd);
+	MatrixFuture* fsum = Matrix_add_async(fab, fcd);
+	MatrixFuture* fscaled = Matrix_scale_async(fsum, 0.5);
+	MatrixFuture* result = Matrix_transpose_async(fscaled);
+	matrix_future_release(fab);
+	matrix_future_release(fcd);
+	matrix_future_release(fsum);
+	matrix_future_release(fscaled);
+
+	Matrix* m = Matrix_await(result);
+	assert(Matrix_equal(m, expected));
+	// only the result is left, the intermediates went away with their consumers
+	assert(counting_live(&counter) == before + 2);
+	matrix_future_release(result);
+	settle(before);
+
+	MatrixFuture* fp = Matrix_exp_async(fa, 3);
+	MatrixFuture* fh = Matrix_hadamard_async(fp, fp);
+	Matrix*		  cube = Matrix_exp(a, 3);
+	Matrix*		  square = Matrix_hadamard(cube, cube);
+	assert(Matrix_equal(Matrix_await(fh), square));
+	matrix_future_release(fh);
+	matrix_future_release(fp);
+
+	matrix_future_release(fa);
+	matrix_future_release(fb);
+	matrix_future_release(fc);
+	matrix_future_release(fd);
+	Matrix_free(square);
+	Matrix_free(cube);
+	Matrix_free(expected);
+	Matrix_free(scaled);
+	Matrix_free(sum);
+	Matrix_free(cd);
+	Matrix_free(ab);
+	Matrix_free(d);
+	Matrix_free(c);
+	Matrix_free(b);
+	Matrix_free(a);
+}
+
+static void test_chain() {
+	Matrix*		  one = Matrix_identity(16);
+	MatrixFuture* f = Matrix_async(one);
+	for (u32 i = 0; i < 200; ++i) {
+		MatrixFuture* next = Matrix_scale_async(f, 2);
+		matrix_future_release(f);
+		f = next;
+	}
+	MatrixFuture* fire = Matrix_scale_async(f, 3);
+	matrix_future_release(fire);
+	assert(Matrix_get(Matrix_await(f), 5, 5) == 1.6069380442589903e60);
+	matrix_future_release(f);
+	Matrix_free(one);
+}
+
+int main() {
+	MatrixAllocator counting = counting_allocator(&counter);
+	Matrix_use_allocator(&counting);
+
+	parallel_set_threads(4);
+	test_graph();
+	test_chain();
+	parallel_set_threads(1);
+	test_graph();
+	test_chain();
+	parallel_set_threads(0);
+	parallel_shutdown();
+
+	assert(counting_live(&counter) == 0);
+	Matrix_use_allocator(NULL);
+	return EXIT_SUCCESS;
+}
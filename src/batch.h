@@ -0,0 +1,273 @@
+/**
+ * @file batch.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Batches of same-shaped sparse matrices packed into one allocation.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include <string.h>
+
+#include "allocator.h"
+#include "oxidation.h"
+#include "parallel.h"
+#include "trace.h"
+#include "utils.h"
+
+/**
+ * @brief Number of matrices a batch kernel hands to one thread at a time.
+ */
+#define MATRIX_BATCH_GRAIN 64
+
+#define MATRIX_BATCH_STRUCT(_name, _data_type, _index_type)                                        \
+	typedef struct _name##Batch {                                                                  \
+		u64				count;                                                                     \
+		_index_type		row;                                                                       \
+		_index_type		col;                                                                       \
+		u64*			offset;                                                                    \
+		_name##Element* data;                                                                      \
+	} _name##Batch;
+
+#define MATRIX_BATCH_METHOD(_name, _data_type, _index_type)                                        \
+	typedef struct _name##BatchJob {                                                               \
+		_name##Batch* a;                                                                           \
+		_name##Batch* b;                                                                           \
+		_data_type	  scalar;                                                                      \
+		u64*		  nnz;                                                                         \
+		_name##Batch* out;                                                                         \
+	} _name##BatchJob;                                                                             \
+                                                                                                   \
+	static size_t _name##Batch_head(u64 count) {                                                   \
+		size_t align = _Alignof(_name##Element);                                                   \
+		size_t head = sizeof(_name##Batch) + sizeof(u64) * (count + 1);                            \
+		return (head + align - 1) / align * align;                                                 \
+	}                                                                                              \
+                                                                                                   \
+	_name##Batch* _name##Batch_new(u64 count, _index_type row, _index_type col, const u64* nnz) {  \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		u64 total = 0;                                                                             \
+		for (u64 k = 0; nnz && k < count; ++k) {                                                   \
+			total += nnz[k];                                                                       \
+		}                                                                                          \
+		size_t head = _name##Batch_head(count), bytes = head + sizeof(_name##Element) * total;     \
+                                                                                                   \
+		_name##Batch* b = matrix_alloc(_name##_allocator(), bytes);                                \
+		MATRIX_TRACE_ALLOC(bytes);                                                                 \
+		b->count = count;                                                                          \
+		b->row = row;                                                                              \
+		b->col = col;                                                                              \
+		b->offset = (u64*)(b + 1);                                                                 \
+		b->data = (_name##Element*)((char*)b + head);                                              \
+		b->offset[0] = 0;                                                                          \
+		for (u64 k = 0; k < count; ++k) {                                                          \
+			b->offset[k + 1] = b->offset[k] + (nnz ? nnz[k] : 0);                                  \
+		}                                                                                          \
+		return b;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##Batch_free(_name##Batch* b) {                                                      \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		MATRIX_TRACE_RELEASE(_name##Batch_head(b->count) +                                         \
+							 sizeof(_name##Element) * b->offset[b->count]);                        \
+		matrix_release(_name##_allocator(), b);                                                    \
+	}                                                                                              \
+                                                                                                   \
+	_name##Element* _name##Batch_at(_name##Batch* b, u64 k) { return b->data + b->offset[k]; }     \
+                                                                                                   \
+	u64 _name##Batch_nnz(_name##Batch* b, u64 k) { return b->offset[k + 1] - b->offset[k]; }       \
+                                                                                                   \
+	_name##Batch* _name##Batch_pack(_name** ms, u64 count) {                                       \
+		u64* nnz = scratch_alloc(sizeof(u64) * (count + 1));                                       \
+		for (u64 k = 0; k < count; ++k) {                                                          \
+			nnz[k] = ms[k]->data[0].val;                                                           \
+		}                                                                                          \
+		_name##Batch* b = _name##Batch_new(count, count ? ms[0]->data[0].row : 0,                  \
+										   count ? ms[0]->data[0].col : 0, nnz);                   \
+		scratch_free(nnz);                                                                         \
+                                                                                                   \
+		for (u64 k = 0; k < count; ++k) {                                                          \
+			memcpy(_name##Batch_at(b, k), ms[k]->data + 1,                                         \
+				   sizeof(_name##Element) * _name##Batch_nnz(b, k));                               \
+		}                                                                                          \
+		return b;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##Batch_unpack(_name##Batch* b, u64 k) {                                           \
+		_name* m = _name##_new(b->row, b->col);                                                    \
+		u64	   nnz = _name##Batch_nnz(b, k);                                                       \
+		_name##_reserve(m, nnz);                                                                   \
+		memcpy(m->data + 1, _name##Batch_at(b, k), sizeof(_name##Element) * nnz);                  \
+		m->data[0].val = nnz;                                                                      \
+		return m;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	_data_type _name##Batch_get(_name##Batch* b, u64 k, _index_type row, _index_type col) {        \
+		_name##Element* e = _name##Batch_at(b, k);                                                 \
+		u64				lower = 0, upper = _name##Batch_nnz(b, k);                                 \
+		while (lower < upper) {                                                                    \
+			u64 mid = (lower + upper) / 2;                                                         \
+			if (e[mid].row == row && e[mid].col == col) {                                          \
+				return e[mid].val;                                                                 \
+			} else if (e[mid].row < row || (e[mid].row == row && e[mid].col < col)) {              \
+				lower = mid + 1;                                                                   \
+			} else {                                                                               \
+				upper = mid;                                                                       \
+			}                                                                                      \
+		}                                                                                          \
+		return 0;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static _name##Batch* _name##Batch_run(_name##BatchJob* job, _index_type row, _index_type col,  \
+										  ParallelTask task) {                                     \
+		u64 count = job->a->count;                                                                 \
+		job->nnz = scratch_alloc(sizeof(u64) * (count + 1));                                       \
+		job->out = NULL;                                                                           \
+		parallel_for(count, MATRIX_BATCH_GRAIN, task, job);                                        \
+		job->out = _name##Batch_new(count, row, col, job->nnz);                                    \
+		parallel_for(count, MATRIX_BATCH_GRAIN, task, job);                                        \
+		scratch_free(job->nnz);                                                                    \
+		return job->out;                                                                           \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##Batch_add_task(void* ctx, u64 begin, u64 end) {                             \
+		_name##BatchJob* job = ctx;                                                                \
+		for (u64 k = begin; k < end; ++k) {                                                        \
+			u64 n = _name##_kernel_axpby(                                                          \
+				1, _name##Batch_at(job->a, k), _name##Batch_nnz(job->a, k), 1,                     \
+				_name##Batch_at(job->b, k), _name##Batch_nnz(job->b, k),                           \
+				job->out ? _name##Batch_at(job->out, k) : NULL);                                   \
+			if (!job->out) {                                                                       \
+				job->nnz[k] = n;                                                                   \
+			}                                                                                      \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	_name##Batch* _name##Batch_add(_name##Batch* a, _name##Batch* b) {                             \
+		_name##BatchJob job = {a, b, 0, NULL, NULL};                                               \
+		return _name##Batch_run(&job, a->row, a->col, _name##Batch_add_task);                      \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##Batch_scale_task(void* ctx, u64 begin, u64 end) {                           \
+		_name##BatchJob* job = ctx;                                                                \
+		for (u64 k = begin; k < end; ++k) {                                                        \
+			u64 n = _name##_kernel_scale(_name##Batch_at(job->a, k), _name##Batch_nnz(job->a, k),  \
+										 job->scalar,                                              \
+										 job->out ? _name##Batch_at(job->out, k) : NULL);          \
+			if (!job->out) {                                                                       \
+				job->nnz[k] = n;                                                                   \
+			}                                                                                      \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	_name##Batch* _name##Batch_scale(_name##Batch* m, _data_type scalar) {                         \
+		_name##BatchJob job = {m, NULL, scalar, NULL, NULL};                                       \
+		return _name##Batch_run(&job, m->row, m->col, _name##Batch_scale_task);                    \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##Batch_transpose_task(void* ctx, u64 begin, u64 end) {                       \
+		_name##BatchJob* job = ctx;                                                                \
+		u64*			 pos = scratch_alloc(sizeof(u64) * ((size_t)job->a->col + 1));             \
+		for (u64 k = begin; k < end; ++k) {                                                        \
+			_name##_kernel_transpose(_name##Batch_at(job->a, k), _name##Batch_nnz(job->a, k),      \
+									 job->a->col, pos, _name##Batch_at(job->out, k));              \
+		}                                                                                          \
+		scratch_free(pos);                                                                         \
+	}                                                                                              \
+                                                                                                   \
+	_name##Batch* _name##Batch_transpose(_name##Batch* m) {                                        \
+		_name##BatchJob job = {m, NULL, 0, NULL, NULL};                                            \
+		job.nnz = scratch_alloc(sizeof(u64) * (m->count + 1));                                     \
+		for (u64 k = 0; k < m->count; ++k) {                                                       \
+			job.nnz[k] = _name##Batch_nnz(m, k);                                                   \
+		}                                                                                          \
+		job.out = _name##Batch_new(m->count, m->col, m->row, job.nnz);                             \
+		scratch_free(job.nnz);                                                                     \
+		parallel_for(m->count, MATRIX_BATCH_GRAIN, _name##Batch_transpose_task, &job);             \
+		return job.out;                                                                            \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##Batch_multiply_task(void* ctx, u64 begin, u64 end) {                        \
+		_name##BatchJob* job = ctx;                                                                \
+		_name##Workspace w = _name##_workspace_new(job->a->col, job->b->col);                      \
+		for (u64 k = begin; k < end; ++k) {                                                        \
+			u64 n = _name##_kernel_multiply(                                                       \
+				_name##Batch_at(job->a, k), _name##Batch_nnz(job->a, k),                           \
+				_name##Batch_at(job->b, k), _name##Batch_nnz(job->b, k), job->a->col, job->b->col, \
+				&w, job->out ? _name##Batch_at(job->out, k) : NULL);                               \
+			if (!job->out) {                                                                       \
+				job->nnz[k] = n;                                                                   \
+			}                                                                                      \
+		}                                                                                          \
+		_name##_workspace_free(&w);                                                                \
+	}                                                                                              \
+                                                                                                   \
+	_name##Batch* _name##Batch_multiply(_name##Batch* a, _name##Batch* b) {                        \
+		_name##BatchJob job = {a, b, 0, NULL, NULL};                                               \
+		return _name##Batch_run(&job, a->row, b->col, _name##Batch_multiply_task);                 \
+	}                                                                                              \
+                                                                                                   \
+	_name##Batch* _name##Batch_identity(u64 count, _index_type size) {                             \
+		u64* nnz = scratch_alloc(sizeof(u64) * (count + 1));                                       \
+		for (u64 k = 0; k < count; ++k) {                                                          \
+			nnz[k] = size;                                                                         \
+		}                                                                                          \
+		_name##Batch* b = _name##Batch_new(count, size, size, nnz);                                \
+		scratch_free(nnz);                                                                         \
+		for (u64 k = 0; k < count; ++k) {                                                          \
+			_name##Element* e = _name##Batch_at(b, k);                                             \
+			for (_index_type i = 0; i < size; ++i) {                                               \
+				e[i] = (_name##Element){i, i, 1};                                                  \
+			}                                                                                      \
+		}                                                                                          \
+		return b;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	_name##Batch* _name##Batch_exp(_name##Batch* m, i64 exp) {                                     \
+		if (exp <= 0) {                                                                            \
+			return _name##Batch_identity(m->count, m->row);                                        \
+		}                                                                                          \
+                                                                                                   \
+		_name##Batch* base = m;                                                                    \
+		_name##Batch* ans = NULL;                                                                  \
+		while (exp > 0) {                                                                          \
+			if (exp % 2 == 1) {                                                                    \
+				_name##Batch* tmp =                                                                \
+					ans ? _name##Batch_multiply(ans, base) : _name##Batch_scale(base, 1);          \
+				if (ans) {                                                                         \
+					_name##Batch_free(ans);                                                        \
+				}                                                                                  \
+				ans = tmp;                                                                         \
+			}                                                                                      \
+			exp >>= 1;                                                                             \
+			if (exp > 0) {                                                                         \
+				_name##Batch* tmp = _name##Batch_multiply(base, base);                             \
+				if (base != m) {                                                                   \
+					_name##Batch_free(base);                                                       \
+				}                                                                                  \
+				base = tmp;                                                                        \
+			}                                                                                      \
+		}                                                                                          \
+                                                                                                   \
+		if (base != m) {                                                                           \
+			_name##Batch_free(base);                                                               \
+		}                                                                                          \
+		return ans;                                                                                \
+	}
+
+#define MATRIX_BATCH_METHOD_DECLARE(_name, _data_type, _index_type)                                \
+	_name##Batch*	_name##Batch_new(u64 count, _index_type row, _index_type col, const u64* nnz); \
+	void			_name##Batch_free(_name##Batch* b);                                            \
+	_name##Element* _name##Batch_at(_name##Batch* b, u64 k);                                       \
+	u64				_name##Batch_nnz(_name##Batch* b, u64 k);                                      \
+	_name##Batch*	_name##Batch_pack(_name** ms, u64 count);                                      \
+	_name*			_name##Batch_unpack(_name##Batch* b, u64 k);                                   \
+	_data_type		_name##Batch_get(_name##Batch* b, u64 k, _index_type row, _index_type col);    \
+	_name##Batch*	_name##Batch_add(_name##Batch* a, _name##Batch* b);                            \
+	_name##Batch*	_name##Batch_scale(_name##Batch* m, _data_type scalar);                        \
+	_name##Batch*	_name##Batch_transpose(_name##Batch* m);                                       \
+	_name##Batch*	_name##Batch_multiply(_name##Batch* a, _name##Batch* b);                       \
+	_name##Batch*	_name##Batch_identity(u64 count, _index_type size);                            \
+	_name##Batch*	_name##Batch_exp(_name##Batch* m, i64 exp);
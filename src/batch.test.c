@@ -0,0 +1,113 @@
+#include "batch.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fixture.test.h"
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+int main() {
+	Matrix* ms[3] = {
+		Matrix_from_1d((f64[]){1.0, 2.0, 3.0, 4.0}, 2, 2),
+		Matrix_from_1d((f64[]){0.0, 1.0, 1.0, 0.0}, 2, 2),
+		Matrix_from_1d((f64[]){2.0, 0.0, 0.0, 0.0}, 2, 2),
+	};
+
+	MatrixBatch* batch = MatrixBatch_pack(ms, 3);
+	assert(batch->count == 3);
+	assert(batch->row == 2 && batch->col == 2);
+	assert(MatrixBatch_nnz(batch, 0) == 4);
+	assert(MatrixBatch_nnz(batch, 1) == 2);
+	assert(MatrixBatch_nnz(batch, 2) == 1);
+	assert(MatrixBatch_get(batch, 0, 1, 0) == 3.0);
+	assert(MatrixBatch_get(batch, 1, 1, 1) == 0.0);
+
+	MatrixBatch* sum = MatrixBatch_add(batch, batch);
+	assert(MatrixBatch_get(sum, 0, 1, 1) == 8.0);
+	assert(MatrixBatch_get(sum, 2, 0, 0) == 4.0);
+	assert(MatrixBatch_nnz(sum, 2) == 1);
+	MatrixBatch_free(sum);
+
+	MatrixBatch* zero = MatrixBatch_scale(batch, 0);
+	for (u64 k = 0; k < zero->count; ++k) {
+		assert(MatrixBatch_nnz(zero, k) == 0);
+	}
+	MatrixBatch_free(zero);
+
+	MatrixBatch* t = MatrixBatch_transpose(batch);
+	assert(MatrixBatch_get(t, 0, 0, 1) == 3.0);
+	assert(MatrixBatch_get(t, 0, 1, 0) == 2.0);
+	MatrixBatch_free(t);
+
+	MatrixBatch* product = MatrixBatch_multiply(batch, batch);
+	for (u64 k = 0; k < 3; ++k) {
+		Matrix* expected = Matrix_multiply(ms[k], ms[k]);
+		Matrix* actual = MatrixBatch_unpack(product, k);
+		assert(Matrix_equal(expected, actual));
+		Matrix_free(expected);
+		Matrix_free(actual);
+	}
+	MatrixBatch_free(product);
+
+	MatrixBatch* power = MatrixBatch_exp(batch, 11);
+	assert(MatrixBatch_get(power, 0, 0, 0) == 25699957.0);
+	assert(MatrixBatch_get(power, 0, 1, 1) == 81883678.0);
+	assert(MatrixBatch_get(power, 1, 0, 1) == 1.0);
+	assert(MatrixBatch_nnz(power, 1) == 2);
+	assert(MatrixBatch_get(power, 2, 0, 0) == 2048.0);
+	MatrixBatch_free(power);
+
+	MatrixBatch* id = MatrixBatch_exp(batch, 0);
+	assert(MatrixBatch_get(id, 1, 0, 0) == 1.0);
+	assert(MatrixBatch_get(id, 1, 0, 1) == 0.0);
+	MatrixBatch_free(id);
+
+	parallel_set_threads(4);
+	Matrix** many = malloc(sizeof(Matrix*) * 1000);
+	for (u64 k = 0; k < 1000; ++k) {
+		many[k] = Matrix_new(8, 8);
+		for (u32 i = 0; i < 8; ++i) {
+			Matrix_set(many[k], i, (i * 3 + k) % 8, (f64)(k % 7 + 1));
+		}
+	}
+	MatrixBatch* large = MatrixBatch_pack(many, 1000);
+	MatrixBatch* squared = MatrixBatch_multiply(large, large);
+	for (u64 k = 0; k < 1000; k += 97) {
+		Matrix* expected = Matrix_multiply(many[k], many[k]);
+		Matrix* actual = MatrixBatch_unpack(squared, k);
+		assert(Matrix_equal(expected, actual));
+		Matrix_free(expected);
+		Matrix_free(actual);
+	}
+	MatrixBatch_free(squared);
+	MatrixBatch_free(large);
+	for (u64 k = 0; k < 1000; ++k) {
+		Matrix_free(many[k]);
+	}
+	free(many);
+	parallel_set_threads(0);
+
+	MatrixBatch_free(batch);
+
+	// batches are allocated through the allocator of their matrix type
+	Counter			counter = {0, 0};
+	MatrixAllocator counting = counting_allocator(&counter);
+	Matrix_use_allocator(&counting);
+	batch = MatrixBatch_pack(ms, 3);
+	MatrixBatch* square = MatrixBatch_multiply(batch, batch);
+	assert(counter.allocs == 2 && counting_live(&counter) == 2);
+	MatrixBatch_free(square);
+	MatrixBatch_free(batch);
+	assert(counting_live(&counter) == 0);
+	Matrix_use_allocator(NULL);
+
+	for (u64 k = 0; k < 3; ++k) {
+		Matrix_free(ms[k]);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file broadcast.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Row and column broadcasting of dense vectors over sparse matrices.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include <math.h>
+
+#include "ewise.h"
+#include "oxidation.h"
+#include "parallel.h"
+#include "trace.h"
+
+/**
+ * @brief Number of elements a broadcast kernel hands to one thread at a time.
+ */
+#define MATRIX_BROADCAST_GRAIN 4096
+
+typedef enum MatrixNorm {
+	MATRIX_NORM_L1,
+	MATRIX_NORM_L2,
+	MATRIX_NORM_MAX,
+} MatrixNorm;
+
+/**
+ * @brief Generate `_name##_##_op_name`, `_name##_##_op_name##_into` and
+ * `_name##_##_op_name##_inplace`, which replace every stored value `x` with `_op(x, v[_axis])`,
+ * where `v` is a dense vector indexed by the `row` or `col` of the element.
+ */
+#define MATRIX_BROADCAST(_name, _data_type, _index_type, _op_name, _op, _axis)                     \
+	static void _name##_##_op_name##_task(void* ctx, u64 begin, u64 end) {                         \
+		_name##BroadcastJob* job = ctx;                                                            \
+		u64					 zeros = 0;                                                            \
+		for (u64 i = begin; i < end; ++i) {                                                        \
+			_name##Element e = job->src[i];                                                        \
+			e.val = _op(e.val, job->v[e._axis]);                                                   \
+			job->dst[i] = e;                                                                       \
+			zeros += e.val == 0;                                                                   \
+		}                                                                                          \
+		if (zeros) {                                                                               \
+			__atomic_fetch_add(&job->zeros, zeros, __ATOMIC_RELAXED);                              \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_##_op_name##_into(_name* out, _name* m, const _data_type* v) {                    \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_broadcast_run(out, m, v, MATRIX_NORM_L1, _name##_##_op_name##_task);               \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_##_op_name##_inplace(_name* m, const _data_type* v) {                             \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_##_op_name##_into(m, m, v);                                                        \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_##_op_name(_name* m, const _data_type* v) {                                     \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* ans = _name##_new(m->data[0].row, m->data[0].col);                                  \
+		_name##_##_op_name##_into(ans, m, v);                                                      \
+		return ans;                                                                                \
+	}
+
+#define MATRIX_BROADCAST_DECLARE(_name, _data_type, _index_type, _op_name)                         \
+	void   _name##_##_op_name##_into(_name* out, _name* m, const _data_type* v);                   \
+	void   _name##_##_op_name##_inplace(_name* m, const _data_type* v);                            \
+	_name* _name##_##_op_name(_name* m, const _data_type* v);
+
+#define MATRIX_BROADCAST_METHOD(_name, _data_type, _index_type)                                    \
+	typedef struct _name##BroadcastJob {                                                           \
+		const _name##Element* src;                                                                 \
+		_name##Element*		  dst;                                                                 \
+		u64					  count;                                                               \
+		const _data_type*	  v;                                                                   \
+		MatrixNorm			  norm;                                                                \
+		u64					  zeros;                                                               \
+	} _name##BroadcastJob;                                                                         \
+                                                                                                   \
+	static void _name##_broadcast_run(_name* out, _name* m, const _data_type* v, MatrixNorm norm,  \
+									  ParallelTask task) {                                         \
+		_name##_reserve(out, m->data[0].val);                                                      \
+		_name##BroadcastJob job = {m->data + 1, out->data + 1, m->data[0].val, v, norm, 0};        \
+		parallel_for(job.count, MATRIX_BROADCAST_GRAIN, task, &job);                               \
+                                                                                                   \
+		u64 n = job.count;                                                                         \
+		if (job.zeros) {                                                                           \
+			n = 0;                                                                                 \
+			for (u64 i = 0; i < job.count; ++i) {                                                  \
+				if (job.dst[i].val != 0) {                                                         \
+					job.dst[n++] = job.dst[i];                                                     \
+				}                                                                                  \
+			}                                                                                      \
+		}                                                                                          \
+		out->data[0] = (_name##Element){m->data[0].row, m->data[0].col, n};                        \
+	}                                                                                              \
+                                                                                                   \
+	static _data_type _name##_kernel_norm(const _name##Element* e, u64 n, MatrixNorm norm) {       \
+		_data_type ans = 0;                                                                        \
+		switch (norm) {                                                                            \
+			case MATRIX_NORM_L1:                                                                   \
+				for (u64 i = 0; i < n; ++i) {                                                      \
+					ans += e[i].val < 0 ? -e[i].val : e[i].val;                                    \
+				}                                                                                  \
+				break;                                                                             \
+			case MATRIX_NORM_L2:                                                                   \
+				for (u64 i = 0; i < n; ++i) {                                                      \
+					ans += e[i].val * e[i].val;                                                    \
+				}                                                                                  \
+				ans = sqrt(ans);                                                                   \
+				break;                                                                             \
+			case MATRIX_NORM_MAX:                                                                  \
+				for (u64 i = 0; i < n; ++i) {                                                      \
+					_data_type x = e[i].val < 0 ? -e[i].val : e[i].val;                            \
+					ans = x > ans ? x : ans;                                                       \
+				}                                                                                  \
+				break;                                                                             \
+		}                                                                                          \
+		return ans;                                                                                \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_normalize_rows_task(void* ctx, u64 begin, u64 end) {                       \
+		_name##BroadcastJob*  job = ctx;                                                           \
+		const _name##Element* src = job->src;                                                      \
+		u64					  zeros = 0;                                                           \
+		while (begin > 0 && begin < job->count && src[begin].row == src[begin - 1].row) {          \
+			++begin;                                                                               \
+		}                                                                                          \
+		while (end > 0 && end < job->count && src[end].row == src[end - 1].row) {                  \
+			++end;                                                                                 \
+		}                                                                                          \
+		for (u64 i = begin; i < end;) {                                                            \
+			u64 j = i;                                                                             \
+			while (j < end && src[j].row == src[i].row) {                                          \
+				++j;                                                                               \
+			}                                                                                      \
+			_data_type norm = _name##_kernel_norm(src + i, j - i, job->norm);                      \
+			for (; i < j; ++i) {                                                                   \
+				_name##Element e = src[i];                                                         \
+				e.val /= norm;                                                                     \
+				job->dst[i] = e;                                                                   \
+				zeros += e.val == 0;                                                               \
+			}                                                                                      \
+		}                                                                                          \
+		if (zeros) {                                                                               \
+			__atomic_fetch_add(&job->zeros, zeros, __ATOMIC_RELAXED);                              \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_normalize_rows_into(_name* out, _name* m, MatrixNorm norm) {                      \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_broadcast_run(out, m, NULL, norm, _name##_normalize_rows_task);                    \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_normalize_rows_inplace(_name* m, MatrixNorm norm) {                               \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_normalize_rows_into(m, m, norm);                                                   \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_normalize_rows(_name* m, MatrixNorm norm) {                                     \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* ans = _name##_new(m->data[0].row, m->data[0].col);                                  \
+		_name##_normalize_rows_into(ans, m, norm);                                                 \
+		return ans;                                                                                \
+	}                                                                                              \
+                                                                                                   \
+	MATRIX_BROADCAST(_name, _data_type, _index_type, scale_rows, EWISE_TIMES, row)                 \
+	MATRIX_BROADCAST(_name, _data_type, _index_type, add_rows, EWISE_PLUS, row)                    \
+	MATRIX_BROADCAST(_name, _data_type, _index_type, divide_rows, EWISE_DIVIDE, row)               \
+	MATRIX_BROADCAST(_name, _data_type, _index_type, scale_cols, EWISE_TIMES, col)                 \
+	MATRIX_BROADCAST(_name, _data_type, _index_type, add_cols, EWISE_PLUS, col)                    \
+	MATRIX_BROADCAST(_name, _data_type, _index_type, divide_cols, EWISE_DIVIDE, col)
+
+#define MATRIX_BROADCAST_METHOD_DECLARE(_name, _data_type, _index_type)                            \
+	void   _name##_normalize_rows_into(_name* out, _name* m, MatrixNorm norm);                     \
+	void   _name##_normalize_rows_inplace(_name* m, MatrixNorm norm);                              \
+	_name* _name##_normalize_rows(_name* m, MatrixNorm norm);                                      \
+	MATRIX_BROADCAST_DECLARE(_name, _data_type, _index_type, scale_rows)                           \
+	MATRIX_BROADCAST_DECLARE(_name, _data_type, _index_type, add_rows)                             \
+	MATRIX_BROADCAST_DECLARE(_name, _data_type, _index_type, divide_rows)                          \
+	MATRIX_BROADCAST_DECLARE(_name, _data_type, _index_type, scale_cols)                           \
+	MATRIX_BROADCAST_DECLARE(_name, _data_type, _index_type, add_cols)                             \
+	MATRIX_BROADCAST_DECLARE(_name, _data_type, _index_type, divide_cols)
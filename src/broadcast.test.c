@@ -0,0 +1,95 @@
+#include "broadcast.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+int main() {
+	srand(1481);
+	parallel_set_threads(4);
+
+	Matrix* m = Matrix_from_1d((f64[]){1.0, 0.0, 3.0, -4.0, 2.0, 0.0}, 2, 3);
+	f64		rows[] = {2.0, -0.5};
+	f64		cols[] = {1.0, 0.0, 4.0};
+
+	Matrix* scaled = Matrix_scale_rows(m, rows);
+	assert(scaled->data[0].val == 4);
+	assert(Matrix_get(scaled, 0, 2) == 6.0 && Matrix_get(scaled, 1, 0) == 2.0);
+	Matrix_divide_rows_into(scaled, m, rows);
+	assert(Matrix_get(scaled, 0, 0) == 0.5 && Matrix_get(scaled, 1, 1) == -4.0);
+	Matrix_add_rows_into(scaled, m, (f64[]){-1.0, 4.0});
+	assert(scaled->data[0].val == 2);
+	assert(Matrix_validate(scaled));
+	assert(Matrix_get(scaled, 0, 2) == 2.0 && Matrix_get(scaled, 1, 1) == 6.0);
+
+	Matrix_scale_cols_into(scaled, m, cols);
+	assert(scaled->data[0].val == 3);
+	assert(Matrix_get(scaled, 0, 2) == 12.0 && Matrix_get(scaled, 1, 0) == -4.0);
+	Matrix_add_cols_into(scaled, m, (f64[]){4.0, 1.0, 1.0});
+	assert(scaled->data[0].val == 3);
+	assert(Matrix_get(scaled, 1, 1) == 3.0);
+	Matrix_divide_cols_into(scaled, m, (f64[]){2.0, 2.0, 2.0});
+	assert(Matrix_get(scaled, 1, 0) == -2.0);
+	Matrix_free(scaled);
+
+	Matrix* l1 = Matrix_normalize_rows(m, MATRIX_NORM_L1);
+	assert(Matrix_get(l1, 0, 0) == 0.25 && Matrix_get(l1, 1, 1) == 2.0 / 6.0);
+	Matrix* l2 = Matrix_normalize_rows(m, MATRIX_NORM_L2);
+	assert(Matrix_get(l2, 0, 2) == 3.0 / sqrt(10.0));
+	Matrix_normalize_rows_inplace(m, MATRIX_NORM_MAX);
+	assert(Matrix_get(m, 0, 2) == 1.0 && Matrix_get(m, 1, 0) == -1.0);
+	assert(Matrix_get(m, 1, 1) == 0.5);
+	Matrix_free(l2);
+	Matrix_free(l1);
+	Matrix_free(m);
+
+	Matrix* big = Matrix_new(300, 200);
+	Matrix_reserve(big, 300 * 200);
+	u64 n = 0;
+	for (u32 i = 0; i < 300; ++i) {
+		for (u32 j = 0; j < 200; ++j) {
+			if (rand() % 3 == 0) {
+				big->data[++n] = (MatrixElement){i, j, rand() % 7 + 1};
+			}
+		}
+	}
+	big->data[0].val = n;
+
+	Matrix* stochastic = Matrix_normalize_rows(big, MATRIX_NORM_L1);
+	for (u64 i = 1; i <= n;) {
+		u64 j = i;
+		f64 sum = 0;
+		for (; j <= n && stochastic->data[j].row == stochastic->data[i].row; ++j) {
+			sum += stochastic->data[j].val;
+		}
+		assert(fabs(sum - 1.0) < 1e-12);
+		i = j;
+	}
+	Matrix_free(stochastic);
+
+	f64 weights[300];
+	for (u32 i = 0; i < 300; ++i) {
+		weights[i] = i % 5;
+	}
+	Matrix* masked = Matrix_scale_rows(big, weights);
+	assert(Matrix_validate(masked));
+	u64 kept = 0;
+	for (u64 i = 1; i <= n; ++i) {
+		kept += big->data[i].row % 5 != 0;
+	}
+	assert(masked->data[0].val == kept);
+	for (u64 i = 1; i <= kept; ++i) {
+		MatrixElement e = masked->data[i];
+		assert(e.val == Matrix_get(big, e.row, e.col) * (e.row % 5));
+	}
+	Matrix_free(masked);
+	Matrix_free(big);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+#include "buffer.h"
+
+#include <stddef.h>
+#include <string.h>
+
+typedef union {
+	struct {
+		u64					   refs;
+		const MatrixAllocator* allocator;
+	};
+	max_align_t align;
+} BufferHeader;
+
+void* buffer_alloc(const MatrixAllocator* allocator, u64 bytes) {
+	BufferHeader* header = matrix_alloc(allocator, sizeof(BufferHeader) + bytes);
+	header->refs = 1;
+	header->allocator = allocator;
+	return header + 1;
+}
+
+const MatrixAllocator* buffer_allocator(const void* data) {
+	return ((const BufferHeader*)data - 1)->allocator;
+}
+
+void buffer_retain(void* data) {
+	BufferHeader* header = (BufferHeader*)data - 1;
+	__atomic_fetch_add(&header->refs, 1, __ATOMIC_RELAXED);
+}
+
+void buffer_release(void* data) {
+	if (data == NULL) {
+		return;
+	}
+	BufferHeader* header = (BufferHeader*)data - 1;
+	if (__atomic_sub_fetch(&header->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+		matrix_release(header->allocator, header);
+	}
+}
+
+bool buffer_shared(const void* data) {
+	const BufferHeader* header = (const BufferHeader*)data - 1;
+	return __atomic_load_n(&header->refs, __ATOMIC_ACQUIRE) > 1;
+}
+
+void* buffer_resize(void* data, u64 bytes, u64 used) {
+	BufferHeader* header = (BufferHeader*)data - 1;
+	if (!buffer_shared(data)) {
+		header = matrix_resize(header->allocator, header, sizeof(BufferHeader) + bytes);
+		return header + 1;
+	}
+	void* copy = buffer_alloc(header->allocator, bytes);
+	memcpy(copy, data, used < bytes ? used : bytes);
+	buffer_release(data);
+	return copy;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file buffer.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Reference-counted storage shared by matrices until one of them writes.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include "allocator.h"
+#include "oxidation.h"
+
+/**
+ * @brief Allocate `bytes` bytes of uninitialized storage with a reference count of one from
+ * `allocator`. The buffer remembers its allocator, so it is resized and released through it.
+ */
+void* buffer_alloc(const MatrixAllocator* allocator, u64 bytes);
+
+/**
+ * @brief The allocator `data` was allocated from.
+ */
+const MatrixAllocator* buffer_allocator(const void* data);
+
+/**
+ * @brief Add a reference to `data`, so another owner can read it without copying.
+ */
+void buffer_retain(void* data);
+
+/**
+ * @brief Drop a reference to `data`, and free it when it was the last one.
+ */
+void buffer_release(void* data);
+
+/**
+ * @brief Check whether more than one owner holds `data`.
+ */
+bool buffer_shared(const void* data);
+
+/**
+ * @brief Resize `data` to `bytes` bytes and make it private to the caller. A shared buffer is
+ * copied into a new buffer from the same allocator, keeping its first `used` bytes, and the
+ * caller's reference to it is dropped.
+ */
+void* buffer_resize(void* data, u64 bytes, u64 used);
@@ -0,0 +1,25 @@
+#include "buffer.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main() {
+	char* data = buffer_alloc(&matrix_allocator_system, 8);
+	memcpy(data, "matrix", 7);
+	assert(!buffer_shared(data));
+
+	buffer_retain(data);
+	assert(buffer_shared(data));
+	char* copy = buffer_resize(data, 64, 7);
+	assert(copy != data && strcmp(copy, "matrix") == 0);
+	assert(!buffer_shared(data) && !buffer_shared(copy));
+
+	copy = buffer_resize(copy, 4096, 7);
+	assert(strcmp(copy, "matrix") == 0);
+	buffer_release(copy);
+	buffer_release(data);
+	buffer_release(NULL);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+#include "chain.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static u64 chain_order(MatrixChainPlan* plan, u64 i, u64 j, char* out) {
+	if (i == j) {
+		return sprintf(out, "%" PRIu64, i);
+	}
+	u64 k = plan->split[i * plan->count + j];
+	u64 n = sprintf(out, "(");
+	n += chain_order(plan, i, k, out + n);
+	n += sprintf(out + n, " ");
+	n += chain_order(plan, k + 1, j, out + n);
+	n += sprintf(out + n, ")");
+	return n;
+}
+
+MatrixChainPlan* matrix_chain_plan(u64 count, const f64* rows, const f64* cols, const f64* nnz,
+								   const f64* flops) {
+	MatrixChainPlan* plan = malloc(sizeof(MatrixChainPlan));
+	plan->count = count;
+	plan->split = calloc(count * count + 1, sizeof(u64));
+	plan->estimate = calloc(count * count + 1, sizeof(f64));
+	f64* cost = calloc(count * count + 1, sizeof(f64));
+
+	for (u64 i = 0; i < count; ++i) {
+		plan->estimate[i * count + i] = nnz[i];
+	}
+
+	for (u64 len = 2; len <= count; ++len) {
+		for (u64 i = 0; i + len <= count; ++i) {
+			u64 j = i + len - 1;
+			f64 best = INFINITY, density = 0;
+			for (u64 k = i; k < j; ++k) {
+				f64 lhs = nnz[k] > 0 ? plan->estimate[i * count + k] / nnz[k] : 0;
+				f64 rhs = nnz[k + 1] > 0 ? plan->estimate[(k + 1) * count + j] / nnz[k + 1] : 0;
+				f64 work = lhs * rhs * flops[k];
+				f64 total = cost[i * count + k] + cost[(k + 1) * count + j] + work;
+				if (total < best) {
+					f64 inner = cols[k];
+					f64 a = inner > 0 ? plan->estimate[i * count + k] / (rows[i] * inner) : 0;
+					f64 b = inner > 0 ? plan->estimate[(k + 1) * count + j] / (inner * cols[j]) : 0;
+					best = total;
+					density = a * b >= 1 ? 1 : -expm1(inner * log1p(-a * b));
+					plan->split[i * count + j] = k;
+				}
+			}
+
+			cost[i * count + j] = best;
+			plan->estimate[i * count + j] = rows[i] * cols[j] * density;
+		}
+	}
+
+	plan->cost = count ? cost[count - 1] : 0;
+	plan->order = malloc(count * 24 + 1);
+	plan->order[0] = '\0';
+	if (count) {
+		chain_order(plan, 0, count - 1, plan->order);
+	}
+
+	free(cost);
+	return plan;
+}
+
+void matrix_chain_plan_free(MatrixChainPlan* plan) {
+	free(plan->split);
+	free(plan->estimate);
+	free(plan->order);
+	free(plan);
+}
@@ -0,0 +1,131 @@
+/**
+ * @file chain.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Cost-based planning for chains of sparse matrix products.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include "oxidation.h"
+#include "trace.h"
+
+/**
+ * @brief The parenthesization chosen for a chain of products.
+ * `split[i * count + j]` is the index `k` such that the product of matrices i..j is computed as
+ * (i..k) * (k+1..j), and `estimate[i * count + j]` is the estimated number of nonzeros of it.
+ */
+typedef struct MatrixChainPlan {
+	u64	  count;
+	u64*  split;
+	f64*  estimate;
+	f64	  cost;
+	char* order;
+} MatrixChainPlan;
+
+/**
+ * @brief Choose the cheapest parenthesization of a chain of `count` matrices by dynamic
+ * programming over estimated flop counts.
+ *
+ * @param rows Number of rows of each matrix.
+ * @param cols Number of columns of each matrix.
+ * @param nnz Number of nonzeros of each matrix.
+ * @param flops Exact flop count of each adjacent product, `flops[k]` for matrix k times k + 1.
+ */
+MatrixChainPlan* matrix_chain_plan(u64 count, const f64* rows, const f64* cols, const f64* nnz,
+								   const f64* flops);
+
+void matrix_chain_plan_free(MatrixChainPlan* plan);
+
+#define MATRIX_CHAIN_METHOD(_name, _data_type, _index_type)                                        \
+	MatrixChainPlan* _name##_chain_plan(_name** mats, u64 count) {                                 \
+		f64* rows = malloc(sizeof(f64) * (count + 1));                                             \
+		f64* cols = malloc(sizeof(f64) * (count + 1));                                             \
+		f64* nnz = malloc(sizeof(f64) * (count + 1));                                              \
+		f64* flops = malloc(sizeof(f64) * (count + 1));                                            \
+                                                                                                   \
+		for (u64 k = 0; k < count; ++k) {                                                          \
+			rows[k] = mats[k]->data[0].row;                                                        \
+			cols[k] = mats[k]->data[0].col;                                                        \
+			nnz[k] = mats[k]->data[0].val;                                                         \
+		}                                                                                          \
+		for (u64 k = 0; k + 1 < count; ++k) {                                                      \
+			_name*		 a = mats[k];                                                              \
+			_name*		 b = mats[k + 1];                                                          \
+			_index_type* col_count = calloc((size_t)a->data[0].col + 1, sizeof(_index_type));      \
+			for (_index_type i = 1; i <= a->data[0].val; ++i) {                                    \
+				++col_count[a->data[i].col];                                                       \
+			}                                                                                      \
+			flops[k] = 0;                                                                          \
+			for (_index_type i = 1; i <= b->data[0].val; ++i) {                                    \
+				flops[k] += col_count[b->data[i].row];                                             \
+			}                                                                                      \
+			free(col_count);                                                                       \
+		}                                                                                          \
+                                                                                                   \
+		MatrixChainPlan* plan = matrix_chain_plan(count, rows, cols, nnz, flops);                  \
+		free(flops);                                                                               \
+		free(nnz);                                                                                 \
+		free(cols);                                                                                \
+		free(rows);                                                                                \
+		return plan;                                                                               \
+	}                                                                                              \
+                                                                                                   \
+	static _name* _name##_chain_run(_name** mats, MatrixChainPlan* plan, u64 i, u64 j,             \
+									bool* owned) {                                                 \
+		if (i == j) {                                                                              \
+			*owned = false;                                                                        \
+			return mats[i];                                                                        \
+		}                                                                                          \
+                                                                                                   \
+		u64	   k = plan->split[i * plan->count + j];                                               \
+		bool   lhs_owned, rhs_owned;                                                               \
+		_name* lhs = _name##_chain_run(mats, plan, i, k, &lhs_owned);                              \
+		_name* rhs = _name##_chain_run(mats, plan, k + 1, j, &rhs_owned);                          \
+                                                                                                   \
+		_name* m = _name##_new(lhs->data[0].row, rhs->data[0].col);                                \
+		/* the estimate is only a hint, capped at what the product can hold, NaN included */       \
+		f64 estimate = plan->estimate[i * plan->count + j];                                        \
+		f64 bound = (f64)lhs->data[0].val * (f64)rhs->data[0].val;                                 \
+		f64 dense = (f64)lhs->data[0].row * (f64)rhs->data[0].col;                                 \
+		bound = dense < bound ? dense : bound;                                                     \
+		_name##_reserve(m, (u64)(estimate < bound ? estimate : bound));                            \
+		_name##_multiply_into(m, lhs, rhs);                                                        \
+                                                                                                   \
+		if (lhs_owned) {                                                                           \
+			_name##_free(lhs);                                                                     \
+		}                                                                                          \
+		if (rhs_owned) {                                                                           \
+			_name##_free(rhs);                                                                     \
+		}                                                                                          \
+		*owned = true;                                                                             \
+		return m;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_multiply_planned(_name** mats, MatrixChainPlan* plan) {                         \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		if (plan->count == 0) {                                                                    \
+			return NULL;                                                                           \
+		}                                                                                          \
+		bool   owned;                                                                              \
+		_name* m = _name##_chain_run(mats, plan, 0, plan->count - 1, &owned);                      \
+		return owned ? m : _name##_clone(m);                                                       \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_multiply_chain(_name** mats, u64 count) {                                       \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		if (count == 0) {                                                                          \
+			return NULL;                                                                           \
+		}                                                                                          \
+		MatrixChainPlan* plan = _name##_chain_plan(mats, count);                                   \
+		_name*			 m = _name##_multiply_planned(mats, plan);                                 \
+		matrix_chain_plan_free(plan);                                                              \
+		return m;                                                                                  \
+	}
+
+#define MATRIX_CHAIN_METHOD_DECLARE(_name, _data_type, _index_type)                                \
+	MatrixChainPlan* _name##_chain_plan(_name** mats, u64 count);                                  \
+	_name*			 _name##_multiply_planned(_name** mats, MatrixChainPlan* plan);                \
+	_name*			 _name##_multiply_chain(_name** mats, u64 count);
@@ -0,0 +1,71 @@
+#include "chain.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+int main() {
+	Matrix* column = Matrix_new(64, 1);
+	Matrix* row = Matrix_new(1, 64);
+	for (u32 i = 0; i < 64; ++i) {
+		Matrix_set(column, i, 0, i + 1);
+		Matrix_set(row, 0, i, 64 - i);
+	}
+
+	Matrix*			 mats[] = {column, row, column};
+	MatrixChainPlan* plan = Matrix_chain_plan(mats, 3);
+	assert(strcmp(plan->order, "(0 (1 2))") == 0);
+	assert(plan->split[0 * 3 + 2] == 0);
+	assert(plan->cost < 64 * 64);
+
+	Matrix* left = Matrix_multiply(column, row);
+	Matrix* expected = Matrix_multiply(left, column);
+	Matrix* planned = Matrix_multiply_planned(mats, plan);
+	assert(Matrix_equal(planned, expected));
+	Matrix_free(planned);
+	matrix_chain_plan_free(plan);
+
+	Matrix* chained = Matrix_multiply_chain(mats, 3);
+	assert(Matrix_equal(chained, expected));
+	Matrix_free(chained);
+
+	Matrix*			 longer[] = {row, column, row, column, row};
+	MatrixChainPlan* long_plan = Matrix_chain_plan(longer, 5);
+	assert(strcmp(long_plan->order, "(((0 1) (2 3)) 4)") == 0);
+	assert(long_plan->estimate[4] == 64);
+	Matrix* long_product = Matrix_multiply_planned(longer, long_plan);
+	Matrix* step = Matrix_multiply(row, column);
+	Matrix* step2 = Matrix_multiply(step, row);
+	Matrix* step3 = Matrix_multiply(step2, column);
+	Matrix* step4 = Matrix_multiply(step3, row);
+	assert(Matrix_equal(long_product, step4));
+	matrix_chain_plan_free(long_plan);
+	Matrix_free(long_product);
+	Matrix_free(step);
+	Matrix_free(step2);
+	Matrix_free(step3);
+	Matrix_free(step4);
+
+	Matrix* single = Matrix_multiply_chain(mats, 1);
+	assert(single != column);
+	assert(Matrix_equal(single, column));
+	Matrix_free(single);
+
+	MatrixChainPlan* empty = Matrix_chain_plan(mats, 0);
+	assert(Matrix_multiply_planned(mats, empty) == NULL);
+	assert(Matrix_multiply_chain(mats, 0) == NULL);
+	matrix_chain_plan_free(empty);
+
+	Matrix_free(expected);
+	Matrix_free(left);
+	Matrix_free(column);
+	Matrix_free(row);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+#include "context.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+#define CONTEXT_RUNNING	  0
+#define CONTEXT_CANCELLED 1
+#define CONTEXT_DEADLINE  2
+
+struct MatrixContext {
+	MatrixProgress		   progress;
+	void*				   user;
+	volatile sig_atomic_t* flag;
+	u64					   deadline;
+	u32					   state;
+	u32					   depth;
+};
+
+static u64 context_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (u64)now.tv_sec * 1000000000ull + (u64)now.tv_nsec;
+}
+
+MatrixContext* matrix_context_new() {
+	MatrixContext* ctx = malloc(sizeof(MatrixContext));
+	*ctx = (MatrixContext){NULL, NULL, NULL, 0, CONTEXT_RUNNING, 0};
+	return ctx;
+}
+
+void matrix_context_free(MatrixContext* ctx) { free(ctx); }
+
+void matrix_context_on_progress(MatrixContext* ctx, MatrixProgress progress, void* user) {
+	ctx->progress = progress;
+	ctx->user = user;
+}
+
+void matrix_context_set_deadline(MatrixContext* ctx, u64 ms) {
+	u64 deadline = ms ? context_now() + ms * 1000000ull : 0;
+	__atomic_store_n(&ctx->deadline, deadline, __ATOMIC_RELAXED);
+}
+
+void matrix_context_cancel(MatrixContext* ctx) {
+	u32 running = CONTEXT_RUNNING;
+	__atomic_compare_exchange_n(&ctx->state, &running, CONTEXT_CANCELLED, false, __ATOMIC_RELAXED,
+								__ATOMIC_RELAXED);
+}
+
+void matrix_context_cancel_on(MatrixContext* ctx, volatile sig_atomic_t* flag) {
+	ctx->flag = flag;
+}
+
+void matrix_context_reset(MatrixContext* ctx) {
+	__atomic_store_n(&ctx->state, CONTEXT_RUNNING, __ATOMIC_RELAXED);
+}
+
+bool matrix_context_stopped(MatrixContext* ctx) {
+	if (__atomic_load_n(&ctx->state, __ATOMIC_RELAXED) != CONTEXT_RUNNING) {
+		return true;
+	}
+	if (ctx->flag && __atomic_load_n(ctx->flag, __ATOMIC_RELAXED)) {
+		matrix_context_cancel(ctx);
+		return true;
+	}
+	u64 deadline = __atomic_load_n(&ctx->deadline, __ATOMIC_RELAXED);
+	if (deadline && context_now() >= deadline) {
+		u32 running = CONTEXT_RUNNING;
+		__atomic_compare_exchange_n(&ctx->state, &running, CONTEXT_DEADLINE, false,
+									__ATOMIC_RELAXED, __ATOMIC_RELAXED);
+		return true;
+	}
+	return false;
+}
+
+bool matrix_context_check(MatrixContext* ctx, u64 done, u64 total) {
+	if (ctx->progress && __atomic_load_n(&ctx->depth, __ATOMIC_RELAXED) == 0) {
+		ctx->progress(ctx->user, done, total);
+	}
+	return !matrix_context_stopped(ctx);
+}
+
+void matrix_context_enter(MatrixContext* ctx) {
+	__atomic_add_fetch(&ctx->depth, 1, __ATOMIC_RELAXED);
+}
+
+void matrix_context_leave(MatrixContext* ctx) {
+	__atomic_sub_fetch(&ctx->depth, 1, __ATOMIC_RELAXED);
+}
+
+char* matrix_context_error(MatrixContext* ctx) {
+	switch (__atomic_load_n(&ctx->state, __ATOMIC_RELAXED)) {
+		case CONTEXT_CANCELLED:
+			return "operation cancelled";
+		case CONTEXT_DEADLINE:
+			return "deadline exceeded";
+		default:
+			return NULL;
+	}
+}
@@ -0,0 +1,79 @@
+/**
+ * @file context.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Progress reporting, cancellation and deadlines for long-running kernels.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include <signal.h>
+
+#include "oxidation.h"
+
+/**
+ * @brief Called with the work done so far and the total work of the outermost operation, in
+ * units of the operation. It may be called from pool threads, also concurrently.
+ */
+typedef void (*MatrixProgress)(void* user, u64 done, u64 total);
+
+/**
+ * @brief A context passed to the `_ctx` variants of long-running kernels. They check it between
+ * chunks of work and stop early once it is cancelled or its deadline passed, releasing what they
+ * computed so far.
+ */
+typedef struct MatrixContext MatrixContext;
+
+MatrixContext* matrix_context_new();
+
+void matrix_context_free(MatrixContext* ctx);
+
+void matrix_context_on_progress(MatrixContext* ctx, MatrixProgress progress, void* user);
+
+/**
+ * @brief Stop operations `ms` milliseconds from now, 0 removes the deadline.
+ */
+void matrix_context_set_deadline(MatrixContext* ctx, u64 ms);
+
+/**
+ * @brief Ask the running operation to stop. Safe to call from another thread.
+ */
+void matrix_context_cancel(MatrixContext* ctx);
+
+/**
+ * @brief Cancel once `*flag` is nonzero. A signal handler may only set a `volatile sig_atomic_t`,
+ * so this is how a signal stops an operation. NULL stops watching.
+ */
+void matrix_context_cancel_on(MatrixContext* ctx, volatile sig_atomic_t* flag);
+
+/**
+ * @brief Clear a cancellation or a passed deadline, so the context can be used again. A watched
+ * flag has to be cleared as well.
+ */
+void matrix_context_reset(MatrixContext* ctx);
+
+/**
+ * @brief Whether operations using the context should stop.
+ */
+bool matrix_context_stopped(MatrixContext* ctx);
+
+/**
+ * @brief Report progress, unless inside a nested operation, and return false if the operation
+ * should stop. Used by the kernels at chunk boundaries.
+ */
+bool matrix_context_check(MatrixContext* ctx, u64 done, u64 total);
+
+/**
+ * @brief Mark the start and the end of an operation nested in another one, whose progress is
+ * reported by the outer operation.
+ */
+void matrix_context_enter(MatrixContext* ctx);
+
+void matrix_context_leave(MatrixContext* ctx);
+
+/**
+ * @brief Why the operation stopped, NULL if it did not.
+ */
+char* matrix_context_error(MatrixContext* ctx);
@@ -0,0 +1,196 @@
+#include "context.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fixture.test.h"
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+typedef struct Progress {
+	u64 calls;
+	u64 last;
+	u64 total;
+	u64 cancel_at;
+	MatrixContext* ctx;
+} Progress;
+
+static void record(void* user, u64 done, u64 total) {
+	Progress* p = user;
+	__atomic_add_fetch(&p->calls, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&p->last, done, __ATOMIC_RELAXED);
+	__atomic_store_n(&p->total, total, __ATOMIC_RELAXED);
+	if (p->cancel_at && done >= p->cancel_at) {
+		matrix_context_cancel(p->ctx);
+	}
+}
+
+TEST_FILLED(Matrix)
+
+static void test_complete() {
+	Matrix*		   a = filled(120, 1);
+	Matrix*		   b = filled(120, 2);
+	MatrixContext* ctx = matrix_context_new();
+	Progress	   progress = {0};
+	matrix_context_on_progress(ctx, record, &progress);
+
+	Matrix* expected = Matrix_multiply(a, b);
+	Result	res = Matrix_multiply_ctx(a, b, ctx);
+	assert(is_ok(res) && matrix_context_error(ctx) == NULL);
+	assert(Matrix_validate(res.val) && Matrix_equal(res.val, expected));
+	assert(progress.calls > 0 && progress.total > 0);
+	Matrix_free(res.val);
+	Matrix_free(expected);
+
+	progress = (Progress){0};
+	expected = Matrix_exp(a, 13);
+	res = Matrix_exp_ctx(a, 13, ctx);
+	assert(is_ok(res) && Matrix_equal(res.val, expected));
+	// 13 = 0b1101: three squares and two multiplies, reported by the power and not the products
+	assert(progress.calls == 5 && progress.last == 5 && progress.total == 5);
+	Matrix_free(res.val);
+	Matrix_free(expected);
+
+	Matrix* identity = Matrix_identity(120);
+	res = Matrix_exp_ctx(identity, 0, ctx);
+	assert(is_ok(res) && Matrix_equal(res.val, identity));
+	Matrix_free(res.val);
+
+	Matrix_free(identity);
+	matrix_context_free(ctx);
+	Matrix_free(b);
+	Matrix_free(a);
+}
+
+static void test_cancel() {
+	Matrix*		   a = filled(120, 3);
+	MatrixContext* ctx = matrix_context_new();
+	Progress	   progress = {0, 0, 0, 3, ctx};
+	matrix_context_on_progress(ctx, record, &progress);
+
+	Result res = Matrix_exp_ctx(a, 1000, ctx);
+	assert(is_err(res) && res.val == NULL);
+	assert(strcmp(res.err, "operation cancelled") == 0);
+	assert(progress.last == 3 && matrix_context_stopped(ctx));
+
+	// a stopped context stops the next operation before it starts
+	res = Matrix_multiply_ctx(a, a, ctx);
+	assert(is_err(res));
+
+	matrix_context_reset(ctx);
+	progress.cancel_at = 0;
+	res = Matrix_multiply_ctx(a, a, ctx);
+	assert(is_ok(res));
+	Matrix_free(res.val);
+
+	matrix_context_free(ctx);
+	Matrix_free(a);
+}
+
+static void test_deadline() {
+	Matrix*		   a = filled(400, 4);
+	MatrixContext* ctx = matrix_context_new();
+
+	matrix_context_set_deadline(ctx, 1);
+	struct timespec pause = {0, 5000000};
+	nanosleep(&pause, NULL);
+	Result res = Matrix_exp_ctx(a, 1 << 20, ctx);
+	assert(is_err(res) && strcmp(res.err, "deadline exceeded") == 0);
+
+	matrix_context_reset(ctx);
+	matrix_context_set_deadline(ctx, 0);
+	res = Matrix_exp_ctx(a, 2, ctx);
+	assert(is_ok(res));
+	Matrix_free(res.val);
+
+	matrix_context_free(ctx);
+	Matrix_free(a);
+}
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void interrupt(int signal) {
+	(void)signal;
+	interrupted = 1;
+}
+
+static void raise_at_two(void* user, u64 done, u64 total) {
+	(void)user;
+	(void)total;
+	if (done == 2) {
+		raise(SIGINT);
+	}
+}
+
+static void test_signal() {
+	Matrix*			 a = filled(120, 6);
+	MatrixContext*	 ctx = matrix_context_new();
+	struct sigaction action = {0}, previous;
+	action.sa_handler = interrupt;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, &previous);
+
+	interrupted = 0;
+	matrix_context_cancel_on(ctx, &interrupted);
+	matrix_context_on_progress(ctx, raise_at_two, NULL);
+	Result res = Matrix_exp_ctx(a, 1000, ctx);
+	assert(is_err(res) && strcmp(res.err, "operation cancelled") == 0);
+
+	// the flag has to be cleared along with the context
+	matrix_context_reset(ctx);
+	assert(matrix_context_stopped(ctx));
+	interrupted = 0;
+	matrix_context_reset(ctx);
+	matrix_context_on_progress(ctx, NULL, NULL);
+	res = Matrix_exp_ctx(a, 3, ctx);
+	assert(is_ok(res));
+	Matrix_free(res.val);
+
+	sigaction(SIGINT, &previous, NULL);
+	matrix_context_free(ctx);
+	Matrix_free(a);
+}
+
+static void* cancel_later(void* arg) {
+	struct timespec pause = {0, 2000000};
+	nanosleep(&pause, NULL);
+	matrix_context_cancel(arg);
+	return NULL;
+}
+
+static void test_concurrent_cancel() {
+	Matrix*		   a = filled(400, 5);
+	MatrixContext* ctx = matrix_context_new();
+	pthread_t	   canceller;
+	pthread_create(&canceller, NULL, cancel_later, ctx);
+	Result res = Matrix_exp_ctx(a, (i64)1 << 40, ctx);
+	pthread_join(canceller, NULL);
+	assert(is_err(res) && strcmp(res.err, "operation cancelled") == 0);
+	matrix_context_free(ctx);
+	Matrix_free(a);
+}
+
+int main() {
+	parallel_set_threads(4);
+	test_complete();
+	test_cancel();
+	test_deadline();
+	test_concurrent_cancel();
+	test_signal();
+	parallel_set_threads(1);
+	test_complete();
+	test_cancel();
+	test_deadline();
+	test_concurrent_cancel();
+	test_signal();
+	parallel_set_threads(0);
+	parallel_shutdown();
+	return EXIT_SUCCESS;
+}
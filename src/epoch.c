@@ -0,0 +1,77 @@
+#include "epoch.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include "parallel.h"
+
+#define EPOCH_SLOTS 64
+
+typedef struct EpochSlot {
+	u64 active[2];
+	u8	pad[64 - 2 * sizeof(u64)];
+} EpochSlot;
+
+struct MatrixEpoch {
+	EpochSlot		slot[EPOCH_SLOTS];
+	u64				current;
+	pthread_mutex_t lock;
+};
+
+MatrixEpoch* matrix_epoch_new() {
+	MatrixEpoch* epoch = aligned_alloc(64, (sizeof(MatrixEpoch) + 63) / 64 * 64);
+	for (u32 i = 0; i < EPOCH_SLOTS; ++i) {
+		epoch->slot[i].active[0] = epoch->slot[i].active[1] = 0;
+	}
+	epoch->current = 0;
+	pthread_mutex_init(&epoch->lock, NULL);
+	return epoch;
+}
+
+void matrix_epoch_free(MatrixEpoch* epoch) {
+	pthread_mutex_destroy(&epoch->lock);
+	free(epoch);
+}
+
+u32 matrix_epoch_enter(MatrixEpoch* epoch) {
+	u32 slot = parallel_thread_index() % EPOCH_SLOTS;
+	for (;;) {
+		u64 current = __atomic_load_n(&epoch->current, __ATOMIC_SEQ_CST);
+		u64 parity = current & 1;
+		__atomic_fetch_add(&epoch->slot[slot].active[parity], 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&epoch->current, __ATOMIC_SEQ_CST) == current) {
+			return slot << 1 | parity;
+		}
+		__atomic_fetch_sub(&epoch->slot[slot].active[parity], 1, __ATOMIC_RELEASE);
+	}
+}
+
+void matrix_epoch_leave(MatrixEpoch* epoch, u32 token) {
+	__atomic_fetch_sub(&epoch->slot[token >> 1].active[token & 1], 1, __ATOMIC_RELEASE);
+}
+
+static void epoch_drain(MatrixEpoch* epoch, u64 parity) {
+	for (u32 i = 0; i < EPOCH_SLOTS; ++i) {
+		while (__atomic_load_n(&epoch->slot[i].active[parity], __ATOMIC_ACQUIRE) != 0) {
+			sched_yield();
+		}
+	}
+}
+
+void matrix_epoch_synchronize(MatrixEpoch* epoch) {
+	pthread_mutex_lock(&epoch->lock);
+	u64 current = epoch->current;
+	// readers that entered with the other parity before the previous flip must be gone before the
+	// parity is reused, then every reader of the current parity is waited for after the flip
+	epoch_drain(epoch, (current + 1) & 1);
+	__atomic_store_n(&epoch->current, current + 1, __ATOMIC_SEQ_CST);
+	epoch_drain(epoch, current & 1);
+	pthread_mutex_unlock(&epoch->lock);
+}
+
+void* matrix_epoch_publish(MatrixEpoch* epoch, void** target, void* value) {
+	void* old = __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+	matrix_epoch_synchronize(epoch);
+	return old;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file epoch.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Epoch-based reclamation for data read by many threads without locks.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include "oxidation.h"
+
+/**
+ * @brief A reclamation domain. Readers mark the section in which they use shared data with
+ * `matrix_epoch_enter` and `matrix_epoch_leave`, which only touch a counter of their own thread.
+ * A writer that unlinked some data calls `matrix_epoch_synchronize`, which returns once every
+ * reader that could still see the data has left, after which the data can be freed.
+ */
+typedef struct MatrixEpoch MatrixEpoch;
+
+MatrixEpoch* matrix_epoch_new();
+
+/**
+ * @brief Free the domain. No reader may be inside it.
+ */
+void matrix_epoch_free(MatrixEpoch* epoch);
+
+/**
+ * @brief Enter a read section. Returns a token to pass to `matrix_epoch_leave`.
+ */
+u32 matrix_epoch_enter(MatrixEpoch* epoch);
+
+void matrix_epoch_leave(MatrixEpoch* epoch, u32 token);
+
+/**
+ * @brief Wait until every read section entered before the call has been left. Writers are
+ * serialized, and readers entering meanwhile are not waited for.
+ */
+void matrix_epoch_synchronize(MatrixEpoch* epoch);
+
+/**
+ * @brief Replace `*target` with `value` so that readers see either the old or the new value, wait
+ * for the readers of the old value, and return it so the caller can free it.
+ */
+void* matrix_epoch_publish(MatrixEpoch* epoch, void** target, void* value);
@@ -0,0 +1,273 @@
+/**
+ * @file ewise.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Element-wise unary and binary operations with inlined operators.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include <math.h>
+
+#include "oxidation.h"
+#include "structure.h"
+#include "trace.h"
+
+/**
+ * @brief An intersection gallops through the denser operand when it has this many times more
+ * elements than the sparser one.
+ */
+#define MATRIX_GALLOP_RATIO 16
+
+#define EWISE_PLUS(x, y)   ((x) + (y))
+#define EWISE_MINUS(x, y)  ((x) - (y))
+#define EWISE_TIMES(x, y)  ((x) * (y))
+#define EWISE_DIVIDE(x, y) ((x) / (y))
+#define EWISE_MAX(x, y)	   ((x) > (y) ? (x) : (y))
+#define EWISE_MIN(x, y)	   ((x) < (y) ? (x) : (y))
+
+/**
+ * @brief Builtin unary operations for `_apply`. The ones taking an argument use the `arg` of
+ * `_apply`, the others ignore it.
+ */
+typedef enum MatrixUnary {
+	MATRIX_UNARY_ABS,
+	MATRIX_UNARY_NEGATE,
+	MATRIX_UNARY_SIGN,
+	MATRIX_UNARY_SQRT,
+	MATRIX_UNARY_EXP,
+	MATRIX_UNARY_LOG,
+	MATRIX_UNARY_POW,		// x ^ arg
+	MATRIX_UNARY_CLAMP_MIN, // max(x, arg)
+	MATRIX_UNARY_CLAMP_MAX, // min(x, arg)
+} MatrixUnary;
+
+/**
+ * @brief Apply `_expr`, an expression of the value `x`, to `_count` elements of `_in` and write
+ * the nonzero results to `_out` in the same pass, counting them in `_n`. `_out` may be `_in`.
+ */
+#define MATRIX_APPLY_LOOP(_data_type, _in, _count, _out, _n, _expr)                                \
+	for (u64 i_ = 0; i_ < (_count); ++i_) {                                                        \
+		_data_type x = (_in)[i_].val;                                                              \
+		_data_type y_ = (_expr);                                                                   \
+		(_out)[_n].row = (_in)[i_].row;                                                            \
+		(_out)[_n].col = (_in)[i_].col;                                                            \
+		(_out)[_n].val = y_;                                                                       \
+		_n += y_ != 0;                                                                             \
+	}
+
+/**
+ * @brief Generate `_name##_##_op_name` and `_name##_##_op_name##_into`, which apply `_op` to
+ * every position stored in either operand. A position missing from one operand is passed to
+ * `_op` as 0.
+ */
+#define MATRIX_EWISE_UNION(_name, _data_type, _index_type, _op_name, _op)                          \
+	static u64 _name##_##_op_name##_kernel(const _name##Element* a, u64 na,                        \
+										   const _name##Element* b, u64 nb, _name##Element* out) { \
+		u64 i = 0, j = 0, n = 0;                                                                   \
+		while (i < na && j < nb) {                                                                 \
+			if (_name##_kernel_less(a + i, b + j)) {                                               \
+				n = _name##_kernel_emit(out, n, a[i].row, a[i].col, _op(a[i].val, (_data_type)0)); \
+				++i;                                                                               \
+			} else if (_name##_kernel_less(b + j, a + i)) {                                        \
+				n = _name##_kernel_emit(out, n, b[j].row, b[j].col, _op((_data_type)0, b[j].val)); \
+				++j;                                                                               \
+			} else {                                                                               \
+				n = _name##_kernel_emit(out, n, a[i].row, a[i].col, _op(a[i].val, b[j].val));      \
+				++i, ++j;                                                                          \
+			}                                                                                      \
+		}                                                                                          \
+		for (; i < na; ++i) {                                                                      \
+			n = _name##_kernel_emit(out, n, a[i].row, a[i].col, _op(a[i].val, (_data_type)0));     \
+		}                                                                                          \
+		for (; j < nb; ++j) {                                                                      \
+			n = _name##_kernel_emit(out, n, b[j].row, b[j].col, _op((_data_type)0, b[j].val));     \
+		}                                                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_##_op_name##_into(_name* out, _name* a, _name* b) {                               \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		u8 tags = matrix_structure_ewise(a->tags, b->tags);                                        \
+		_name##_reserve(out, a->data[0].val + b->data[0].val);                                     \
+		out->data[0].val = _name##_##_op_name##_kernel(a->data + 1, a->data[0].val, b->data + 1,   \
+													   b->data[0].val, out->data + 1);             \
+		out->data[0].row = a->data[0].row;                                                         \
+		out->data[0].col = a->data[0].col;                                                         \
+		out->tags = tags;                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_##_op_name(_name* a, _name* b) {                                                \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* m = _name##_new(a->data[0].row, a->data[0].col);                                    \
+		_name##_##_op_name##_into(m, a, b);                                                        \
+		return m;                                                                                  \
+	}
+
+/**
+ * @brief Generate `_name##_##_op_name` and `_name##_##_op_name##_into`, which apply `_op` to
+ * every position stored in both operands. When one operand is much sparser than the other, the
+ * denser one is searched by galloping instead of being scanned.
+ */
+#define MATRIX_EWISE_INTERSECT(_name, _data_type, _index_type, _op_name, _op)                      \
+	static u64 _name##_##_op_name##_kernel(const _name##Element* a, u64 na,                        \
+										   const _name##Element* b, u64 nb, _name##Element* out) { \
+		u64 i = 0, j = 0, n = 0;                                                                   \
+		if (na * MATRIX_GALLOP_RATIO < nb) {                                                       \
+			for (; i < na && j < nb; ++i) {                                                        \
+				j = _name##_kernel_gallop(b, j, nb, a + i);                                        \
+				if (j < nb && !_name##_kernel_less(a + i, b + j)) {                                \
+					n = _name##_kernel_emit(out, n, a[i].row, a[i].col, _op(a[i].val, b[j].val));  \
+				}                                                                                  \
+			}                                                                                      \
+			return n;                                                                              \
+		}                                                                                          \
+		if (nb * MATRIX_GALLOP_RATIO < na) {                                                       \
+			for (; j < nb && i < na; ++j) {                                                        \
+				i = _name##_kernel_gallop(a, i, na, b + j);                                        \
+				if (i < na && !_name##_kernel_less(b + j, a + i)) {                                \
+					n = _name##_kernel_emit(out, n, a[i].row, a[i].col, _op(a[i].val, b[j].val));  \
+				}                                                                                  \
+			}                                                                                      \
+			return n;                                                                              \
+		}                                                                                          \
+		while (i < na && j < nb) {                                                                 \
+			if (_name##_kernel_less(a + i, b + j)) {                                               \
+				++i;                                                                               \
+			} else if (_name##_kernel_less(b + j, a + i)) {                                        \
+				++j;                                                                               \
+			} else {                                                                               \
+				n = _name##_kernel_emit(out, n, a[i].row, a[i].col, _op(a[i].val, b[j].val));      \
+				++i, ++j;                                                                          \
+			}                                                                                      \
+		}                                                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_##_op_name##_into(_name* out, _name* a, _name* b) {                               \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		u8 tags = matrix_structure_intersect(a->tags, b->tags);                                    \
+		_name##_reserve(out, a->data[0].val < b->data[0].val ? a->data[0].val : b->data[0].val);   \
+		out->data[0].val = _name##_##_op_name##_kernel(a->data + 1, a->data[0].val, b->data + 1,   \
+													   b->data[0].val, out->data + 1);             \
+		out->data[0].row = a->data[0].row;                                                         \
+		out->data[0].col = a->data[0].col;                                                         \
+		out->tags = tags;                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_##_op_name(_name* a, _name* b) {                                                \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* m = _name##_new(a->data[0].row, a->data[0].col);                                    \
+		_name##_##_op_name##_into(m, a, b);                                                        \
+		return m;                                                                                  \
+	}
+
+/**
+ * @brief Generate `_name##_##_op_name`, `_name##_##_op_name##_into` and
+ * `_name##_##_op_name##_inplace`, which replace every stored value `x` with `_op(x, arg)` and drop
+ * the results that are zero.
+ */
+#define MATRIX_UNARY(_name, _data_type, _index_type, _op_name, _op)                                \
+	void _name##_##_op_name##_into(_name* out, _name* m, _data_type arg) {                         \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_reserve(out, m->data[0].val);                                                      \
+		u64 n = 0;                                                                                 \
+		MATRIX_APPLY_LOOP(_data_type, m->data + 1, m->data[0].val, out->data + 1, n, _op(x, arg)); \
+		out->data[0] = (_name##Element){m->data[0].row, m->data[0].col, n};                        \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_##_op_name##_inplace(_name* m, _data_type arg) {                                  \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_##_op_name##_into(m, m, arg);                                                      \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_##_op_name(_name* m, _data_type arg) {                                          \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* ans = _name##_new(m->data[0].row, m->data[0].col);                                  \
+		_name##_##_op_name##_into(ans, m, arg);                                                    \
+		return ans;                                                                                \
+	}
+
+#define MATRIX_UNARY_DECLARE(_name, _data_type, _index_type, _op_name)                             \
+	void   _name##_##_op_name##_into(_name* out, _name* m, _data_type arg);                        \
+	void   _name##_##_op_name##_inplace(_name* m, _data_type arg);                                 \
+	_name* _name##_##_op_name(_name* m, _data_type arg);
+
+#define MATRIX_EWISE_DECLARE(_name, _data_type, _index_type, _op_name)                             \
+	void   _name##_##_op_name##_into(_name* out, _name* a, _name* b);                              \
+	_name* _name##_##_op_name(_name* a, _name* b);
+
+#define MATRIX_EWISE_METHOD(_name, _data_type, _index_type)                                        \
+	static u64 _name##_kernel_apply(const _name##Element* a, u64 na, MatrixUnary op,               \
+									_data_type arg, _name##Element* out) {                         \
+		u64 n = 0;                                                                                 \
+		switch (op) {                                                                              \
+			case MATRIX_UNARY_ABS:                                                                 \
+				MATRIX_APPLY_LOOP(_data_type, a, na, out, n, x < 0 ? -x : x);                      \
+				break;                                                                             \
+			case MATRIX_UNARY_NEGATE:                                                              \
+				MATRIX_APPLY_LOOP(_data_type, a, na, out, n, -x);                                  \
+				break;                                                                             \
+			case MATRIX_UNARY_SIGN:                                                                \
+				MATRIX_APPLY_LOOP(_data_type, a, na, out, n, (x > 0) - (x < 0));                   \
+				break;                                                                             \
+			case MATRIX_UNARY_SQRT:                                                                \
+				MATRIX_APPLY_LOOP(_data_type, a, na, out, n, sqrt(x));                             \
+				break;                                                                             \
+			case MATRIX_UNARY_EXP:                                                                 \
+				MATRIX_APPLY_LOOP(_data_type, a, na, out, n, exp(x));                              \
+				break;                                                                             \
+			case MATRIX_UNARY_LOG:                                                                 \
+				MATRIX_APPLY_LOOP(_data_type, a, na, out, n, log(x));                              \
+				break;                                                                             \
+			case MATRIX_UNARY_POW:                                                                 \
+				MATRIX_APPLY_LOOP(_data_type, a, na, out, n, pow(x, arg));                         \
+				break;                                                                             \
+			case MATRIX_UNARY_CLAMP_MIN:                                                           \
+				MATRIX_APPLY_LOOP(_data_type, a, na, out, n, x < arg ? arg : x);                   \
+				break;                                                                             \
+			case MATRIX_UNARY_CLAMP_MAX:                                                           \
+				MATRIX_APPLY_LOOP(_data_type, a, na, out, n, x > arg ? arg : x);                   \
+				break;                                                                             \
+		}                                                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_apply_into(_name* out, _name* m, MatrixUnary op, _data_type arg) {                \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_reserve(out, m->data[0].val);                                                      \
+		u64 n = _name##_kernel_apply(m->data + 1, m->data[0].val, op, arg, out->data + 1);         \
+		out->data[0] = (_name##Element){m->data[0].row, m->data[0].col, n};                        \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_apply_inplace(_name* m, MatrixUnary op, _data_type arg) {                         \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_apply_into(m, m, op, arg);                                                         \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_apply(_name* m, MatrixUnary op, _data_type arg) {                               \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* ans = _name##_new(m->data[0].row, m->data[0].col);                                  \
+		_name##_apply_into(ans, m, op, arg);                                                       \
+		return ans;                                                                                \
+	}                                                                                              \
+                                                                                                   \
+	MATRIX_EWISE_UNION(_name, _data_type, _index_type, add, EWISE_PLUS)                            \
+	MATRIX_EWISE_UNION(_name, _data_type, _index_type, subtract, EWISE_MINUS)                      \
+	MATRIX_EWISE_UNION(_name, _data_type, _index_type, maximum, EWISE_MAX)                         \
+	MATRIX_EWISE_UNION(_name, _data_type, _index_type, minimum, EWISE_MIN)                         \
+	MATRIX_EWISE_INTERSECT(_name, _data_type, _index_type, hadamard, EWISE_TIMES)                  \
+	MATRIX_EWISE_INTERSECT(_name, _data_type, _index_type, divide, EWISE_DIVIDE)
+
+#define MATRIX_EWISE_METHOD_DECLARE(_name, _data_type, _index_type)                                \
+	void   _name##_apply_into(_name* out, _name* m, MatrixUnary op, _data_type arg);               \
+	void   _name##_apply_inplace(_name* m, MatrixUnary op, _data_type arg);                        \
+	_name* _name##_apply(_name* m, MatrixUnary op, _data_type arg);                                \
+	MATRIX_EWISE_DECLARE(_name, _data_type, _index_type, add)                                      \
+	MATRIX_EWISE_DECLARE(_name, _data_type, _index_type, subtract)                                 \
+	MATRIX_EWISE_DECLARE(_name, _data_type, _index_type, maximum)                                  \
+	MATRIX_EWISE_DECLARE(_name, _data_type, _index_type, minimum)                                  \
+	MATRIX_EWISE_DECLARE(_name, _data_type, _index_type, hadamard)                                 \
+	MATRIX_EWISE_DECLARE(_name, _data_type, _index_type, divide)
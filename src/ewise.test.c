@@ -0,0 +1,123 @@
+#include "ewise.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "matrix.h"
+
+#define EWISE_GREATER(x, y) ((x) > (y))
+#define SHRINK(x, arg)		((x) > (arg) ? (x) - (arg) : (x) < -(arg) ? (x) + (arg) : 0)
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+MATRIX_EWISE_UNION(Matrix, f64, u32, greater, EWISE_GREATER);
+MATRIX_UNARY(Matrix, f64, u32, shrink, SHRINK);
+
+Matrix* random_matrix(u32 rows, u32 cols, u32 percent) {
+	Matrix* m = Matrix_new(rows, cols);
+	for (u32 i = 0; i < rows; ++i) {
+		for (u32 j = 0; j < cols; ++j) {
+			if ((u32)rand() % 100 < percent) {
+				Matrix_set(m, i, j, (f64)(rand() % 9) - 4);
+			}
+		}
+	}
+	return m;
+}
+
+int main() {
+	srand(1481);
+
+	Matrix* a = Matrix_from_1d((f64[]){1.0, 0.0, 3.0, -4.0}, 2, 2);
+	Matrix* b = Matrix_from_1d((f64[]){1.0, 6.0, 0.0, 8.0}, 2, 2);
+
+	Matrix* diff = Matrix_subtract(a, b);
+	assert(diff->data[0].val == 3);
+	assert(Matrix_get(diff, 0, 1) == -6.0);
+	assert(Matrix_get(diff, 1, 0) == 3.0);
+	assert(Matrix_get(diff, 1, 1) == -12.0);
+
+	Matrix_maximum_into(diff, a, b);
+	assert(diff->data[0].val == 4);
+	assert(Matrix_get(diff, 1, 1) == 8.0);
+	Matrix_minimum_into(diff, a, b);
+	assert(diff->data[0].val == 2);
+	assert(Matrix_get(diff, 0, 0) == 1.0);
+	assert(Matrix_get(diff, 1, 1) == -4.0);
+	Matrix_divide_into(diff, a, b);
+	assert(diff->data[0].val == 2);
+	assert(Matrix_get(diff, 1, 1) == -0.5);
+	Matrix_greater_into(diff, a, b);
+	assert(diff->data[0].val == 1);
+	assert(Matrix_get(diff, 1, 0) == 1.0);
+	Matrix_free(diff);
+
+	u32 percents[][2] = {{30, 40}, {1, 90}, {90, 1}};
+	for (u32 k = 0; k < 3; ++k) {
+		Matrix* x = random_matrix(64, 48, percents[k][0]);
+		Matrix* y = random_matrix(64, 48, percents[k][1]);
+
+		Matrix* sum = Matrix_add(x, y);
+		Matrix* product = Matrix_hadamard(x, y);
+		assert(Matrix_validate(sum) && Matrix_validate(product));
+		u64 stored = 0;
+		for (u32 i = 0; i < 64; ++i) {
+			for (u32 j = 0; j < 48; ++j) {
+				f64 p = Matrix_get(x, i, j), q = Matrix_get(y, i, j);
+				assert(Matrix_get(sum, i, j) == p + q);
+				assert(Matrix_get(product, i, j) == p * q);
+				stored += p * q != 0;
+			}
+		}
+		assert(product->data[0].val == stored);
+
+		Matrix* axpby = Matrix_axpby(1.0, x, 1.0, y);
+		assert(Matrix_equal(sum, axpby));
+
+		Matrix_free(axpby);
+		Matrix_free(product);
+		Matrix_free(sum);
+		Matrix_free(y);
+		Matrix_free(x);
+	}
+
+	Matrix* c = Matrix_from_1d((f64[]){-4.0, 0.0, 9.0, 0.5, -1.0, 2.0}, 2, 3);
+	Matrix* d = Matrix_apply(c, MATRIX_UNARY_ABS, 0);
+	assert(d->data[0].val == 5);
+	assert(Matrix_get(d, 0, 0) == 4.0 && Matrix_get(d, 1, 1) == 1.0);
+	Matrix_apply_into(d, c, MATRIX_UNARY_SIGN, 0);
+	assert(Matrix_get(d, 0, 0) == -1.0 && Matrix_get(d, 1, 0) == 1.0);
+	Matrix_apply_into(d, c, MATRIX_UNARY_POW, 2);
+	assert(Matrix_get(d, 0, 2) == 81.0 && Matrix_get(d, 1, 0) == 0.25);
+	Matrix_apply_into(d, d, MATRIX_UNARY_SQRT, 0);
+	assert(Matrix_get(d, 0, 0) == 4.0 && Matrix_get(d, 1, 2) == 2.0);
+	Matrix_apply_into(d, c, MATRIX_UNARY_NEGATE, 0);
+	assert(Matrix_get(d, 0, 0) == 4.0 && Matrix_get(d, 0, 2) == -9.0);
+	Matrix_apply_into(d, c, MATRIX_UNARY_EXP, 0);
+	assert(Matrix_get(d, 0, 0) == exp(-4.0));
+	Matrix_apply_into(d, d, MATRIX_UNARY_LOG, 0);
+	assert(d->data[0].val == 5 && Matrix_get(d, 1, 2) == log(exp(2.0)));
+
+	Matrix_apply_into(d, c, MATRIX_UNARY_CLAMP_MAX, 0);
+	assert(d->data[0].val == 2);
+	assert(Matrix_validate(d));
+	assert(Matrix_get(d, 0, 0) == -4.0 && Matrix_get(d, 1, 1) == -1.0);
+	Matrix_apply_inplace(c, MATRIX_UNARY_CLAMP_MIN, 1.0);
+	assert(c->data[0].val == 5);
+	assert(Matrix_get(c, 0, 0) == 1.0 && Matrix_get(c, 0, 2) == 9.0);
+
+	Matrix_shrink_into(d, c, 1.5);
+	assert(d->data[0].val == 2);
+	assert(Matrix_get(d, 0, 2) == 7.5 && Matrix_get(d, 1, 2) == 0.5);
+	Matrix_shrink_inplace(c, 8.5);
+	assert(c->data[0].val == 1 && c->data[1].col == 2);
+	Matrix_free(d);
+	Matrix_free(c);
+
+	Matrix_free(a);
+	Matrix_free(b);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,412 @@
+/**
+ * @file expression.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Lazy matrix expressions recorded into a DAG and evaluated on demand.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "oxidation.h"
+#include "trace.h"
+#include "utils.h"
+
+typedef enum MatrixOp {
+	MATRIX_OP_LEAF,
+	MATRIX_OP_ADD,
+	MATRIX_OP_SCALE,
+	MATRIX_OP_HADAMARD,
+	MATRIX_OP_MULTIPLY,
+	MATRIX_OP_TRANSPOSE,
+} MatrixOp;
+
+#define MATRIX_EXPRESSION_STRUCT(_name, _data_type, _index_type)                                   \
+	typedef struct _name##Expr {                                                                   \
+		MatrixOp			op;                                                                    \
+		struct _name##Expr* lhs;                                                                   \
+		struct _name##Expr* rhs;                                                                   \
+		_data_type			scalar;                                                                \
+		_index_type			row;                                                                   \
+		_index_type			col;                                                                   \
+		_name*				value;                                                                 \
+		bool				owned;                                                                 \
+		u64					id;                                                                    \
+		u64					epoch;                                                                 \
+		u32					uses;                                                                  \
+	} _name##Expr;                                                                                 \
+                                                                                                   \
+	typedef struct _name##Graph {                                                                  \
+		_name##Expr** nodes;                                                                       \
+		u64			  count;                                                                       \
+		u64			  capacity;                                                                    \
+		_name##Expr** table;                                                                       \
+		u64			  table_size;                                                                  \
+		u64			  epoch;                                                                       \
+	} _name##Graph;
+
+#define MATRIX_EXPRESSION_METHOD(_name, _data_type, _index_type)                                   \
+	typedef struct _name##Instruction {                                                            \
+		MatrixOp   op;                                                                             \
+		u64		   input;                                                                          \
+		_data_type scalar;                                                                         \
+	} _name##Instruction;                                                                          \
+                                                                                                   \
+	_name##Graph* _name##Graph_new() {                                                             \
+		_name##Graph* g = malloc(sizeof(_name##Graph));                                            \
+		g->count = 0;                                                                              \
+		g->capacity = 16;                                                                          \
+		g->nodes = malloc(sizeof(_name##Expr*) * g->capacity);                                     \
+		g->table_size = 32;                                                                        \
+		g->table = calloc(g->table_size, sizeof(_name##Expr*));                                    \
+		g->epoch = 0;                                                                              \
+		return g;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##Graph_free(_name##Graph* g) {                                                      \
+		for (u64 i = 0; i < g->count; ++i) {                                                       \
+			if (g->nodes[i]->owned) {                                                              \
+				_name##_free(g->nodes[i]->value);                                                  \
+			}                                                                                      \
+			free(g->nodes[i]);                                                                     \
+		}                                                                                          \
+		free(g->nodes);                                                                            \
+		free(g->table);                                                                            \
+		free(g);                                                                                   \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##Graph_hash(MatrixOp op, const void* lhs, const void* rhs) {                  \
+		u64 h = (u64)op * 0x9E3779B97F4A7C15ull;                                                   \
+		h ^= (u64)(uintptr_t)lhs + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);                    \
+		h ^= (u64)(uintptr_t)rhs + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);                    \
+		return h ^ (h >> 29);                                                                      \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##Graph_key(_name##Expr* e) {                                                  \
+		return _name##Graph_hash(e->op, e->op == MATRIX_OP_LEAF ? (void*)e->value : (void*)e->lhs, \
+								 e->rhs);                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##Graph_index(_name##Graph* g, _name##Expr* e) {                              \
+		u64 slot = _name##Graph_key(e) & (g->table_size - 1);                                      \
+		while (g->table[slot]) {                                                                   \
+			slot = (slot + 1) & (g->table_size - 1);                                               \
+		}                                                                                          \
+		g->table[slot] = e;                                                                        \
+	}                                                                                              \
+                                                                                                   \
+	static _name##Expr* _name##Graph_intern(_name##Graph* g, MatrixOp op, _name##Expr* lhs,        \
+											_name##Expr* rhs, _data_type scalar, _name* value,     \
+											_index_type row, _index_type col) {                    \
+		const void* key = op == MATRIX_OP_LEAF ? (void*)value : (void*)lhs;                        \
+		u64			slot = _name##Graph_hash(op, key, rhs) & (g->table_size - 1);                  \
+		for (; g->table[slot]; slot = (slot + 1) & (g->table_size - 1)) {                          \
+			_name##Expr* e = g->table[slot];                                                       \
+			if (e->op == op && e->lhs == lhs && e->rhs == rhs && e->scalar == scalar &&            \
+				(op != MATRIX_OP_LEAF || e->value == value)) {                                     \
+				return e;                                                                          \
+			}                                                                                      \
+		}                                                                                          \
+                                                                                                   \
+		_name##Expr* e = malloc(sizeof(_name##Expr));                                              \
+		*e = (_name##Expr){op, lhs, rhs, scalar, row, col, value, false, g->count, 0, 0};          \
+		if (g->count == g->capacity) {                                                             \
+			g->capacity <<= 1;                                                                     \
+			g->nodes = realloc(g->nodes, sizeof(_name##Expr*) * g->capacity);                      \
+		}                                                                                          \
+		g->nodes[g->count++] = e;                                                                  \
+                                                                                                   \
+		if (g->count * 2 > g->table_size) {                                                        \
+			free(g->table);                                                                        \
+			g->table_size <<= 1;                                                                   \
+			g->table = calloc(g->table_size, sizeof(_name##Expr*));                                \
+			for (u64 i = 0; i < g->count; ++i) {                                                   \
+				_name##Graph_index(g, g->nodes[i]);                                                \
+			}                                                                                      \
+		} else {                                                                                   \
+			g->table[slot] = e;                                                                    \
+		}                                                                                          \
+		return e;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	_name##Expr* _name##Graph_leaf(_name##Graph* g, _name* m) {                                    \
+		return _name##Graph_intern(g, MATRIX_OP_LEAF, NULL, NULL, 0, m, m->data[0].row,            \
+								   m->data[0].col);                                                \
+	}                                                                                              \
+                                                                                                   \
+	_name##Expr* _name##Graph_add(_name##Graph* g, _name##Expr* a, _name##Expr* b) {               \
+		if (a->id > b->id) {                                                                       \
+			_name##Expr* t = a;                                                                    \
+			a = b;                                                                                 \
+			b = t;                                                                                 \
+		}                                                                                          \
+		return _name##Graph_intern(g, MATRIX_OP_ADD, a, b, 0, NULL, a->row, a->col);               \
+	}                                                                                              \
+                                                                                                   \
+	_name##Expr* _name##Graph_hadamard(_name##Graph* g, _name##Expr* a, _name##Expr* b) {          \
+		if (a->id > b->id) {                                                                       \
+			_name##Expr* t = a;                                                                    \
+			a = b;                                                                                 \
+			b = t;                                                                                 \
+		}                                                                                          \
+		return _name##Graph_intern(g, MATRIX_OP_HADAMARD, a, b, 0, NULL, a->row, a->col);          \
+	}                                                                                              \
+                                                                                                   \
+	_name##Expr* _name##Graph_scale(_name##Graph* g, _name##Expr* a, _data_type scalar) {          \
+		if (a->op == MATRIX_OP_SCALE) {                                                            \
+			scalar *= a->scalar;                                                                   \
+			a = a->lhs;                                                                            \
+		}                                                                                          \
+		if (scalar == 1) {                                                                         \
+			return a;                                                                              \
+		}                                                                                          \
+		return _name##Graph_intern(g, MATRIX_OP_SCALE, a, NULL, scalar, NULL, a->row, a->col);     \
+	}                                                                                              \
+                                                                                                   \
+	_name##Expr* _name##Graph_multiply(_name##Graph* g, _name##Expr* a, _name##Expr* b) {          \
+		return _name##Graph_intern(g, MATRIX_OP_MULTIPLY, a, b, 0, NULL, a->row, b->col);          \
+	}                                                                                              \
+                                                                                                   \
+	_name##Expr* _name##Graph_transpose(_name##Graph* g, _name##Expr* a) {                         \
+		if (a->op == MATRIX_OP_TRANSPOSE) {                                                        \
+			return a->lhs;                                                                         \
+		}                                                                                          \
+		return _name##Graph_intern(g, MATRIX_OP_TRANSPOSE, a, NULL, 0, NULL, a->col, a->row);      \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##Graph_count_uses(_name##Graph* g, _name##Expr* e) {                         \
+		if (e->epoch == g->epoch) {                                                                \
+			return;                                                                                \
+		}                                                                                          \
+		e->epoch = g->epoch;                                                                       \
+		e->uses = 0;                                                                               \
+		if (e->value) {                                                                            \
+			return;                                                                                \
+		}                                                                                          \
+		if (e->lhs) {                                                                              \
+			_name##Graph_count_uses(g, e->lhs);                                                    \
+			++e->lhs->uses;                                                                        \
+		}                                                                                          \
+		if (e->rhs) {                                                                              \
+			_name##Graph_count_uses(g, e->rhs);                                                    \
+			++e->rhs->uses;                                                                        \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static bool _name##Graph_fusable(_name##Expr* e) {                                             \
+		bool elementwise =                                                                         \
+			e->op == MATRIX_OP_SCALE || e->op == MATRIX_OP_ADD || e->op == MATRIX_OP_HADAMARD;     \
+		return elementwise && !e->value && e->uses < 2;                                            \
+	}                                                                                              \
+                                                                                                   \
+	static _name* _name##Graph_compute(_name##Graph* g, _name##Expr* e);                           \
+                                                                                                   \
+	static _name* _name##Graph_value(_name##Graph* g, _name##Expr* e, bool* temporary) {           \
+		*temporary = false;                                                                        \
+		if (e->value) {                                                                            \
+			return e->value;                                                                       \
+		}                                                                                          \
+		_name* m = _name##Graph_compute(g, e);                                                     \
+		if (e->uses >= 2) {                                                                        \
+			e->value = m;                                                                          \
+			e->owned = true;                                                                       \
+		} else {                                                                                   \
+			*temporary = true;                                                                     \
+		}                                                                                          \
+		return m;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static _name* _name##Graph_product(_name##Graph* g, _name##Expr* e, _data_type alpha) {        \
+		_name##Expr* lhs = e->lhs;                                                                 \
+		_name##Expr* rhs = e->rhs;                                                                 \
+		while (lhs->op == MATRIX_OP_SCALE && _name##Graph_fusable(lhs)) {                          \
+			alpha *= lhs->scalar;                                                                  \
+			lhs = lhs->lhs;                                                                        \
+		}                                                                                          \
+		while (rhs->op == MATRIX_OP_SCALE && _name##Graph_fusable(rhs)) {                          \
+			alpha *= rhs->scalar;                                                                  \
+			rhs = rhs->lhs;                                                                        \
+		}                                                                                          \
+                                                                                                   \
+		bool   lhs_temporary, rhs_temporary;                                                       \
+		_name* a = _name##Graph_value(g, lhs, &lhs_temporary);                                     \
+		_name* b = _name##Graph_value(g, rhs, &rhs_temporary);                                     \
+		_name* m = _name##_new(e->row, e->col);                                                    \
+		_name##_gemm(alpha, a, b, 0, m);                                                           \
+		if (lhs_temporary) {                                                                       \
+			_name##_free(a);                                                                       \
+		}                                                                                          \
+		if (rhs_temporary && b != a) {                                                             \
+			_name##_free(b);                                                                       \
+		}                                                                                          \
+		return m;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	typedef struct _name##Fusion {                                                                 \
+		_name##Expr**		 node;                                                                 \
+		_name**				 input;                                                                \
+		bool*				 temporary;                                                            \
+		u64					 inputs;                                                               \
+		_name##Instruction*	 program;                                                              \
+		u64					 length;                                                               \
+	} _name##Fusion;                                                                               \
+                                                                                                   \
+	static void _name##Graph_collect(_name##Graph* g, _name##Expr* e, bool root,                   \
+									 _name##Fusion* f) {                                           \
+		if (root || _name##Graph_fusable(e)) {                                                     \
+			_name##Graph_collect(g, e->lhs, false, f);                                             \
+			if (e->rhs) {                                                                          \
+				_name##Graph_collect(g, e->rhs, false, f);                                         \
+			}                                                                                      \
+			f->program[f->length++] = (_name##Instruction){e->op, 0, e->scalar};                   \
+			return;                                                                                \
+		}                                                                                          \
+                                                                                                   \
+		u64 k = 0;                                                                                 \
+		while (k < f->inputs && f->node[k] != e) {                                                 \
+			++k;                                                                                   \
+		}                                                                                          \
+		if (k == f->inputs) {                                                                      \
+			f->node[k] = e;                                                                        \
+			f->input[k] = _name##Graph_value(g, e, &f->temporary[k]);                              \
+			++f->inputs;                                                                           \
+		}                                                                                          \
+		f->program[f->length++] = (_name##Instruction){MATRIX_OP_LEAF, k, 0};                      \
+	}                                                                                              \
+                                                                                                   \
+	static _name* _name##Graph_fuse(_name##Graph* g, _name##Expr* e) {                             \
+		_name##Fusion f;                                                                           \
+		u64			  size = g->count * 3 + 1;                                                     \
+		f.node = scratch_alloc(sizeof(_name##Expr*) * size);                                       \
+		f.input = scratch_alloc(sizeof(_name*) * size);                                            \
+		f.temporary = scratch_alloc(sizeof(bool) * size);                                          \
+		f.program = scratch_alloc(sizeof(_name##Instruction) * size);                              \
+		f.inputs = f.length = 0;                                                                   \
+		_name##Graph_collect(g, e, true, &f);                                                      \
+                                                                                                   \
+		u64*		cursor = scratch_alloc(sizeof(u64) * f.inputs);                                \
+		_data_type* stack = scratch_alloc(sizeof(_data_type) * f.length);                          \
+		_data_type* value = scratch_alloc(sizeof(_data_type) * f.inputs);                          \
+		u64			bound = 0;                                                                     \
+		for (u64 k = 0; k < f.inputs; ++k) {                                                       \
+			cursor[k] = 1;                                                                         \
+			bound += f.input[k]->data[0].val;                                                      \
+		}                                                                                          \
+		u64 dense = (u64)e->row * e->col;                                                          \
+		if (bound > dense && e->col != 0 && dense / e->col == e->row) {                            \
+			bound = dense;                                                                         \
+		}                                                                                          \
+                                                                                                   \
+		_name* m = _name##_new(e->row, e->col);                                                    \
+		_name##_reserve(m, bound);                                                                 \
+		u64 n = 0;                                                                                 \
+		while (true) {                                                                             \
+			bool		found = false;                                                             \
+			_index_type row = 0, col = 0;                                                          \
+			for (u64 k = 0; k < f.inputs; ++k) {                                                   \
+				if (cursor[k] > f.input[k]->data[0].val) {                                         \
+					continue;                                                                      \
+				}                                                                                  \
+				_name##Element* x = f.input[k]->data + cursor[k];                                  \
+				if (!found || x->row < row || (x->row == row && x->col < col)) {                   \
+					row = x->row;                                                                  \
+					col = x->col;                                                                  \
+					found = true;                                                                  \
+				}                                                                                  \
+			}                                                                                      \
+			if (!found) {                                                                          \
+				break;                                                                             \
+			}                                                                                      \
+                                                                                                   \
+			for (u64 k = 0; k < f.inputs; ++k) {                                                   \
+				_name##Element* x = f.input[k]->data + cursor[k];                                  \
+				if (cursor[k] <= f.input[k]->data[0].val && x->row == row && x->col == col) {      \
+					value[k] = x->val;                                                             \
+					++cursor[k];                                                                   \
+				} else {                                                                           \
+					value[k] = 0;                                                                  \
+				}                                                                                  \
+			}                                                                                      \
+                                                                                                   \
+			u64 top = 0;                                                                           \
+			for (u64 p = 0; p < f.length; ++p) {                                                   \
+				_name##Instruction* ins = f.program + p;                                           \
+				if (ins->op == MATRIX_OP_LEAF) {                                                   \
+					stack[top++] = value[ins->input];                                              \
+				} else if (ins->op == MATRIX_OP_SCALE) {                                           \
+					stack[top - 1] *= ins->scalar;                                                 \
+				} else if (ins->op == MATRIX_OP_ADD) {                                             \
+					stack[top - 2] += stack[top - 1];                                              \
+					--top;                                                                         \
+				} else {                                                                           \
+					stack[top - 2] *= stack[top - 1];                                              \
+					--top;                                                                         \
+				}                                                                                  \
+			}                                                                                      \
+			if (stack[0] != 0) {                                                                   \
+				m->data[++n] = (_name##Element){row, col, stack[0]};                               \
+			}                                                                                      \
+		}                                                                                          \
+		m->data[0].val = n;                                                                        \
+                                                                                                   \
+		for (u64 k = 0; k < f.inputs; ++k) {                                                       \
+			if (f.temporary[k]) {                                                                  \
+				_name##_free(f.input[k]);                                                          \
+			}                                                                                      \
+		}                                                                                          \
+		scratch_free(value);                                                                       \
+		scratch_free(stack);                                                                       \
+		scratch_free(cursor);                                                                      \
+		scratch_free(f.program);                                                                   \
+		scratch_free(f.temporary);                                                                 \
+		scratch_free(f.input);                                                                     \
+		scratch_free(f.node);                                                                      \
+		return m;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static _name* _name##Graph_compute(_name##Graph* g, _name##Expr* e) {                          \
+		if (e->op == MATRIX_OP_MULTIPLY) {                                                         \
+			return _name##Graph_product(g, e, 1);                                                  \
+		}                                                                                          \
+		if (e->op == MATRIX_OP_TRANSPOSE) {                                                        \
+			bool   temporary;                                                                      \
+			_name* a = _name##Graph_value(g, e->lhs, &temporary);                                  \
+			_name* m = _name##_transpose(a);                                                       \
+			if (temporary) {                                                                       \
+				_name##_free(a);                                                                   \
+			}                                                                                      \
+			return m;                                                                              \
+		}                                                                                          \
+		if (e->op == MATRIX_OP_SCALE && e->lhs->op == MATRIX_OP_MULTIPLY && !e->lhs->value &&      \
+			e->lhs->uses < 2) {                                                                    \
+			return _name##Graph_product(g, e->lhs, e->scalar);                                     \
+		}                                                                                          \
+		return _name##Graph_fuse(g, e);                                                            \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##Graph_eval(_name##Graph* g, _name##Expr* e) {                                    \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		if (e->value) {                                                                            \
+			return e->value;                                                                       \
+		}                                                                                          \
+		++g->epoch;                                                                                \
+		_name##Graph_count_uses(g, e);                                                             \
+		e->value = _name##Graph_compute(g, e);                                                     \
+		e->owned = true;                                                                           \
+		return e->value;                                                                           \
+	}
+
+#define MATRIX_EXPRESSION_METHOD_DECLARE(_name, _data_type, _index_type)                           \
+	_name##Graph* _name##Graph_new();                                                              \
+	void		  _name##Graph_free(_name##Graph* g);                                              \
+	_name##Expr*  _name##Graph_leaf(_name##Graph* g, _name* m);                                    \
+	_name##Expr*  _name##Graph_add(_name##Graph* g, _name##Expr* a, _name##Expr* b);               \
+	_name##Expr*  _name##Graph_hadamard(_name##Graph* g, _name##Expr* a, _name##Expr* b);          \
+	_name##Expr*  _name##Graph_scale(_name##Graph* g, _name##Expr* a, _data_type scalar);          \
+	_name##Expr*  _name##Graph_multiply(_name##Graph* g, _name##Expr* a, _name##Expr* b);          \
+	_name##Expr*  _name##Graph_transpose(_name##Graph* g, _name##Expr* a);                         \
+	_name*		  _name##Graph_eval(_name##Graph* g, _name##Expr* e);
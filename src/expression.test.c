@@ -0,0 +1,70 @@
+#include "expression.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+int main() {
+	Matrix* a = Matrix_from_1d((f64[]){1.0, 2.0, 0.0, 4.0}, 2, 2);
+	Matrix* b = Matrix_from_1d((f64[]){5.0, 0.0, 7.0, -8.0}, 2, 2);
+	Matrix* c = Matrix_from_1d((f64[]){1.0, 1.0, 0.0, 1.0}, 2, 2);
+
+	MatrixGraph* g = MatrixGraph_new();
+	MatrixExpr*	 ea = MatrixGraph_leaf(g, a);
+	MatrixExpr*	 eb = MatrixGraph_leaf(g, b);
+	MatrixExpr*	 ec = MatrixGraph_leaf(g, c);
+	assert(MatrixGraph_leaf(g, a) == ea);
+
+	MatrixExpr* sum = MatrixGraph_add(g, MatrixGraph_scale(g, ea, 2), eb);
+	MatrixExpr* fused = MatrixGraph_hadamard(g, sum, ec);
+	assert(MatrixGraph_add(g, eb, MatrixGraph_scale(g, ea, 2)) == sum);
+
+	Matrix* scaled = Matrix_scale(a, 2);
+	Matrix* added = Matrix_add(scaled, b);
+	Matrix* expected = Matrix_hadamard(added, c);
+	assert(Matrix_equal(MatrixGraph_eval(g, fused), expected));
+	assert(sum->value == NULL);
+	assert(MatrixGraph_eval(g, fused) == fused->value);
+	Matrix_free(expected);
+	Matrix_free(added);
+	Matrix_free(scaled);
+
+	MatrixExpr* product = MatrixGraph_multiply(g, ea, eb);
+	MatrixExpr* shared = MatrixGraph_add(g, product, MatrixGraph_scale(g, product, 3));
+	Matrix*		ab = Matrix_multiply(a, b);
+	expected = Matrix_scale(ab, 4);
+	assert(Matrix_equal(MatrixGraph_eval(g, shared), expected));
+	assert(product->value != NULL);
+	Matrix_free(expected);
+
+	MatrixExpr* inner = MatrixGraph_multiply(g, MatrixGraph_scale(g, ea, 2), eb);
+	MatrixExpr* pushed = MatrixGraph_scale(g, inner, 3);
+	expected = Matrix_scale(ab, 6);
+	assert(Matrix_equal(MatrixGraph_eval(g, pushed), expected));
+	assert(pushed->lhs->value == NULL);
+	Matrix_free(expected);
+
+	assert(MatrixGraph_transpose(g, MatrixGraph_transpose(g, ea)) == ea);
+	MatrixExpr* transposed = MatrixGraph_transpose(g, MatrixGraph_add(g, ea, eb));
+	Matrix*		a_plus_b = Matrix_add(a, b);
+	expected = Matrix_transpose(a_plus_b);
+	assert(Matrix_equal(MatrixGraph_eval(g, transposed), expected));
+	Matrix_free(expected);
+	Matrix_free(a_plus_b);
+
+	MatrixExpr* cancel = MatrixGraph_add(g, ea, MatrixGraph_scale(g, ea, -1));
+	assert(MatrixGraph_eval(g, cancel)->data[0].val == 0);
+
+	Matrix_free(ab);
+	MatrixGraph_free(g);
+	Matrix_free(a);
+	Matrix_free(b);
+	Matrix_free(c);
+
+	return EXIT_SUCCESS;
+}
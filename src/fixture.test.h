@@ -0,0 +1,68 @@
+/**
+ * @file fixture.test.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Fixtures shared by the tests: a counting allocator and a filled test matrix.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+
+#include "allocator.h"
+#include "oxidation.h"
+
+/**
+ * @brief What went through a counting allocator. The hooks count atomically, so pool threads may
+ * allocate through it too.
+ */
+typedef struct Counter {
+	u64 allocs;
+	u64 releases;
+} Counter;
+
+static inline void* counting_alloc(void* ctx, u64 bytes) {
+	__atomic_add_fetch(&((Counter*)ctx)->allocs, 1, __ATOMIC_RELAXED);
+	return malloc(bytes);
+}
+
+static inline void* counting_resize(void* ctx, void* ptr, u64 bytes) {
+	if (ptr == NULL) {
+		__atomic_add_fetch(&((Counter*)ctx)->allocs, 1, __ATOMIC_RELAXED);
+	}
+	return realloc(ptr, bytes);
+}
+
+static inline void counting_release(void* ctx, void* ptr) {
+	__atomic_add_fetch(&((Counter*)ctx)->releases, 1, __ATOMIC_RELAXED);
+	free(ptr);
+}
+
+static inline MatrixAllocator counting_allocator(Counter* counter) {
+	return (MatrixAllocator){counting_alloc, counting_resize, counting_release, counter};
+}
+
+/**
+ * @brief Number of allocations not released yet.
+ */
+static inline u64 counting_live(Counter* counter) {
+	return __atomic_load_n(&counter->allocs, __ATOMIC_RELAXED) -
+		   __atomic_load_n(&counter->releases, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Define `filled` for the matrix type `_name`: a square matrix with every fifth entry of
+ * each row set, to values small enough that powers of it stay finite.
+ */
+#define TEST_FILLED(_name)                                                                         \
+	static _name* filled(u32 size, u32 seed) {                                                     \
+		_name* m = _name##_new(size, size);                                                        \
+		for (u32 i = 0; i < size; ++i) {                                                           \
+			for (u32 j = i % 5; j < size; j += 5) {                                                \
+				_name##_set(m, i, j, (f64)((seed + i * 7 + j) % 5) / 8);                           \
+			}                                                                                      \
+		}                                                                                          \
+		return m;                                                                                  \
+	}
@@ -11,9 +11,44 @@
 
 #include <string.h>
 
+#include "allocator.h"
+#include "assembler.h"
+#include "async.h"
+#include "batch.h"
+#include "broadcast.h"
+#include "buffer.h"
+#include "chain.h"
+#include "context.h"
+#include "ewise.h"
+#include "expression.h"
 #include "guard.h"
 #include "oxidation.h"
+#include "parallel.h"
+#include "reduce.h"
+#include "semiring.h"
+#include "shared.h"
+#include "slice.h"
+#include "structure.h"
+#include "trace.h"
 #include "utils.h"
+#include "view.h"
+
+/**
+ * @brief Names shorter than this are stored inside the matrix struct instead of being allocated.
+ */
+#define MATRIX_NAME_INLINE 16
+
+/**
+ * @brief Number of stored elements below which multiply, transpose, the dense conversions and
+ * `_rebuild` stay on the calling thread.
+ */
+#define MATRIX_PARALLEL_GRAIN 4096
+
+/**
+ * @brief Number of elements up to which sorting by coordinates uses insertion sort instead of
+ * radix sort.
+ */
+#define MATRIX_SORT_SMALL 32
 
 #ifdef DEBUG
 #define PRINT(...) printf(__VA_ARGS__)
@@ -35,50 +70,684 @@
                                                                                                    \
 	typedef struct _name {                                                                         \
 		u8				size;                                                                      \
+		u8				tags;                                                                      \
+		u32				reallocs;                                                                  \
 		_name##Element* data;                                                                      \
 		char*			name;                                                                      \
-	} _name;
+		char			label[MATRIX_NAME_INLINE];                                                 \
+	} _name;                                                                                       \
+                                                                                                   \
+	MATRIX_BATCH_STRUCT(_name, _data_type, _index_type)                                            \
+	MATRIX_EXPRESSION_STRUCT(_name, _data_type, _index_type)                                       \
+	MATRIX_VIEW_STRUCT(_name, _data_type, _index_type)                                             \
+	MATRIX_SHARED_STRUCT(_name, _data_type, _index_type)                                           \
+	MATRIX_ASSEMBLER_STRUCT(_name, _data_type, _index_type)
 
 #define MATRIX_STRUCT_DECLARE(_name, _data_type, _index_type)                                      \
-	typedef struct _name##Element _name##Element;                                                  \
-	typedef struct _name##Found	  _name##Found;                                                    \
-	typedef struct _name		  _name;
+	typedef struct _name##Element	_name##Element;                                                \
+	typedef struct _name##Found		_name##Found;                                                  \
+	typedef struct _name			_name;                                                         \
+	typedef struct _name##Batch		_name##Batch;                                                  \
+	typedef struct _name##Expr		_name##Expr;                                                   \
+	typedef struct _name##Graph		_name##Graph;                                                  \
+	typedef struct _name##View		_name##View;                                                   \
+	typedef struct _name##Shared	_name##Shared;                                                 \
+	typedef struct _name##Snapshot	_name##Snapshot;                                               \
+	typedef struct _name##Assembler	_name##Assembler;
+
+#define MATRIX_KERNEL(_name, _data_type, _index_type)                                              \
+	typedef struct _name##Workspace {                                                              \
+		u64*		 ptr;                                                                          \
+		_data_type*	 acc;                                                                          \
+		u64*		 mark;                                                                         \
+		_index_type* list;                                                                         \
+		u64			 stamp;                                                                        \
+	} _name##Workspace;                                                                            \
+                                                                                                   \
+	static _name##Workspace _name##_workspace_new(_index_type inner, _index_type cols) {           \
+		_name##Workspace w;                                                                        \
+		w.ptr = scratch_alloc(sizeof(u64) * ((u64)inner + 1));                                     \
+		w.acc = scratch_alloc(sizeof(_data_type) * ((u64)cols + 1));                               \
+		w.mark = scratch_alloc(sizeof(u64) * ((u64)cols + 1));                                     \
+		w.list = scratch_alloc(sizeof(_index_type) * ((u64)cols + 1));                             \
+		memset(w.mark, 0, sizeof(u64) * ((u64)cols + 1));                                          \
+		w.stamp = 0;                                                                               \
+		return w;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_workspace_free(_name##Workspace* w) {                                      \
+		scratch_free(w->ptr);                                                                      \
+		scratch_free(w->acc);                                                                      \
+		scratch_free(w->mark);                                                                     \
+		scratch_free(w->list);                                                                     \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_kernel_row_ptr(const _name##Element* e, u64 n, _index_type rows,           \
+									   u64* ptr) {                                                 \
+		memset(ptr, 0, sizeof(u64) * ((size_t)rows + 1));                                          \
+		for (u64 i = 0; i < n; ++i) {                                                              \
+			++ptr[e[i].row + 1];                                                                   \
+		}                                                                                          \
+		for (_index_type r = 0; r < rows; ++r) {                                                   \
+			ptr[r + 1] += ptr[r];                                                                  \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static inline u64 _name##_kernel_emit(_name##Element* out, u64 n, _index_type row,             \
+										  _index_type col, _data_type val) {                       \
+		if (val == 0) {                                                                            \
+			return n;                                                                              \
+		}                                                                                          \
+		if (out) {                                                                                 \
+			out[n] = (_name##Element){row, col, val};                                              \
+		}                                                                                          \
+		return n + 1;                                                                              \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_kernel_axpby(_data_type alpha, const _name##Element* a, u64 na,             \
+									_data_type beta, const _name##Element* b, u64 nb,              \
+									_name##Element* out) {                                         \
+		u64 i = 0, j = 0, n = 0;                                                                   \
+		while (i < na && j < nb) {                                                                 \
+			if (a[i].row < b[j].row || (a[i].row == b[j].row && a[i].col < b[j].col)) {            \
+				n = _name##_kernel_emit(out, n, a[i].row, a[i].col, alpha * a[i].val);             \
+				++i;                                                                               \
+			} else if (a[i].row == b[j].row && a[i].col == b[j].col) {                             \
+				n = _name##_kernel_emit(out, n, a[i].row, a[i].col,                                \
+										alpha * a[i].val + beta * b[j].val);                       \
+				++i, ++j;                                                                          \
+			} else {                                                                               \
+				n = _name##_kernel_emit(out, n, b[j].row, b[j].col, beta * b[j].val);              \
+				++j;                                                                               \
+			}                                                                                      \
+		}                                                                                          \
+		for (; i < na; ++i) {                                                                      \
+			n = _name##_kernel_emit(out, n, a[i].row, a[i].col, alpha * a[i].val);                 \
+		}                                                                                          \
+		for (; j < nb; ++j) {                                                                      \
+			n = _name##_kernel_emit(out, n, b[j].row, b[j].col, beta * b[j].val);                  \
+		}                                                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_kernel_scale(const _name##Element* a, u64 na, _data_type scalar,            \
+									_name##Element* out) {                                         \
+		u64 n = 0;                                                                                 \
+		for (u64 i = 0; i < na; ++i) {                                                             \
+			n = _name##_kernel_emit(out, n, a[i].row, a[i].col, scalar * a[i].val);                \
+		}                                                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_kernel_map(const _name##Element* a, u64 na,                                 \
+								  _data_type (*func)(_data_type, _index_type, _index_type),        \
+								  _name##Element* out) {                                           \
+		u64 n = 0;                                                                                 \
+		for (u64 i = 0; i < na; ++i) {                                                             \
+			_data_type val = func(a[i].val, a[i].row, a[i].col);                                   \
+			n = _name##_kernel_emit(out, n, a[i].row, a[i].col, val);                              \
+		}                                                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_kernel_diagonal(const _name##Element* a, u64 na, const _name##Element* d,   \
+									   u64 nd, _index_type dim, bool rows, _name##Element* out) {  \
+		_data_type* v = scratch_alloc(sizeof(_data_type) * ((u64)dim + 1));                        \
+		memset(v, 0, sizeof(_data_type) * ((u64)dim + 1));                                         \
+		for (u64 i = 0; i < nd; ++i) {                                                             \
+			v[d[i].row] = d[i].val;                                                                \
+		}                                                                                          \
+		u64 n = 0;                                                                                 \
+		for (u64 i = 0; i < na; ++i) {                                                             \
+			_data_type scale = v[rows ? a[i].row : a[i].col];                                      \
+			n = _name##_kernel_emit(out, n, a[i].row, a[i].col, a[i].val * scale);                 \
+		}                                                                                          \
+		scratch_free(v);                                                                           \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static inline bool _name##_kernel_less(const _name##Element* x, const _name##Element* y) {     \
+		return x->row < y->row || (x->row == y->row && x->col < y->col);                           \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_kernel_gallop(const _name##Element* e, u64 lo, u64 n,                       \
+									 const _name##Element* key) {                                  \
+		u64 hi = lo, step = 1;                                                                     \
+		while (hi < n && _name##_kernel_less(e + hi, key)) {                                       \
+			lo = hi + 1;                                                                           \
+			hi += step;                                                                            \
+			step <<= 1;                                                                            \
+		}                                                                                          \
+		if (hi > n) {                                                                              \
+			hi = n;                                                                                \
+		}                                                                                          \
+		while (lo < hi) {                                                                          \
+			u64 mid = lo + (hi - lo) / 2;                                                          \
+			if (_name##_kernel_less(e + mid, key)) {                                               \
+				lo = mid + 1;                                                                      \
+			} else {                                                                               \
+				hi = mid;                                                                          \
+			}                                                                                      \
+		}                                                                                          \
+		return lo;                                                                                 \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_kernel_row_blocks(const _name##Element* e, u64 n, u64 blocks,              \
+										  u64* bound) {                                            \
+		bound[0] = 0;                                                                              \
+		for (u64 x = 1; x < blocks; ++x) {                                                         \
+			u64 at = n * x / blocks;                                                               \
+			if (at < bound[x - 1]) {                                                               \
+				at = bound[x - 1];                                                                 \
+			}                                                                                      \
+			while (at > 0 && at < n && e[at].row == e[at - 1].row) {                               \
+				++at;                                                                              \
+			}                                                                                      \
+			bound[x] = at;                                                                         \
+		}                                                                                          \
+		bound[blocks] = n;                                                                         \
+	}                                                                                              \
+                                                                                                   \
+	/* byte `pass` of the (row, col) key, counting from the lowest byte of the column, which has   \
+	 * `cols` bytes in use */                                                                      \
+	static inline u64 _name##_kernel_digit(const _name##Element* e, u32 pass, u32 cols) {          \
+		return pass < cols ? ((u64)e->col >> (8 * pass)) & 0xff                                    \
+						   : ((u64)e->row >> (8 * (pass - cols))) & 0xff;                          \
+	}                                                                                              \
+                                                                                                   \
+	/* stable LSD radix sort on the (row, col) key, one byte per pass, skipping the bytes above    \
+	 * the largest index and the bytes every element shares; returns `e` or `tmp`, whichever ends  \
+	 * up with the sorted elements */                                                              \
+	static _name##Element* _name##_kernel_sort(_name##Element* e, u64 n, _name##Element* tmp) {    \
+		if (n <= MATRIX_SORT_SMALL) {                                                              \
+			for (u64 i = 1; i < n; ++i) {                                                          \
+				_name##Element x = e[i];                                                           \
+				u64			   j = i;                                                              \
+				for (; j > 0 && _name##_kernel_less(&x, e + j - 1); --j) {                         \
+					e[j] = e[j - 1];                                                               \
+				}                                                                                  \
+				e[j] = x;                                                                          \
+			}                                                                                      \
+			return e;                                                                              \
+		}                                                                                          \
+		u64 rows = 0, cols = 0;                                                                    \
+		for (u64 i = 0; i < n; ++i) {                                                              \
+			rows |= (u64)e[i].row;                                                                 \
+			cols |= (u64)e[i].col;                                                                 \
+		}                                                                                          \
+		u32 digits = 0, passes;                                                                    \
+		for (; cols; cols >>= 8) {                                                                 \
+			++digits;                                                                              \
+		}                                                                                          \
+		for (passes = digits; rows; rows >>= 8) {                                                  \
+			++passes;                                                                              \
+		}                                                                                          \
+                                                                                                   \
+		u64 count[256];                                                                            \
+		for (u32 pass = 0; pass < passes; ++pass) {                                                \
+			memset(count, 0, sizeof(count));                                                       \
+			for (u64 i = 0; i < n; ++i) {                                                          \
+				++count[_name##_kernel_digit(e + i, pass, digits)];                                \
+			}                                                                                      \
+			if (count[_name##_kernel_digit(e, pass, digits)] == n) {                               \
+				continue;                                                                          \
+			}                                                                                      \
+			for (u64 d = 0, at = 0; d < 256; ++d) {                                                \
+				u64 c = count[d];                                                                  \
+				count[d] = at;                                                                     \
+				at += c;                                                                           \
+			}                                                                                      \
+			for (u64 i = 0; i < n; ++i) {                                                          \
+				tmp[count[_name##_kernel_digit(e + i, pass, digits)]++] = e[i];                    \
+			}                                                                                      \
+			_name##Element* sorted = tmp;                                                          \
+			tmp = e;                                                                               \
+			e = sorted;                                                                            \
+		}                                                                                          \
+		return e;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_kernel_transpose(const _name##Element* a, u64 na, _index_type cols,        \
+										 u64* pos, _name##Element* out) {                          \
+		memset(pos, 0, sizeof(u64) * ((size_t)cols + 1));                                          \
+		for (u64 i = 0; i < na; ++i) {                                                             \
+			++pos[a[i].col + 1];                                                                   \
+		}                                                                                          \
+		for (_index_type c = 0; c < cols; ++c) {                                                   \
+			pos[c + 1] += pos[c];                                                                  \
+		}                                                                                          \
+		for (u64 i = 0; i < na; ++i) {                                                             \
+			out[pos[a[i].col]++] = (_name##Element){a[i].col, a[i].row, a[i].val};                 \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static bool _name##_kernel_sort_touched(_name##Workspace* w, u64 touched, _index_type cols) {  \
+		if (touched * touched > (u64)cols) {                                                       \
+			return false;                                                                          \
+		}                                                                                          \
+		for (u64 x = 1; x < touched; ++x) {                                                        \
+			_index_type c = w->list[x];                                                            \
+			u64			y = x;                                                                     \
+			for (; y > 0 && w->list[y - 1] > c; --y) {                                             \
+				w->list[y] = w->list[y - 1];                                                       \
+			}                                                                                      \
+			w->list[y] = c;                                                                        \
+		}                                                                                          \
+		return true;                                                                               \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_kernel_flush_row(_name##Workspace* w, u64 touched, _index_type row,         \
+										_index_type cols, _name##Element* out) {                   \
+		u64 n = 0;                                                                                 \
+		if (!_name##_kernel_sort_touched(w, touched, cols)) {                                      \
+			for (_index_type c = 0; c < cols; ++c) {                                               \
+				if (w->mark[c] == w->stamp) {                                                      \
+					n = _name##_kernel_emit(out, n, row, c, w->acc[c]);                            \
+				}                                                                                  \
+			}                                                                                      \
+			return n;                                                                              \
+		}                                                                                          \
+		for (u64 x = 0; x < touched; ++x) {                                                        \
+			n = _name##_kernel_emit(out, n, row, w->list[x], w->acc[w->list[x]]);                  \
+		}                                                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static inline void _name##_kernel_accumulate(_name##Workspace* w, u64* touched,                \
+												 _index_type col, _data_type val) {                \
+		if (w->mark[col] != w->stamp) {                                                            \
+			w->mark[col] = w->stamp;                                                               \
+			w->acc[col] = val;                                                                     \
+			w->list[(*touched)++] = col;                                                           \
+		} else {                                                                                   \
+			w->acc[col] += val;                                                                    \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_kernel_gemm(_data_type alpha, const _name##Element* a, u64 na,              \
+								   const _name##Element* b, _data_type beta,                       \
+								   const _name##Element* c, u64 nc, _index_type cols,              \
+								   _name##Workspace* w, u64 limit, bool* overflow,                 \
+								   _name##Element* out) {                                          \
+		u64 n = 0, i = 0, j = beta == 0 ? nc : 0;                                                  \
+		while (i < na || j < nc) {                                                                 \
+			_index_type row = j >= nc || (i < na && a[i].row <= c[j].row) ? a[i].row : c[j].row;   \
+			u64			touched = 0;                                                               \
+			++w->stamp;                                                                            \
+			for (; i < na && a[i].row == row; ++i) {                                               \
+				_data_type scaled = alpha * a[i].val;                                              \
+				for (u64 x = w->ptr[a[i].col]; x < w->ptr[a[i].col + 1]; ++x) {                    \
+					_name##_kernel_accumulate(w, &touched, b[x].col, scaled * b[x].val);           \
+				}                                                                                  \
+			}                                                                                      \
+			for (; j < nc && c[j].row == row; ++j) {                                               \
+				_name##_kernel_accumulate(w, &touched, c[j].col, beta * c[j].val);                 \
+			}                                                                                      \
+			if (out && n + touched > limit) {                                                      \
+				out = NULL;                                                                        \
+				*overflow = true;                                                                  \
+			}                                                                                      \
+			n += _name##_kernel_flush_row(w, touched, row, cols, out ? out + n : NULL);            \
+		}                                                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static bool _name##_kernel_gemm_fits(const _name##Element* a, u64 na,                          \
+										 const _name##Element* b, const _name##Element* c,         \
+										 u64 nc, _name##Workspace* w) {                            \
+		u64 i = 0, j = 0;                                                                          \
+		while (i < na) {                                                                           \
+			_index_type row = a[i].row;                                                            \
+			++w->stamp;                                                                            \
+			while (j < nc && c[j].row < row) {                                                     \
+				++j;                                                                               \
+			}                                                                                      \
+			for (; j < nc && c[j].row == row; ++j) {                                               \
+				w->mark[c[j].col] = w->stamp;                                                      \
+			}                                                                                      \
+			for (; i < na && a[i].row == row; ++i) {                                               \
+				for (u64 x = w->ptr[a[i].col]; x < w->ptr[a[i].col + 1]; ++x) {                    \
+					if (w->mark[b[x].col] != w->stamp) {                                           \
+						return false;                                                              \
+					}                                                                              \
+				}                                                                                  \
+			}                                                                                      \
+		}                                                                                          \
+		return true;                                                                               \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_kernel_gemm_inplace(_data_type alpha, const _name##Element* a, u64 na,      \
+										   const _name##Element* b, _data_type beta,               \
+										   _name##Element* c, u64 nc, _name##Workspace* w) {       \
+		u64 n = 0, i = 0, j = 0;                                                                   \
+		while (j < nc) {                                                                           \
+			_index_type row = c[j].row;                                                            \
+			u64			touched = 0, start = j;                                                    \
+			++w->stamp;                                                                            \
+			while (i < na && a[i].row < row) {                                                     \
+				++i;                                                                               \
+			}                                                                                      \
+			for (; i < na && a[i].row == row; ++i) {                                               \
+				_data_type scaled = alpha * a[i].val;                                              \
+				for (u64 x = w->ptr[a[i].col]; x < w->ptr[a[i].col + 1]; ++x) {                    \
+					_name##_kernel_accumulate(w, &touched, b[x].col, scaled * b[x].val);           \
+				}                                                                                  \
+			}                                                                                      \
+			for (; j < nc && c[j].row == row; ++j) {                                               \
+				_name##_kernel_accumulate(w, &touched, c[j].col, beta * c[j].val);                 \
+			}                                                                                      \
+			for (u64 x = start; x < j; ++x) {                                                      \
+				n = _name##_kernel_emit(c, n, row, c[x].col, w->acc[c[x].col]);                    \
+			}                                                                                      \
+		}                                                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_kernel_multiply(const _name##Element* a, u64 na, const _name##Element* b,   \
+									   u64 nb, _index_type inner, _index_type cols,                \
+									   _name##Workspace* w, _name##Element* out) {                 \
+		_name##_kernel_row_ptr(b, nb, inner, w->ptr);                                              \
+		return _name##_kernel_gemm(1, a, na, b, 0, NULL, 0, cols, w, UINT64_MAX, NULL, out);       \
+	}                                                                                              \
+                                                                                                   \
+	static inline u64 _name##_kernel_mask_end(const _name##Element* m, u64 nm, u64 j) {            \
+		_index_type row = m[j].row;                                                                \
+		while (j < nm && m[j].row == row) {                                                        \
+			++j;                                                                                   \
+		}                                                                                          \
+		return j;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static inline void _name##_kernel_mask_cost(const _name##Element* a, const u64* a_ptr,         \
+												const u64* b_ptr, const u64* bt_ptr,               \
+												const _name##Element* m, u64 begin, u64 end,       \
+												u64* acc, u64* dot) {                              \
+		_index_type row = m[begin].row;                                                            \
+		u64			len = a_ptr[row + 1] - a_ptr[row];                                             \
+		*acc = end - begin;                                                                        \
+		*dot = 0;                                                                                  \
+		for (u64 x = a_ptr[row]; x < a_ptr[row + 1]; ++x) {                                        \
+			*acc += b_ptr[a[x].col + 1] - b_ptr[a[x].col];                                         \
+		}                                                                                          \
+		for (u64 x = begin; x < end; ++x) {                                                        \
+			*dot += len + bt_ptr[m[x].col + 1] - bt_ptr[m[x].col];                                 \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_kernel_masked_saving(const _name##Element* a, const u64* a_ptr,             \
+											const u64* b_ptr, const u64* bt_ptr,                   \
+											const _name##Element* m, u64 nm) {                     \
+		u64 saved = 0, acc, dot;                                                                   \
+		for (u64 j = 0; j < nm;) {                                                                 \
+			u64 end = _name##_kernel_mask_end(m, nm, j);                                           \
+			_name##_kernel_mask_cost(a, a_ptr, b_ptr, bt_ptr, m, j, end, &acc, &dot);              \
+			saved += dot < acc ? acc - dot : 0;                                                    \
+			j = end;                                                                               \
+		}                                                                                          \
+		return saved;                                                                              \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_kernel_masked(const _name##Element* a, const u64* a_ptr,                    \
+									 const _name##Element* b, const _name##Element* bt,            \
+									 const u64* bt_ptr, const _name##Element* m, u64 nm,           \
+									 _name##Workspace* w, _name##Element* out) {                   \
+		u64 n = 0;                                                                                 \
+		for (u64 j = 0; j < nm;) {                                                                 \
+			u64			end = _name##_kernel_mask_end(m, nm, j);                                   \
+			_index_type row = m[j].row;                                                            \
+			if (a_ptr[row] == a_ptr[row + 1]) {                                                    \
+				j = end;                                                                           \
+				continue;                                                                          \
+			}                                                                                      \
+			u64 acc = 0, dot = 0;                                                                  \
+			if (bt) {                                                                              \
+				_name##_kernel_mask_cost(a, a_ptr, w->ptr, bt_ptr, m, j, end, &acc, &dot);         \
+			}                                                                                      \
+			if (dot < acc) {                                                                       \
+				for (; j < end; ++j) {                                                             \
+					u64		   x = a_ptr[row], y = bt_ptr[m[j].col];                               \
+					_data_type sum = 0;                                                            \
+					while (x < a_ptr[row + 1] && y < bt_ptr[m[j].col + 1]) {                       \
+						if (a[x].col < bt[y].col) {                                                \
+							++x;                                                                   \
+						} else if (a[x].col > bt[y].col) {                                         \
+							++y;                                                                   \
+						} else {                                                                   \
+							sum += a[x++].val * bt[y++].val;                                       \
+						}                                                                          \
+					}                                                                              \
+					n = _name##_kernel_emit(out, n, row, m[j].col, sum);                           \
+				}                                                                                  \
+				continue;                                                                          \
+			}                                                                                      \
+			++w->stamp;                                                                            \
+			for (u64 x = j; x < end; ++x) {                                                        \
+				w->mark[m[x].col] = w->stamp;                                                      \
+				w->acc[m[x].col] = 0;                                                              \
+			}                                                                                      \
+			for (u64 x = a_ptr[row]; x < a_ptr[row + 1]; ++x) {                                    \
+				for (u64 y = w->ptr[a[x].col]; y < w->ptr[a[x].col + 1]; ++y) {                    \
+					if (w->mark[b[y].col] == w->stamp) {                                           \
+						w->acc[b[y].col] += a[x].val * b[y].val;                                   \
+					}                                                                              \
+				}                                                                                  \
+			}                                                                                      \
+			for (; j < end; ++j) {                                                                 \
+				n = _name##_kernel_emit(out, n, row, m[j].col, w->acc[m[j].col]);                  \
+			}                                                                                      \
+		}                                                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_kernel_masked_complement(const _name##Element* a, u64 na,                   \
+												const _name##Element* b, const _name##Element* m,  \
+												u64 nm, _index_type cols, _name##Workspace* w,     \
+												u64 limit, bool* overflow, _name##Element* out) {  \
+		u64 n = 0, i = 0, j = 0;                                                                   \
+		while (i < na) {                                                                           \
+			_index_type row = a[i].row;                                                            \
+			u64			touched = 0, blocked;                                                      \
+			w->stamp += 2;                                                                         \
+			blocked = w->stamp - 1;                                                                \
+			while (j < nm && m[j].row < row) {                                                     \
+				++j;                                                                               \
+			}                                                                                      \
+			for (; j < nm && m[j].row == row; ++j) {                                               \
+				w->mark[m[j].col] = blocked;                                                       \
+			}                                                                                      \
+			for (; i < na && a[i].row == row; ++i) {                                               \
+				for (u64 x = w->ptr[a[i].col]; x < w->ptr[a[i].col + 1]; ++x) {                    \
+					if (w->mark[b[x].col] != blocked) {                                            \
+						_name##_kernel_accumulate(w, &touched, b[x].col, a[i].val * b[x].val);     \
+					}                                                                              \
+				}                                                                                  \
+			}                                                                                      \
+			if (out && n + touched > limit) {                                                      \
+				out = NULL;                                                                        \
+				*overflow = true;                                                                  \
+			}                                                                                      \
+			n += _name##_kernel_flush_row(w, touched, row, cols, out ? out + n : NULL);            \
+		}                                                                                          \
+		return n;                                                                                  \
+	}
 
 #define MATRIX_METHOD(_name, _data_type, _index_type)                                              \
+	static const MatrixAllocator* _name##_hook = NULL;                                             \
+                                                                                                   \
+	static const MatrixAllocator* _name##_allocator() {                                            \
+		return _name##_hook ? _name##_hook : matrix_allocator_get();                               \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_use_allocator(const MatrixAllocator* allocator) { _name##_hook = allocator; }     \
+                                                                                                   \
+	static u64 _name##_name_bytes(_name* m) {                                                      \
+		return m->name && m->name != m->label ? strlen(m->name) + 1 : 0;                           \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_set_name(_name* m, const char* name) {                                     \
+		if (name == m->name) {                                                                     \
+			return;                                                                                \
+		}                                                                                          \
+		if (m->name != m->label) {                                                                 \
+			MATRIX_TRACE_RELEASE(_name##_name_bytes(m));                                           \
+			matrix_release(_name##_allocator(), m->name);                                          \
+		}                                                                                          \
+		if (name == NULL) {                                                                        \
+			m->name = NULL;                                                                        \
+			return;                                                                                \
+		}                                                                                          \
+		u64 length = strlen(name);                                                                 \
+		if (length < MATRIX_NAME_INLINE) {                                                         \
+			m->name = m->label;                                                                    \
+		} else {                                                                                   \
+			m->name = matrix_alloc(_name##_allocator(), length + 1);                               \
+			MATRIX_TRACE_ALLOC(length + 1);                                                        \
+		}                                                                                          \
+		memmove(m->name, name, length + 1);                                                        \
+	}                                                                                              \
+                                                                                                   \
 	_name* _name##_new(_index_type row, _index_type col) {                                         \
-		_name* m = malloc(sizeof(_name));                                                          \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* m = matrix_alloc(_name##_allocator(), sizeof(_name));                               \
 		m->size = 1;                                                                               \
-		m->data = malloc(sizeof(_name##Element) * (1 << 1));                                       \
+		m->tags = 0;                                                                               \
+		m->reallocs = 0;                                                                           \
+		m->data = buffer_alloc(matrix_allocator_resolve(_name##_hook),                             \
+							   sizeof(_name##Element) * (1 << 1));                                 \
+		MATRIX_TRACE_ALLOC(sizeof(_name));                                                         \
+		MATRIX_TRACE_ALLOC(sizeof(_name##Element) * (1 << 1));                                     \
 		m->data[0] = (_name##Element){row, col, 0};                                                \
-		m->name = random_name(4);                                                                  \
+		m->name = NULL;                                                                            \
 		return m;                                                                                  \
 	}                                                                                              \
                                                                                                    \
 	_name* _name##_identity(_index_type size) {                                                    \
-		_name* m = malloc(sizeof(_name));                                                          \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* m = matrix_alloc(_name##_allocator(), sizeof(_name));                               \
 		u64	   init_size = 1, tmp = size;                                                          \
 		while (tmp >>= 1) {                                                                        \
 			++init_size;                                                                           \
 		}                                                                                          \
 		m->size = init_size;                                                                       \
-		m->data = malloc(sizeof(_name##Element) * (1 << init_size));                               \
+		m->tags = matrix_structure_close(MATRIX_STRUCTURE_IDENTITY);                               \
+		m->reallocs = 0;                                                                           \
+		m->data = buffer_alloc(matrix_allocator_resolve(_name##_hook),                             \
+							   sizeof(_name##Element) * ((u64)1 << init_size));                    \
+		MATRIX_TRACE_ALLOC(sizeof(_name));                                                         \
+		MATRIX_TRACE_ALLOC(sizeof(_name##Element) * ((u64)1 << init_size));                        \
 		m->data[0] = (_name##Element){size, size, size};                                           \
 		for (u64 i = 0; i < size; ++i) {                                                           \
 			m->data[i + 1] = (_name##Element){i, i, 1};                                            \
 		}                                                                                          \
-		m->name = random_name(4);                                                                  \
+		m->name = NULL;                                                                            \
 		return m;                                                                                  \
 	}                                                                                              \
                                                                                                    \
+	_name* _name##_clone(_name* m) {                                                               \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* c = matrix_alloc(_name##_allocator(), sizeof(_name));                               \
+		c->size = m->size;                                                                         \
+		c->tags = m->tags;                                                                         \
+		c->reallocs = 0;                                                                           \
+		c->data = m->data;                                                                         \
+		MATRIX_TRACE_ALLOC(sizeof(_name));                                                         \
+		c->name = NULL;                                                                            \
+		_name##_set_name(c, m->name);                                                              \
+		buffer_retain(c->data);                                                                    \
+		return c;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_capacity(_name* m) { return sizeof(_name##Element) << m->size; }            \
+                                                                                                   \
 	void _name##_free(_name* m) {                                                                  \
-		free(m->data);                                                                             \
-		free(m->name);                                                                             \
-		free(m);                                                                                   \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		MATRIX_TRACE_RELEASE(sizeof(_name) + (buffer_shared(m->data) ? 0 : _name##_capacity(m)));  \
+		buffer_release(m->data);                                                                   \
+		_name##_set_name(m, NULL);                                                                 \
+		matrix_release(_name##_allocator(), m);                                                    \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_resize(_name* m, u8 size) {                                                \
+		MATRIX_TRACE_RESIZE(buffer_shared(m->data) ? 0 : _name##_capacity(m),                      \
+							sizeof(_name##Element) << size);                                       \
+		++m->reallocs;                                                                             \
+		m->data = buffer_resize(m->data, sizeof(_name##Element) * ((u64)1 << size),                \
+								sizeof(_name##Element) * ((u64)m->data[0].val + 1));               \
+		m->size = size;                                                                            \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_unshare(_name* m) {                                                        \
+		m->tags = 0;                                                                               \
+		if (buffer_shared(m->data)) {                                                              \
+			_name##_resize(m, m->size);                                                            \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_detach(_name* m) {                                                         \
+		m->tags = 0;                                                                               \
+		if (buffer_shared(m->data)) {                                                              \
+			_name##Element* data = buffer_alloc(matrix_allocator_resolve(_name##_hook),            \
+												sizeof(_name##Element) * ((u64)1 << m->size));     \
+			data[0] = m->data[0];                                                                  \
+			buffer_release(m->data);                                                               \
+			m->data = data;                                                                        \
+			MATRIX_TRACE_ALLOC(_name##_capacity(m));                                               \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_reserve(_name* m, u64 nnz) {                                                      \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		u8 size = m->size;                                                                         \
+		while (((u64)1 << size) <= nnz) {                                                          \
+			++size;                                                                                \
+		}                                                                                          \
+		m->tags = 0;                                                                               \
+		if (size != m->size || buffer_shared(m->data)) {                                           \
+			_name##_resize(m, size);                                                               \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	MatrixMemory _name##_memory(_name* m) {                                                        \
+		u64 used = sizeof(_name##Element) * ((u64)m->data[0].val + 1);                             \
+		u64 capacity = _name##_capacity(m);                                                        \
+		u64 overhead = sizeof(_name) + _name##_name_bytes(m);                                      \
+		return (MatrixMemory){used, capacity, capacity - used, overhead, m->reallocs,              \
+							  buffer_shared(m->data)};                                             \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_assign(_name* out, _name* m) {                                             \
+		if (out != m) {                                                                            \
+			buffer_retain(m->data);                                                                \
+			MATRIX_TRACE_RELEASE(buffer_shared(out->data) ? 0 : _name##_capacity(out));            \
+			buffer_release(out->data);                                                             \
+			out->data = m->data;                                                                   \
+			out->size = m->size;                                                                   \
+			out->tags = m->tags;                                                                   \
+		}                                                                                          \
 	}                                                                                              \
                                                                                                    \
-	void _name##_rename(_name* m, char* name) {                                                    \
-		free(m->name);                                                                             \
-		m->name = strdup(name);                                                                    \
+	static void _name##_swap(_name* a, _name* b) {                                                 \
+		_name##Element* data = a->data;                                                            \
+		u8				size = a->size, tags = a->tags;                                            \
+		a->data = b->data;                                                                         \
+		a->size = b->size;                                                                         \
+		a->tags = b->tags;                                                                         \
+		b->data = data;                                                                            \
+		b->size = size;                                                                            \
+		b->tags = tags;                                                                            \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_rename(_name* m, const char* name) {                                              \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_set_name(m, name);                                                                 \
+	}                                                                                              \
+                                                                                                   \
+	const char* _name##_get_name(_name* m) {                                                       \
+		if (m->name == NULL) {                                                                     \
+			random_fill(m->label, 4);                                                              \
+			m->name = m->label;                                                                    \
+		}                                                                                          \
+		return m->name;                                                                            \
 	}                                                                                              \
                                                                                                    \
 	_name##Found _name##_find(_name* m, _index_type row, _index_type col) {                        \
@@ -105,6 +774,7 @@
 	}                                                                                              \
                                                                                                    \
 	void _name##_set(_name* m, _index_type row, _index_type col, _data_type val) {                 \
+		MATRIX_TRACE_SCOPE();                                                                      \
 		PRINT("\x1b[93m" #_name "_set %d %d %d start\x1b[m\n", row, col, val);                     \
 		if (_name##_out_range(m, row, col)) {                                                      \
 			return;                                                                                \
@@ -112,6 +782,7 @@
 		_name##Found found = _name##_find(m, row, col);                                            \
 		if (val == 0) {                                                                            \
 			if (found.exists) {                                                                    \
+				_name##_unshare(m);                                                                \
 				for (_index_type i = found.index; i < m->data[0].val; ++i) {                       \
 					m->data[i] = m->data[i + 1];                                                   \
 				}                                                                                  \
@@ -121,12 +792,10 @@
 			return;                                                                                \
 		}                                                                                          \
 		if (found.exists) {                                                                        \
+			_name##_unshare(m);                                                                    \
 			m->data[found.index].val = val;                                                        \
 		} else {                                                                                   \
-			if ((1 << m->size) <= m->data[0].val + 1) {                                            \
-				PRINT("Reallocating to %d\n", 1 << (m->size + 1));                                 \
-				m->data = realloc(m->data, sizeof(_name##Element) * (1 << ++m->size));             \
-			}                                                                                      \
+			_name##_reserve(m, m->data[0].val + 1);                                                \
 			for (_index_type i = m->data[0].val; i >= found.index; --i) {                          \
 				PRINT("Moving %d to %d\n", i, i + 1);                                              \
 				memcpy(m->data + i + 1, m->data + i, sizeof(_name##Element));                      \
@@ -149,14 +818,72 @@
 		}                                                                                          \
 	}                                                                                              \
                                                                                                    \
-	_data_type* _name##_to_1d(_name* m) {                                                          \
-		_data_type* arr = malloc(sizeof(_data_type) * m->data[0].row * m->data[0].col);            \
-		for (_index_type i = 0; i < m->data[0].row * m->data[0].col; ++i) {                        \
-			arr[i] = 0;                                                                            \
+	typedef struct _name##DenseJob {                                                               \
+		_name##Element* e;                                                                         \
+		_index_type		cols;                                                                      \
+		_data_type*		flat;                                                                      \
+		_data_type**	rows;                                                                      \
+		u64*			count;                                                                     \
+	} _name##DenseJob;                                                                             \
+                                                                                                   \
+	static inline _data_type* _name##_dense_at(_name##DenseJob* job, _index_type row,              \
+											   _index_type col) {                                  \
+		return job->flat ? job->flat + (u64)row * job->cols + col : job->rows[row] + col;          \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_dense_scatter_task(void* ctx, u64 begin, u64 end) {                        \
+		_name##DenseJob* job = ctx;                                                                \
+		for (u64 i = begin; i < end; ++i) {                                                        \
+			*_name##_dense_at(job, job->e[i].row, job->e[i].col) = job->e[i].val;                  \
 		}                                                                                          \
-		for (_index_type i = 1; i <= m->data[0].val; ++i) {                                        \
-			arr[m->data[i].row * m->data[0].col + m->data[i].col] = m->data[i].val;                \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_dense_count_task(void* ctx, u64 begin, u64 end) {                          \
+		_name##DenseJob* job = ctx;                                                                \
+		for (u64 r = begin; r < end; ++r) {                                                        \
+			u64 n = 0;                                                                             \
+			for (_index_type c = 0; c < job->cols; ++c) {                                          \
+				n += *_name##_dense_at(job, r, c) != 0;                                            \
+			}                                                                                      \
+			job->count[r + 1] = n;                                                                 \
 		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_dense_gather_task(void* ctx, u64 begin, u64 end) {                         \
+		_name##DenseJob* job = ctx;                                                                \
+		for (u64 r = begin; r < end; ++r) {                                                        \
+			u64 n = job->count[r];                                                                 \
+			for (_index_type c = 0; c < job->cols; ++c) {                                          \
+				_data_type val = *_name##_dense_at(job, r, c);                                     \
+				if (val != 0) {                                                                    \
+					job->e[n++] = (_name##Element){r, c, val};                                     \
+				}                                                                                  \
+			}                                                                                      \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	/* rows are counted in parallel first, so every row knows where its elements go */             \
+	static _name* _name##_from_dense(_name##DenseJob* job, _index_type row, _index_type col) {     \
+		_name* m = _name##_new(row, col);                                                          \
+		u64	   grain = MATRIX_PARALLEL_GRAIN / ((u64)col + 1) + 1;                                 \
+		job->count = scratch_alloc(sizeof(u64) * ((u64)row + 1));                                  \
+		job->count[0] = 0;                                                                         \
+		parallel_for(row, grain, _name##_dense_count_task, job);                                   \
+		for (_index_type r = 0; r < row; ++r) {                                                    \
+			job->count[r + 1] += job->count[r];                                                    \
+		}                                                                                          \
+		_name##_reserve(m, job->count[row]);                                                       \
+		job->e = m->data + 1;                                                                      \
+		parallel_for(row, grain, _name##_dense_gather_task, job);                                  \
+		m->data[0].val = job->count[row];                                                          \
+		scratch_free(job->count);                                                                  \
+		return m;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	_data_type* _name##_to_1d(_name* m) {                                                          \
+		_data_type*		arr = calloc((u64)m->data[0].row * m->data[0].col, sizeof(_data_type));    \
+		_name##DenseJob job = {m->data + 1, m->data[0].col, arr, NULL, NULL};                      \
+		parallel_for(m->data[0].val, MATRIX_PARALLEL_GRAIN, _name##_dense_scatter_task, &job);     \
 		return arr;                                                                                \
 	}                                                                                              \
                                                                                                    \
@@ -165,13 +892,14 @@
 		for (_index_type i = 0; i < m->data[0].row; ++i) {                                         \
 			arr[i] = calloc(m->data[0].col, sizeof(_data_type));                                   \
 		}                                                                                          \
-		for (_index_type i = 1; i <= m->data[0].val; ++i) {                                        \
-			arr[m->data[i].row][m->data[i].col] = m->data[i].val;                                  \
-		}                                                                                          \
+		_name##DenseJob job = {m->data + 1, m->data[0].col, NULL, arr, NULL};                      \
+		parallel_for(m->data[0].val, MATRIX_PARALLEL_GRAIN, _name##_dense_scatter_task, &job);     \
 		return arr;                                                                                \
 	}                                                                                              \
                                                                                                    \
 	void _name##_reshape(_name* m, _index_type row, _index_type col) {                             \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_unshare(m);                                                                        \
 		m->data[0].row = row;                                                                      \
 		m->data[0].col = col;                                                                      \
                                                                                                    \
@@ -183,222 +911,562 @@
 		}                                                                                          \
 	}                                                                                              \
                                                                                                    \
-	_name* _name##_transpose(_name* m) {                                                           \
-		_name* t = _name##_new(m->data[0].col, m->data[0].row);                                    \
-		while ((1 << t->size) <= m->data[0].val + 1) {                                             \
-			t->data = realloc(t->data, sizeof(_name##Element) * (1 << (++t->size)));               \
+	typedef struct _name##TransposeJob {                                                           \
+		const _name##Element* a;                                                                   \
+		_index_type			  cols;                                                                \
+		u64*				  bound;                                                               \
+		u64*				  pos;                                                                 \
+		_name##Element*		  out;                                                                 \
+	} _name##TransposeJob;                                                                         \
+                                                                                                   \
+	static void _name##_transpose_count_task(void* ctx, u64 begin, u64 end) {                      \
+		_name##TransposeJob* job = ctx;                                                            \
+		for (u64 x = begin; x < end; ++x) {                                                        \
+			u64* pos = job->pos + x * job->cols;                                                   \
+			memset(pos, 0, sizeof(u64) * job->cols);                                               \
+			for (u64 i = job->bound[x]; i < job->bound[x + 1]; ++i) {                              \
+				++pos[job->a[i].col];                                                              \
+			}                                                                                      \
 		}                                                                                          \
+	}                                                                                              \
                                                                                                    \
-		_index_type row_terms[m->data[0].col];                                                     \
-		_index_type starting_pos[m->data[0].col];                                                  \
-		memset(row_terms, 0, sizeof(_index_type) * (size_t)m->data[0].col);                        \
-		memset(starting_pos, 0, sizeof(_index_type) * (size_t)m->data[0].col);                     \
-                                                                                                   \
-		for (_index_type i = 1; i <= m->data[0].val; ++i) {                                        \
-			++row_terms[m->data[i].col];                                                           \
+	static void _name##_transpose_scatter_task(void* ctx, u64 begin, u64 end) {                    \
+		_name##TransposeJob* job = ctx;                                                            \
+		for (u64 x = begin; x < end; ++x) {                                                        \
+			u64* pos = job->pos + x * job->cols;                                                   \
+			for (u64 i = job->bound[x]; i < job->bound[x + 1]; ++i) {                              \
+				const _name##Element* e = job->a + i;                                              \
+				job->out[pos[e->col]++] = (_name##Element){e->col, e->row, e->val};                \
+			}                                                                                      \
 		}                                                                                          \
+	}                                                                                              \
                                                                                                    \
-		starting_pos[0] = 1;                                                                       \
-		for (_index_type i = 1; i < m->data[0].col; ++i) {                                         \
-			starting_pos[i] = starting_pos[i - 1] + row_terms[i - 1];                              \
+	static bool _name##_transpose_parallel(_name* out, _name* m) {                                 \
+		u64 na = m->data[0].val, cols = m->data[0].col, blocks = parallel_threads();               \
+		/* every block counts every column, so keep the counts below the number of elements */     \
+		if (blocks > na / (cols + 1)) {                                                            \
+			blocks = na / (cols + 1);                                                              \
+		}                                                                                          \
+		if (na < MATRIX_PARALLEL_GRAIN || blocks < 2) {                                            \
+			return false;                                                                          \
+		}                                                                                          \
+		u64* bound = scratch_alloc(sizeof(u64) * (blocks + 1));                                    \
+		u64* pos = scratch_alloc(sizeof(u64) * blocks * cols);                                     \
+		for (u64 x = 0; x <= blocks; ++x) {                                                        \
+			bound[x] = na * x / blocks;                                                            \
+		}                                                                                          \
+		_name##TransposeJob job = {m->data + 1, cols, bound, pos, out->data + 1};                  \
+		parallel_for(blocks, 1, _name##_transpose_count_task, &job);                               \
+		u64 at = 0;                                                                                \
+		for (u64 c = 0; c < cols; ++c) {                                                           \
+			for (u64 x = 0; x < blocks; ++x) {                                                     \
+				u64 count = pos[x * cols + c];                                                     \
+				pos[x * cols + c] = at;                                                            \
+				at += count;                                                                       \
+			}                                                                                      \
 		}                                                                                          \
+		parallel_for(blocks, 1, _name##_transpose_scatter_task, &job);                             \
+		scratch_free(pos);                                                                         \
+		scratch_free(bound);                                                                       \
+		return true;                                                                               \
+	}                                                                                              \
                                                                                                    \
-		for (_index_type i = 1; i <= m->data[0].val; ++i) {                                        \
-			_index_type idx = starting_pos[m->data[i].col]++;                                      \
-			t->data[idx].row = m->data[i].col;                                                     \
-			t->data[idx].col = m->data[i].row;                                                     \
-			t->data[idx].val = m->data[i].val;                                                     \
+	void _name##_transpose_into(_name* out, _name* m) {                                            \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		u8 tags = _name##_structure(m);                                                            \
+		if (tags & MATRIX_STRUCTURE_SYMMETRIC) {                                                   \
+			_name##_assign(out, m);                                                                \
+			return;                                                                                \
 		}                                                                                          \
-		t->data[0].val = m->data[0].val;                                                           \
+		_name##_reserve(out, m->data[0].val);                                                      \
+		if (!_name##_transpose_parallel(out, m)) {                                                 \
+			_name##Workspace w = _name##_workspace_new(m->data[0].col, 0);                         \
+			_name##_kernel_transpose(m->data + 1, m->data[0].val, m->data[0].col, w.ptr,           \
+									 out->data + 1);                                               \
+			_name##_workspace_free(&w);                                                            \
+		}                                                                                          \
+		out->data[0] = (_name##Element){m->data[0].col, m->data[0].row, m->data[0].val};           \
+		out->tags = matrix_structure_transpose(tags);                                              \
+	}                                                                                              \
                                                                                                    \
+	_name* _name##_transpose(_name* m) {                                                           \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* t = _name##_new(m->data[0].col, m->data[0].row);                                    \
+		_name##_transpose_into(t, m);                                                              \
 		return t;                                                                                  \
 	}                                                                                              \
                                                                                                    \
-	_name* _name##_add(_name* a, _name* b) {                                                       \
-		_name*		m = _name##_new(a->data[0].row, a->data[0].col);                               \
-		_index_type i = 1, j = 1;                                                                  \
-		while (i <= a->data[0].val && j <= b->data[0].val) {                                       \
-			if (a->data[i].row < b->data[j].row) {                                                 \
-				_name##_set(m, a->data[i].row, a->data[i].col, a->data[i].val);                    \
-				++i;                                                                               \
-			} else if (a->data[i].row > b->data[j].row) {                                          \
-				_name##_set(m, b->data[j].row, b->data[j].col, b->data[j].val);                    \
-				++j;                                                                               \
-			} else {                                                                               \
-				if (a->data[i].col < b->data[j].col) {                                             \
-					_name##_set(m, a->data[i].row, a->data[i].col, a->data[i].val);                \
-					++i;                                                                           \
-				} else if (a->data[i].col > b->data[j].col) {                                      \
-					_name##_set(m, b->data[j].row, b->data[j].col, b->data[j].val);                \
-					++j;                                                                           \
-				} else {                                                                           \
-					_name##_set(m, a->data[i].row, a->data[i].col,                                 \
-								a->data[i].val + b->data[j].val);                                  \
-					++i, ++j;                                                                      \
-				}                                                                                  \
-			}                                                                                      \
+	void _name##_scale_into(_name* out, _name* m, _data_type scalar) {                             \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		u8 tags = scalar == 1 ? m->tags : m->tags & ~MATRIX_STRUCTURE_IDENTITY;                    \
+		_name##_reserve(out, m->data[0].val);                                                      \
+		out->data[0].val =                                                                         \
+			_name##_kernel_scale(m->data + 1, m->data[0].val, scalar, out->data + 1);              \
+		out->data[0].row = m->data[0].row;                                                         \
+		out->data[0].col = m->data[0].col;                                                         \
+		out->tags = tags;                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_scale_inplace(_name* m, _data_type scalar) { _name##_scale_into(m, m, scalar); }  \
+                                                                                                   \
+	_name* _name##_scale(_name* m, _data_type scalar) {                                            \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* n = _name##_new(m->data[0].row, m->data[0].col);                                    \
+		_name##_scale_into(n, m, scalar);                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_axpby_into(_name* out, _data_type alpha, _name* a, _data_type beta, _name* b) {   \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		if (b->data[0].val == 0 || a->data[0].val == 0) {                                          \
+			_name##_scale_into(out, b->data[0].val == 0 ? a : b,                                   \
+							   b->data[0].val == 0 ? alpha : beta);                                \
+			return;                                                                                \
 		}                                                                                          \
+		u8 tags = matrix_structure_ewise(a->tags, b->tags);                                        \
+		_name##_reserve(out, a->data[0].val + b->data[0].val);                                     \
+		out->data[0].val = _name##_kernel_axpby(alpha, a->data + 1, a->data[0].val, beta,          \
+												b->data + 1, b->data[0].val, out->data + 1);       \
+		out->data[0].row = a->data[0].row;                                                         \
+		out->data[0].col = a->data[0].col;                                                         \
+		out->tags = tags;                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_axpby(_data_type alpha, _name* a, _data_type beta, _name* b) {                  \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* m = _name##_new(a->data[0].row, a->data[0].col);                                    \
+		_name##_axpby_into(m, alpha, a, beta, b);                                                  \
+		return m;                                                                                  \
+	}                                                                                              \
                                                                                                    \
-		while (i <= a->data[0].val) {                                                              \
-			_name##_set(m, a->data[i].row, a->data[i].col, a->data[i].val);                        \
-			++i;                                                                                   \
+	static bool _name##_multiply_structured(_name* out, _name* a, _name* b) {                      \
+		u8 ta = _name##_structure(a), tb = _name##_structure(b);                                   \
+		if ((ta | tb) & MATRIX_STRUCTURE_ZERO) {                                                   \
+			_name##_detach(out);                                                                   \
+			out->data[0] = (_name##Element){a->data[0].row, b->data[0].col, 0};                    \
+			return true;                                                                           \
 		}                                                                                          \
+		if (ta & MATRIX_STRUCTURE_IDENTITY) {                                                      \
+			_name##_assign(out, b);                                                                \
+			return true;                                                                           \
+		}                                                                                          \
+		if (tb & MATRIX_STRUCTURE_IDENTITY) {                                                      \
+			_name##_assign(out, a);                                                                \
+			return true;                                                                           \
+		}                                                                                          \
+		if (!((ta | tb) & MATRIX_STRUCTURE_DIAGONAL)) {                                            \
+			return false;                                                                          \
+		}                                                                                          \
+		bool   rows = ta & MATRIX_STRUCTURE_DIAGONAL;                                              \
+		_name* d = rows ? a : b;                                                                   \
+		_name* m = rows ? b : a;                                                                   \
+		u8	   kept = MATRIX_STRUCTURE_DIAGONAL | MATRIX_STRUCTURE_UPPER | MATRIX_STRUCTURE_LOWER; \
+		if ((rows ? ta : tb) & MATRIX_STRUCTURE_SCALED_IDENTITY) {                                 \
+			kept |= MATRIX_STRUCTURE_SCALED_IDENTITY | MATRIX_STRUCTURE_SYMMETRIC;                 \
+		}                                                                                          \
+		u8 tags = matrix_structure_close((rows ? tb : ta) & kept);                                 \
+		_name##_reserve(out, m->data[0].val);                                                      \
+		u64 n = _name##_kernel_diagonal(m->data + 1, m->data[0].val, d->data + 1, d->data[0].val,  \
+										d->data[0].row, rows, out->data + 1);                      \
+		out->data[0] = (_name##Element){a->data[0].row, b->data[0].col, n};                        \
+		out->tags = tags;                                                                          \
+		return true;                                                                               \
+	}                                                                                              \
                                                                                                    \
-		while (j <= b->data[0].val) {                                                              \
-			_name##_set(m, b->data[j].row, b->data[j].col, b->data[j].val);                        \
-			++j;                                                                                   \
+	typedef struct _name##MultiplyJob {                                                            \
+		const _name##Element* a;                                                                   \
+		const _name##Element* b;                                                                   \
+		_index_type			  cols;                                                                \
+		u64*				  ptr;                                                                 \
+		u64*				  bound;                                                               \
+		u64*				  offset;                                                              \
+		_name##Element*		  out;                                                                 \
+		MatrixContext*		  ctx;                                                                 \
+		u64					  done;                                                                \
+		u64					  total;                                                               \
+	} _name##MultiplyJob;                                                                          \
+                                                                                                   \
+	static void _name##_multiply_task(void* ctx, u64 begin, u64 end) {                             \
+		_name##MultiplyJob* job = ctx;                                                             \
+		_name##Workspace	w = _name##_workspace_new(0, job->cols);                               \
+		u64*				own = w.ptr;                                                           \
+		w.ptr = job->ptr;                                                                          \
+		for (u64 x = begin; x < end; ++x) {                                                        \
+			u64 done = __atomic_load_n(&job->done, __ATOMIC_RELAXED);                              \
+			if (job->ctx && !matrix_context_check(job->ctx, done, job->total)) {                   \
+				break;                                                                             \
+			}                                                                                      \
+			const _name##Element* a = job->a + job->bound[x];                                      \
+			u64					  na = job->bound[x + 1] - job->bound[x];                          \
+			_name##Element*		  out = job->out ? job->out + job->offset[x] : NULL;               \
+			u64 n = _name##_kernel_gemm(1, a, na, job->b, 0, NULL, 0, job->cols, &w, UINT64_MAX,   \
+										NULL, out);                                                \
+			if (out == NULL) {                                                                     \
+				job->offset[x] = n;                                                                \
+			}                                                                                      \
+			__atomic_add_fetch(&job->done, 1, __ATOMIC_RELAXED);                                   \
 		}                                                                                          \
+		w.ptr = own;                                                                               \
+		_name##_workspace_free(&w);                                                                \
+	}                                                                                              \
                                                                                                    \
-		return m;                                                                                  \
+	/* the rows of `a` are split into blocks, which are counted first, then written in place, and  \
+	 * the context is checked before every block; returns false if it stopped the product */       \
+	static bool _name##_multiply_blocks(_name* out, _name* a, _name* b, u64 blocks,                \
+										MatrixContext* ctx) {                                      \
+		u64	 na = a->data[0].val;                                                                  \
+		u64* ptr = scratch_alloc(sizeof(u64) * ((u64)a->data[0].col + 1));                         \
+		u64* bound = scratch_alloc(sizeof(u64) * (blocks + 1));                                    \
+		u64* offset = scratch_alloc(sizeof(u64) * blocks);                                         \
+		_name##_kernel_row_ptr(b->data + 1, b->data[0].val, a->data[0].col, ptr);                  \
+		_name##_kernel_row_blocks(a->data + 1, na, blocks, bound);                                 \
+                                                                                                   \
+		_name##MultiplyJob job = {a->data + 1, b->data + 1, b->data[0].col, ptr, bound, offset,    \
+								  NULL, ctx, 0, 2 * blocks};                                       \
+		parallel_for(blocks, 1, _name##_multiply_task, &job);                                      \
+		bool stopped = ctx && matrix_context_stopped(ctx);                                         \
+		if (!stopped) {                                                                            \
+			u64 nnz = 0;                                                                           \
+			for (u64 x = 0; x < blocks; ++x) {                                                     \
+				u64 count = offset[x];                                                             \
+				offset[x] = nnz;                                                                   \
+				nnz += count;                                                                      \
+			}                                                                                      \
+			_name##_detach(out);                                                                   \
+			out->data[0].val = 0;                                                                  \
+			_name##_reserve(out, nnz);                                                             \
+			job.out = out->data + 1;                                                               \
+			parallel_for(blocks, 1, _name##_multiply_task, &job);                                  \
+			stopped = ctx && matrix_context_stopped(ctx);                                          \
+			/* a stopped product leaves `out` empty rather than with holes */                      \
+			out->data[0] = (_name##Element){a->data[0].row, b->data[0].col, stopped ? 0 : nnz};    \
+		}                                                                                          \
+                                                                                                   \
+		scratch_free(offset);                                                                      \
+		scratch_free(bound);                                                                       \
+		scratch_free(ptr);                                                                         \
+		return !stopped;                                                                           \
 	}                                                                                              \
                                                                                                    \
-	_name* _name##_scale(_name* m, _data_type scalar) {                                            \
-		_name* n = _name##_new(m->data[0].row, m->data[0].col);                                    \
-		for (_index_type i = 1; i <= m->data[0].val; ++i) {                                        \
-			_name##_set(n, m->data[i].row, m->data[i].col, scalar * m->data[i].val);               \
+	static bool _name##_multiply_parallel(_name* out, _name* a, _name* b) {                        \
+		u64 blocks = (u64)parallel_threads() * PARALLEL_SPLIT;                                     \
+		if (a->data[0].val < MATRIX_PARALLEL_GRAIN || blocks < 2 * PARALLEL_SPLIT) {               \
+			return false;                                                                          \
 		}                                                                                          \
-		return n;                                                                                  \
+		return _name##_multiply_blocks(out, a, b, blocks, NULL);                                   \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_multiply_into(_name* out, _name* a, _name* b) {                                   \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		if (_name##_multiply_structured(out, a, b)) {                                              \
+			return;                                                                                \
+		}                                                                                          \
+		u8 tags = matrix_structure_product(a->tags, b->tags);                                      \
+		if (_name##_multiply_parallel(out, a, b)) {                                                \
+			out->tags = tags;                                                                      \
+			return;                                                                                \
+		}                                                                                          \
+		_name##_detach(out);                                                                       \
+		_name##Workspace w = _name##_workspace_new(a->data[0].col, b->data[0].col);                \
+		_name##_kernel_row_ptr(b->data + 1, b->data[0].val, a->data[0].col, w.ptr);                \
+                                                                                                   \
+		bool overflow = false;                                                                     \
+		u64	 nnz = _name##_kernel_gemm(1, a->data + 1, a->data[0].val, b->data + 1, 0, NULL, 0,    \
+									   b->data[0].col, &w, ((u64)1 << out->size) - 1, &overflow,   \
+									   out->data + 1);                                             \
+		if (overflow) {                                                                            \
+			_name##_reserve(out, nnz);                                                             \
+			_name##_kernel_gemm(1, a->data + 1, a->data[0].val, b->data + 1, 0, NULL, 0,           \
+								b->data[0].col, &w, UINT64_MAX, NULL, out->data + 1);              \
+		}                                                                                          \
+		out->data[0].val = nnz;                                                                    \
+		out->data[0].row = a->data[0].row;                                                         \
+		out->data[0].col = b->data[0].col;                                                         \
+		out->tags = tags;                                                                          \
+                                                                                                   \
+		_name##_workspace_free(&w);                                                                \
 	}                                                                                              \
                                                                                                    \
 	_name* _name##_multiply(_name* a, _name* b) {                                                  \
+		MATRIX_TRACE_SCOPE();                                                                      \
 		_name* m = _name##_new(a->data[0].row, b->data[0].col);                                    \
-		_name* b_t = _name##_transpose(b);                                                         \
-                                                                                                   \
-		_index_type i = 1, j = 1;                                                                  \
-		_index_type a_row_start = 1, b_row_start = 1;                                              \
-		_data_type	sum = 0;                                                                       \
+		_name##_multiply_into(m, a, b);                                                            \
+		return m;                                                                                  \
+	}                                                                                              \
                                                                                                    \
-		while (i <= a->data[0].val) {                                                              \
-			if (a->data[i].col == b_t->data[j].col) {                                              \
-				sum += a->data[i].val * b_t->data[j].val;                                          \
-				++j;                                                                               \
-			} else if (a->data[i].col < b_t->data[j].col) {                                        \
-				++i;                                                                               \
-			} else if (a->data[i].col > b_t->data[j].col) {                                        \
-				++j;                                                                               \
-			}                                                                                      \
+	/* blocks hold about MATRIX_PARALLEL_GRAIN entries of `a`, so a single thread still checks the \
+	 * context often enough */                                                                     \
+	static bool _name##_multiply_checked(_name* out, _name* a, _name* b, MatrixContext* ctx) {     \
+		if (ctx == NULL) {                                                                         \
+			_name##_multiply_into(out, a, b);                                                      \
+			return true;                                                                           \
+		}                                                                                          \
+		if (matrix_context_stopped(ctx)) {                                                         \
+			return false;                                                                          \
+		}                                                                                          \
+		if (_name##_multiply_structured(out, a, b)) {                                              \
+			return true;                                                                           \
+		}                                                                                          \
+		u8	tags = matrix_structure_product(a->tags, b->tags);                                     \
+		u64 blocks = (u64)parallel_threads() * PARALLEL_SPLIT;                                     \
+		if (a->data[0].val / MATRIX_PARALLEL_GRAIN > blocks) {                                     \
+			blocks = a->data[0].val / MATRIX_PARALLEL_GRAIN;                                       \
+		}                                                                                          \
+		if (!_name##_multiply_blocks(out, a, b, blocks, ctx)) {                                    \
+			return false;                                                                          \
+		}                                                                                          \
+		out->tags = tags;                                                                          \
+		return true;                                                                               \
+	}                                                                                              \
                                                                                                    \
-			if (i <= a->data[0].val && a->data[i].row != a->data[a_row_start].row) {               \
-				i = a_row_start;                                                                   \
-				++j;                                                                               \
-			}                                                                                      \
+	Result _name##_multiply_ctx(_name* a, _name* b, MatrixContext* ctx) {                          \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* m = _name##_new(a->data[0].row, b->data[0].col);                                    \
+		if (!_name##_multiply_checked(m, a, b, ctx)) {                                             \
+			_name##_free(m);                                                                       \
+			return Err(matrix_context_error(ctx));                                                 \
+		}                                                                                          \
+		return Ok(m);                                                                              \
+	}                                                                                              \
                                                                                                    \
-			if (j <= b_t->data[0].val && b_t->data[j].row != b_t->data[b_row_start].row) {         \
-				if (sum != 0) {                                                                    \
-					_name##_set(m, a->data[a_row_start].row, b_t->data[b_row_start].row, sum);     \
-					sum = 0;                                                                       \
-				}                                                                                  \
-				b_row_start = j;                                                                   \
-				i = a_row_start;                                                                   \
+	void _name##_gemm(_data_type alpha, _name* a, _name* b, _data_type beta, _name* c) {           \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##Workspace w = _name##_workspace_new(a->data[0].col, b->data[0].col);                \
+		_name##_kernel_row_ptr(b->data + 1, b->data[0].val, a->data[0].col, w.ptr);                \
+                                                                                                   \
+		/* the in-place pass overwrites c while it still reads b through w.ptr */                  \
+		if (c != b && _name##_kernel_gemm_fits(a->data + 1, a->data[0].val, b->data + 1,           \
+											   c->data + 1, c->data[0].val, &w)) {                 \
+			_name##_unshare(c);                                                                    \
+			c->data[0].val = _name##_kernel_gemm_inplace(alpha, a->data + 1, a->data[0].val,       \
+														 b->data + 1, beta, c->data + 1,           \
+														 c->data[0].val, &w);                      \
+		} else {                                                                                   \
+			/* the product usually keeps the positions of c, so that is the first guess, and a     \
+			 * second pass runs only when it falls short */                                        \
+			_name* t = _name##_new(c->data[0].row, c->data[0].col);                                \
+			bool   overflow = false;                                                               \
+			_name##_reserve(t, c->data[0].val);                                                    \
+			u64	   nnz =                                                                           \
+				_name##_kernel_gemm(alpha, a->data + 1, a->data[0].val, b->data + 1, beta,         \
+									c->data + 1, c->data[0].val, c->data[0].col, &w,               \
+									((u64)1 << t->size) - 1, &overflow, t->data + 1);              \
+			if (overflow) {                                                                        \
+				_name##_reserve(t, nnz);                                                           \
+				_name##_kernel_gemm(alpha, a->data + 1, a->data[0].val, b->data + 1, beta,         \
+									c->data + 1, c->data[0].val, c->data[0].col, &w, UINT64_MAX,   \
+									NULL, t->data + 1);                                            \
 			}                                                                                      \
+			t->data[0].val = nnz;                                                                  \
                                                                                                    \
-			if (j > b_t->data[0].val) {                                                            \
-				if (sum != 0) {                                                                    \
-					_name##_set(m, a->data[a_row_start].row, b_t->data[b_row_start].row, sum);     \
-					sum = 0;                                                                       \
-				}                                                                                  \
-				while (i <= a->data[0].val && a->data[i].row == a->data[a_row_start].row) {        \
-					++i;                                                                           \
-				}                                                                                  \
-				a_row_start = i;                                                                   \
-				j = b_row_start = 1;                                                               \
-			}                                                                                      \
+			_name##_swap(c, t);                                                                    \
+			_name##_free(t);                                                                       \
 		}                                                                                          \
                                                                                                    \
-		_name##_free(b_t);                                                                         \
-		return m;                                                                                  \
+		_name##_workspace_free(&w);                                                                \
 	}                                                                                              \
                                                                                                    \
-	_name* _name##_hadamard(_name* a, _name* b) {                                                  \
-		_name* m = _name##_new(a->data[0].row, a->data[0].col);                                    \
+	void _name##_multiply_masked_into(_name* out, _name* a, _name* b, _name* mask,                 \
+									  bool complement) {                                           \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_detach(out);                                                                       \
+		_name##Workspace w = _name##_workspace_new(a->data[0].col, b->data[0].col);                \
+		_name##_kernel_row_ptr(b->data + 1, b->data[0].val, a->data[0].col, w.ptr);                \
+		u64 na = a->data[0].val, nb = b->data[0].val, nm = mask->data[0].val, nnz;                 \
+                                                                                                   \
+		if (complement) {                                                                          \
+			bool overflow = false;                                                                 \
+			nnz = _name##_kernel_masked_complement(a->data + 1, na, b->data + 1, mask->data + 1,   \
+												   nm, b->data[0].col, &w,                         \
+												   ((u64)1 << out->size) - 1, &overflow,           \
+												   out->data + 1);                                 \
+			if (overflow) {                                                                        \
+				_name##_reserve(out, nnz);                                                         \
+				_name##_kernel_masked_complement(a->data + 1, na, b->data + 1, mask->data + 1, nm, \
+												 b->data[0].col, &w, UINT64_MAX, NULL,             \
+												 out->data + 1);                                   \
+			}                                                                                      \
+		} else {                                                                                   \
+			u64* a_ptr = scratch_alloc(sizeof(u64) * ((u64)a->data[0].row + 1));                   \
+			u64* bt_ptr = scratch_alloc(sizeof(u64) * ((u64)b->data[0].col + 1));                  \
+			_name##_kernel_row_ptr(a->data + 1, na, a->data[0].row, a_ptr);                        \
+			memset(bt_ptr, 0, sizeof(u64) * ((u64)b->data[0].col + 1));                            \
+			for (u64 i = 1; i <= nb; ++i) {                                                        \
+				++bt_ptr[b->data[i].col + 1];                                                      \
+			}                                                                                      \
+			for (_index_type c = 0; c < b->data[0].col; ++c) {                                     \
+				bt_ptr[c + 1] += bt_ptr[c];                                                        \
+			}                                                                                      \
                                                                                                    \
-		_index_type i = 1, j = 1;                                                                  \
-		while (i <= a->data[0].val && j <= b->data[0].val) {                                       \
-			if (a->data[i].row < b->data[j].row) {                                                 \
-				++i;                                                                               \
-			} else if (a->data[i].row > b->data[j].row) {                                          \
-				++j;                                                                               \
-			} else if (a->data[i].col < b->data[j].col) {                                          \
-				++i;                                                                               \
-			} else if (a->data[i].col > b->data[j].col) {                                          \
-				++j;                                                                               \
-			} else {                                                                               \
-				_name##_set(m, a->data[i].row, a->data[i].col, a->data[i].val * b->data[j].val);   \
-				++i, ++j;                                                                          \
+			_name##Element* bt = NULL;                                                             \
+			if (_name##_kernel_masked_saving(a->data + 1, a_ptr, w.ptr, bt_ptr, mask->data + 1,    \
+											 nm) > nb) {                                           \
+				u64* pos = scratch_alloc(sizeof(u64) * ((u64)b->data[0].col + 1));                 \
+				bt = scratch_alloc(sizeof(_name##Element) * (nb + 1));                             \
+				_name##_kernel_transpose(b->data + 1, nb, b->data[0].col, pos, bt);                \
+				scratch_free(pos);                                                                 \
 			}                                                                                      \
+                                                                                                   \
+			_name##_reserve(out, nm);                                                              \
+			nnz = _name##_kernel_masked(a->data + 1, a_ptr, b->data + 1, bt, bt_ptr,               \
+										mask->data + 1, nm, &w, out->data + 1);                    \
+                                                                                                   \
+			scratch_free(bt);                                                                      \
+			scratch_free(bt_ptr);                                                                  \
+			scratch_free(a_ptr);                                                                   \
 		}                                                                                          \
+		out->data[0].val = nnz;                                                                    \
+		out->data[0].row = a->data[0].row;                                                         \
+		out->data[0].col = b->data[0].col;                                                         \
+                                                                                                   \
+		_name##_workspace_free(&w);                                                                \
+	}                                                                                              \
                                                                                                    \
+	_name* _name##_multiply_masked(_name* a, _name* b, _name* mask, bool complement) {             \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* m = _name##_new(a->data[0].row, b->data[0].col);                                    \
+		_name##_multiply_masked_into(m, a, b, mask, complement);                                   \
 		return m;                                                                                  \
 	}                                                                                              \
                                                                                                    \
 	_name* _name##_from_1d(_data_type* data, _index_type row, _index_type col) {                   \
-		_name* m = _name##_new(row, col);                                                          \
-		for (_index_type i = 0; i < row; ++i) {                                                    \
-			for (_index_type j = 0; j < col; ++j) {                                                \
-				if (data[i * col + j] != 0) {                                                      \
-					_name##_set(m, i, j, data[i * col + j]);                                       \
-				}                                                                                  \
-			}                                                                                      \
-		}                                                                                          \
-		return m;                                                                                  \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##DenseJob job = {NULL, col, data, NULL, NULL};                                       \
+		return _name##_from_dense(&job, row, col);                                                 \
 	}                                                                                              \
                                                                                                    \
 	_name* _name##_from_2d(_data_type** data, _index_type row, _index_type col) {                  \
-		_name* m = _name##_new(row, col);                                                          \
-		for (_index_type i = 0; i < row; ++i) {                                                    \
-			for (_index_type j = 0; j < col; ++j) {                                                \
-				if (data[i][j] != 0) {                                                             \
-					_name##_set(m, i, j, data[i][j]);                                              \
-				}                                                                                  \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##DenseJob job = {NULL, col, NULL, data, NULL};                                       \
+		return _name##_from_dense(&job, row, col);                                                 \
+	}                                                                                              \
+                                                                                                   \
+	static _data_type _name##_power(_data_type x, i64 exp) {                                       \
+		_data_type ans = 1;                                                                        \
+		while (exp > 0) {                                                                          \
+			if (exp % 2 == 1) {                                                                    \
+				ans *= x;                                                                          \
 			}                                                                                      \
+			x *= x;                                                                                \
+			exp >>= 1;                                                                             \
 		}                                                                                          \
-		return m;                                                                                  \
+		return ans;                                                                                \
 	}                                                                                              \
                                                                                                    \
-	_name* _name##_submatrix(_name* m, bool* rows, bool* cols) {                                   \
-		_index_type row_map[m->data[0].row], col_map[m->data[0].col];                              \
-		row_map[0] = rows[0] ? 1 : 0;                                                              \
-		col_map[0] = cols[0] ? 1 : 0;                                                              \
-                                                                                                   \
-		for (_index_type i = 1; i < m->data[0].row; ++i) {                                         \
-			row_map[i] = rows[i] ? row_map[i - 1] + 1 : row_map[i - 1];                            \
-		}                                                                                          \
-		for (_index_type i = 1; i < m->data[0].col; ++i) {                                         \
-			col_map[i] = cols[i] ? col_map[i - 1] + 1 : col_map[i - 1];                            \
+	static void _name##_rehome(_name* m, const MatrixAllocator* allocator) {                       \
+		if (buffer_allocator(m->data) == allocator) {                                              \
+			return;                                                                                \
 		}                                                                                          \
+		_name##Element* data = buffer_alloc(allocator, _name##_capacity(m));                       \
+		memcpy(data, m->data, sizeof(_name##Element) * ((u64)m->data[0].val + 1));                 \
+		MATRIX_TRACE_ALLOC(_name##_capacity(m));                                                   \
+		MATRIX_TRACE_RELEASE(buffer_shared(m->data) ? 0 : _name##_capacity(m));                    \
+		buffer_release(m->data);                                                                   \
+		m->data = data;                                                                            \
+	}                                                                                              \
                                                                                                    \
-		_name* sub = _name##_new(row_map[m->data[0].row - 1], col_map[m->data[0].col - 1]);        \
+	static bool _name##_exp_step(_name* out, _name* a, _name* b, MatrixContext* ctx, u64 step,     \
+								 u64 steps) {                                                      \
+		if (ctx == NULL) {                                                                         \
+			_name##_multiply_into(out, a, b);                                                      \
+			return true;                                                                           \
+		}                                                                                          \
+		matrix_context_enter(ctx);                                                                 \
+		bool done = _name##_multiply_checked(out, a, b, ctx);                                      \
+		matrix_context_leave(ctx);                                                                 \
+		return matrix_context_check(ctx, step, steps) && done;                                     \
+	}                                                                                              \
                                                                                                    \
-		for (_index_type i = 1; i <= m->data[0].val; ++i) {                                        \
-			if (rows[m->data[i].row] && cols[m->data[i].col]) {                                    \
-				_name##_set(sub, row_map[m->data[i].row] - 1, col_map[m->data[i].col] - 1,         \
-							m->data[i].val);                                                       \
+	/* square-and-multiply, reporting one unit of progress per product; returns false if the       \
+	 * context stopped it, with `out` left in an unspecified state */                              \
+	static bool _name##_exp_run(_name* out, _name* m, i64 exp, MatrixContext* ctx) {               \
+		_index_type size = m->data[0].row;                                                         \
+		u8			tags = _name##_structure(m);                                                   \
+		if (exp <= 0) {                                                                            \
+			_name##_reserve(out, size);                                                            \
+			for (_index_type i = 0; i < size; ++i) {                                               \
+				out->data[i + 1] = (_name##Element){i, i, 1};                                      \
 			}                                                                                      \
+			out->data[0] = (_name##Element){size, size, size};                                     \
+			out->tags = matrix_structure_close(MATRIX_STRUCTURE_IDENTITY);                         \
+			return true;                                                                           \
+		}                                                                                          \
+		if (tags & MATRIX_STRUCTURE_IDENTITY) {                                                    \
+			_name##_assign(out, m);                                                                \
+			return true;                                                                           \
+		}                                                                                          \
+		if (tags & MATRIX_STRUCTURE_DIAGONAL) {                                                    \
+			_name##_reserve(out, m->data[0].val);                                                  \
+			u64 n = 0;                                                                             \
+			for (u64 i = 1; i <= m->data[0].val; ++i) {                                            \
+				n = _name##_kernel_emit(out->data + 1, n, m->data[i].row, m->data[i].col,          \
+										_name##_power(m->data[i].val, exp));                       \
+			}                                                                                      \
+			out->data[0] = (_name##Element){size, size, n};                                        \
+			out->tags = tags & ~MATRIX_STRUCTURE_ZERO;                                             \
+			return true;                                                                           \
 		}                                                                                          \
                                                                                                    \
-		return sub;                                                                                \
-	}                                                                                              \
-                                                                                                   \
-	_name* _name##_exp(_name* m, i64 exp) {                                                        \
-		_name* base = _name##_scale(m, 1);                                                         \
-		_name* ans = _name##_identity(m->data[0].row);                                             \
+		const MatrixAllocator* home = buffer_allocator(out->data);                                 \
+		MatrixArena*		   arena = matrix_arena_current();                                     \
+		const MatrixAllocator* previous =                                                          \
+			arena ? matrix_allocator_push(matrix_arena_allocator(arena)) : NULL;                   \
+		_name* base = _name##_clone(m);                                                            \
+		_name* tmp = _name##_new(size, size);                                                      \
+		bool   started = false, running = true;                                                    \
+		u64	   step = 0, steps = 0;                                                                \
+		for (i64 e = exp; e > 1; e >>= 1) {                                                        \
+			steps += 1 + (e & 1);                                                                  \
+		}                                                                                          \
                                                                                                    \
-		while (exp > 0) {                                                                          \
+		while (running && exp > 0) {                                                               \
 			if (exp % 2 == 1) {                                                                    \
-				_name* tmp = _name##_multiply(ans, base);                                          \
-				_name##_free(ans);                                                                 \
-				ans = tmp;                                                                         \
+				if (started) {                                                                     \
+					running = _name##_exp_step(tmp, out, base, ctx, ++step, steps);                \
+					_name##_swap(out, tmp);                                                        \
+				} else {                                                                           \
+					_name##_assign(out, base);                                                     \
+					started = true;                                                                \
+				}                                                                                  \
 			}                                                                                      \
-			_name* tmp = _name##_multiply(base, base);                                             \
-			_name##_free(base);                                                                    \
-			base = tmp;                                                                            \
 			exp >>= 1;                                                                             \
+			if (running && exp > 0) {                                                              \
+				running = _name##_exp_step(tmp, base, base, ctx, ++step, steps);                   \
+				_name##_swap(base, tmp);                                                           \
+			}                                                                                      \
 		}                                                                                          \
-                                                                                                   \
+		_name##_free(tmp);                                                                         \
 		_name##_free(base);                                                                        \
+		if (arena) {                                                                               \
+			matrix_allocator_pop(previous);                                                        \
+			_name##_rehome(out, home);                                                             \
+		}                                                                                          \
+		out->tags |= tags & MATRIX_STRUCTURE_SYMMETRIC;                                            \
+		return running;                                                                            \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_exp_into(_name* out, _name* m, i64 exp) {                                         \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_exp_run(out, m, exp, NULL);                                                        \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_exp(_name* m, i64 exp) {                                                        \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* ans = _name##_new(m->data[0].row, m->data[0].row);                                  \
+		_name##_exp_into(ans, m, exp);                                                             \
 		return ans;                                                                                \
 	}                                                                                              \
                                                                                                    \
+	Result _name##_exp_ctx(_name* m, i64 exp, MatrixContext* ctx) {                                \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* ans = _name##_new(m->data[0].row, m->data[0].row);                                  \
+		if (!_name##_exp_run(ans, m, exp, ctx)) {                                                  \
+			_name##_free(ans);                                                                     \
+			return Err(matrix_context_error(ctx));                                                 \
+		}                                                                                          \
+		return Ok(ans);                                                                            \
+	}                                                                                              \
+                                                                                                   \
 	bool _name##_validate(_name* m) {                                                              \
 		if (m->data[0].row <= 0 || m->data[0].col <= 0) {                                          \
 			return false;                                                                          \
@@ -445,16 +1513,132 @@
 		}                                                                                          \
 	}                                                                                              \
                                                                                                    \
-	void _name##_rebuild(_name* m) {                                                               \
-		u8 size = m->size;                                                                         \
+	typedef struct _name##SortJob {                                                                \
+		_name##Element* src;                                                                       \
+		_name##Element* dst;                                                                       \
+		u64				n;                                                                         \
+		u64				blocks;                                                                    \
+		u64*			count;                                                                     \
+		u64*			mask;                                                                      \
+		u32				digits;                                                                    \
+		u32				pass;                                                                      \
+	} _name##SortJob;                                                                              \
+                                                                                                   \
+	static void _name##_sort_mask_task(void* ctx, u64 begin, u64 end) {                            \
+		_name##SortJob* job = ctx;                                                                 \
+		for (u64 x = begin; x < end; ++x) {                                                        \
+			u64 rows = 0, cols = 0;                                                                \
+			for (u64 i = job->n * x / job->blocks; i < job->n * (x + 1) / job->blocks; ++i) {      \
+				rows |= (u64)job->src[i].row;                                                      \
+				cols |= (u64)job->src[i].col;                                                      \
+			}                                                                                      \
+			job->mask[2 * x] = rows;                                                               \
+			job->mask[2 * x + 1] = cols;                                                           \
+		}                                                                                          \
+	}                                                                                              \
                                                                                                    \
-		while (m->data[0].val > (1 << size) - 1) {                                                 \
-			++size;                                                                                \
+	static void _name##_sort_count_task(void* ctx, u64 begin, u64 end) {                           \
+		_name##SortJob* job = ctx;                                                                 \
+		for (u64 x = begin; x < end; ++x) {                                                        \
+			u64* count = job->count + 256 * x;                                                     \
+			memset(count, 0, sizeof(u64) * 256);                                                   \
+			for (u64 i = job->n * x / job->blocks; i < job->n * (x + 1) / job->blocks; ++i) {      \
+				++count[_name##_kernel_digit(job->src + i, job->pass, job->digits)];               \
+			}                                                                                      \
 		}                                                                                          \
-		m->data = realloc(m->data, sizeof(_name##Element) * (1 << size));                          \
-		m->size = size;                                                                            \
+	}                                                                                              \
                                                                                                    \
-		qsort(m->data + 1, m->data[0].val, sizeof(_name##Element), _name##Element_compare);        \
+	static void _name##_sort_scatter_task(void* ctx, u64 begin, u64 end) {                         \
+		_name##SortJob* job = ctx;                                                                 \
+		for (u64 x = begin; x < end; ++x) {                                                        \
+			u64* pos = job->count + 256 * x;                                                       \
+			for (u64 i = job->n * x / job->blocks; i < job->n * (x + 1) / job->blocks; ++i) {      \
+				job->dst[pos[_name##_kernel_digit(job->src + i, job->pass, job->digits)]++] =      \
+					job->src[i];                                                                   \
+			}                                                                                      \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	/* _kernel_sort with every pass split into blocks: the blocks count their digits, then write   \
+	 * each digit after the smaller digits and the same digit of the earlier blocks, which keeps   \
+	 * the sort stable */                                                                          \
+	static _name##Element* _name##_sort_parallel(_name##Element* e, u64 n, _name##Element* tmp,    \
+												 u64 blocks) {                                     \
+		u64*		   count = scratch_alloc(sizeof(u64) * 256 * blocks);                          \
+		u64*		   mask = scratch_alloc(sizeof(u64) * 2 * blocks);                             \
+		_name##SortJob job = {e, tmp, n, blocks, count, mask, 0, 0};                               \
+		parallel_for(blocks, 1, _name##_sort_mask_task, &job);                                     \
+		u64 rows = 0, cols = 0;                                                                    \
+		for (u64 x = 0; x < blocks; ++x) {                                                         \
+			rows |= mask[2 * x];                                                                   \
+			cols |= mask[2 * x + 1];                                                               \
+		}                                                                                          \
+		u32 passes;                                                                                \
+		for (; cols; cols >>= 8) {                                                                 \
+			++job.digits;                                                                          \
+		}                                                                                          \
+		for (passes = job.digits; rows; rows >>= 8) {                                              \
+			++passes;                                                                              \
+		}                                                                                          \
+                                                                                                   \
+		for (; job.pass < passes; ++job.pass) {                                                    \
+			parallel_for(blocks, 1, _name##_sort_count_task, &job);                                \
+			bool shared = false;                                                                   \
+			for (u64 d = 0, at = 0; d < 256; ++d) {                                                \
+				u64 first = at;                                                                    \
+				for (u64 x = 0; x < blocks; ++x) {                                                 \
+					u64 c = count[256 * x + d];                                                    \
+					count[256 * x + d] = at;                                                       \
+					at += c;                                                                       \
+				}                                                                                  \
+				shared |= at - first == n;                                                         \
+			}                                                                                      \
+			if (shared) {                                                                          \
+				continue;                                                                          \
+			}                                                                                      \
+			parallel_for(blocks, 1, _name##_sort_scatter_task, &job);                              \
+			_name##Element* sorted = job.dst;                                                      \
+			job.dst = job.src;                                                                     \
+			job.src = sorted;                                                                      \
+		}                                                                                          \
+		scratch_free(mask);                                                                        \
+		scratch_free(count);                                                                       \
+		return job.src;                                                                            \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_rebuild(_name* m) {                                                               \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		/* only grows or unshares the buffer, and clears the tags since the elements were written  \
+		 * directly and the structure they had is not known anymore */                             \
+		_name##_reserve(m, m->data[0].val);                                                        \
+                                                                                                   \
+		u64 n = m->data[0].val, blocks = (u64)parallel_threads() * PARALLEL_SPLIT;                 \
+		if (blocks > n / MATRIX_PARALLEL_GRAIN) {                                                  \
+			blocks = n / MATRIX_PARALLEL_GRAIN;                                                    \
+		}                                                                                          \
+		_name##Element* tmp = scratch_alloc(sizeof(_name##Element) * n);                           \
+		_name##Element* sorted = parallel_threads() < 2 || blocks < 2                              \
+									 ? _name##_kernel_sort(m->data + 1, n, tmp)                    \
+									 : _name##_sort_parallel(m->data + 1, n, tmp, blocks);         \
+		if (sorted != m->data + 1) {                                                               \
+			memcpy(m->data + 1, sorted, sizeof(_name##Element) * n);                               \
+		}                                                                                          \
+		scratch_free(tmp);                                                                         \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_rebuild_merge(_name* m) {                                                         \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_rebuild(m);                                                                        \
+		_name##Element* e = m->data + 1;                                                           \
+		u64				n = 0;                                                                     \
+		for (u64 i = 0; i < m->data[0].val;) {                                                     \
+			_name##Element sum = e[i++];                                                           \
+			while (i < m->data[0].val && e[i].row == sum.row && e[i].col == sum.col) {             \
+				sum.val += e[i++].val;                                                             \
+			}                                                                                      \
+			n = _name##_kernel_emit(e, n, sum.row, sum.col, sum.val);                              \
+		}                                                                                          \
+		m->data[0].val = n;                                                                        \
 	}                                                                                              \
                                                                                                    \
 	bool _name##_shape_equal(_name* a, _name* b) {                                                 \
@@ -482,98 +1666,95 @@
                                                                                                    \
 	bool _name##_is_square(_name* m) { return m->data[0].row == m->data[0].col; }                  \
                                                                                                    \
-	_name* _name##_map(_name* m, _data_type (*func)(_data_type, _index_type, _index_type)) {       \
-		_name* ans = _name##_new(m->data[0].row, m->data[0].col);                                  \
-                                                                                                   \
-		for (_index_type i = 1; i <= m->data[0].val; ++i) {                                        \
-			_name##_set(ans, m->data[i].row, m->data[i].col,                                       \
-						func(m->data[i].val, m->data[i].row, m->data[i].col));                     \
-		}                                                                                          \
-                                                                                                   \
-		return ans;                                                                                \
+	void _name##_map_into(_name* out, _name* m,                                                    \
+						  _data_type (*func)(_data_type, _index_type, _index_type)) {              \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_reserve(out, m->data[0].val);                                                      \
+		out->data[0].val = _name##_kernel_map(m->data + 1, m->data[0].val, func, out->data + 1);   \
+		out->data[0].row = m->data[0].row;                                                         \
+		out->data[0].col = m->data[0].col;                                                         \
 	}                                                                                              \
                                                                                                    \
-	_data_type* _name##_max_value(_name* m) {                                                      \
-		_data_type* ans = malloc(sizeof(_data_type));                                              \
-		*ans = m->data[1].val;                                                                     \
-		for (_index_type i = 2; i <= m->data[0].val; ++i) {                                        \
-			if (m->data[i].val > *ans) {                                                           \
-				*ans = m->data[i].val;                                                             \
-			}                                                                                      \
-		}                                                                                          \
-		return ans;                                                                                \
+	void _name##_map_inplace(_name* m, _data_type (*func)(_data_type, _index_type, _index_type)) { \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_map_into(m, m, func);                                                              \
 	}                                                                                              \
                                                                                                    \
-	_data_type* _name##_min_value(_name* m) {                                                      \
-		_data_type* ans = malloc(sizeof(_data_type));                                              \
-		*ans = m->data[1].val;                                                                     \
-		for (_index_type i = 2; i <= m->data[0].val; ++i) {                                        \
-			if (m->data[i].val < *ans) {                                                           \
-				*ans = m->data[i].val;                                                             \
-			}                                                                                      \
-		}                                                                                          \
-		return ans;                                                                                \
-	}                                                                                              \
-                                                                                                   \
-	_data_type _name##_sum(_name* m) {                                                             \
-		_data_type ans = 0;                                                                        \
-		for (_index_type i = 1; i <= m->data[0].val; ++i) {                                        \
-			ans += m->data[i].val;                                                                 \
-		}                                                                                          \
-		return ans;                                                                                \
-	}                                                                                              \
-                                                                                                   \
-	_data_type _name##_mean(_name* m) { return _name##_sum(m) / m->data[0].val; }                  \
-                                                                                                   \
-	_data_type _name##_trace(_name* m) {                                                           \
-		_data_type ans = 0;                                                                        \
-		for (_index_type i = 1; i <= m->data[0].val; ++i) {                                        \
-			if (m->data[i].row == m->data[i].col) {                                                \
-				ans += m->data[i].val;                                                             \
-			}                                                                                      \
-		}                                                                                          \
+	_name* _name##_map(_name* m, _data_type (*func)(_data_type, _index_type, _index_type)) {       \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* ans = _name##_new(m->data[0].row, m->data[0].col);                                  \
+		_name##_map_into(ans, m, func);                                                            \
 		return ans;                                                                                \
 	}
 
 #define MATRIX_METHOD_DECLARE(_name, _data_type, _index_type)                                      \
+	void		 _name##_use_allocator(const MatrixAllocator* allocator);                          \
 	_name*		 _name##_new(_index_type row, _index_type col);                                    \
 	_name*		 _name##_identity(_index_type size);                                               \
+	_name*		 _name##_clone(_name* m);                                                          \
 	void		 _name##_free(_name* m);                                                           \
-	void		 _name##_rename(_name* m, char* name);                                             \
+	MatrixMemory _name##_memory(_name* m);                                                         \
+	void		 _name##_reserve(_name* m, u64 nnz);                                               \
+	void		 _name##_rename(_name* m, const char* name);                                       \
+	const char*	 _name##_get_name(_name* m);                                                       \
 	_name##Found _name##_find(_name* m, _index_type row, _index_type col);                         \
 	void		 _name##_set(_name* m, _index_type row, _index_type col, _data_type val);          \
 	_data_type	 _name##_get(_name* m, _index_type row, _index_type col);                          \
 	_data_type*	 _name##_to_1d(_name* m);                                                          \
 	_data_type** _name##_to_2d(_name* m);                                                          \
 	void		 _name##_reshape(_name* m, _index_type row, _index_type col);                      \
+	void		 _name##_transpose_into(_name* out, _name* m);                                     \
 	_name*		 _name##_transpose(_name* m);                                                      \
-	_name*		 _name##_add(_name* a, _name* b);                                                  \
+	void _name##_axpby_into(_name* out, _data_type alpha, _name* a, _data_type beta, _name* b);    \
+	_name*		 _name##_axpby(_data_type alpha, _name* a, _data_type beta, _name* b);             \
+	void		 _name##_scale_into(_name* out, _name* m, _data_type scalar);                      \
+	void		 _name##_scale_inplace(_name* m, _data_type scalar);                               \
 	_name*		 _name##_scale(_name* m, _data_type scalar);                                       \
+	void		 _name##_multiply_into(_name* out, _name* a, _name* b);                            \
 	_name*		 _name##_multiply(_name* a, _name* b);                                             \
-	_name*		 _name##_hadamard(_name* a, _name* b);                                             \
+	Result		 _name##_multiply_ctx(_name* a, _name* b, MatrixContext* ctx);                     \
+	void		 _name##_gemm(_data_type alpha, _name* a, _name* b, _data_type beta, _name* c);    \
+	void		 _name##_multiply_masked_into(_name* out, _name* a, _name* b, _name* mask,         \
+											  bool complement);                                    \
+	_name*		 _name##_multiply_masked(_name* a, _name* b, _name* mask, bool complement);        \
 	_name*		 _name##_from_1d(_data_type* data, _index_type row, _index_type col);              \
 	_name*		 _name##_from_2d(_data_type** data, _index_type row, _index_type col);             \
-	_name*		 _name##_submatrix(_name* m, bool* rows, bool* cols);                              \
+	void		 _name##_exp_into(_name* out, _name* m, i64 exp);                                  \
 	_name*		 _name##_exp(_name* m, i64 exp);                                                   \
+	Result		 _name##_exp_ctx(_name* m, i64 exp, MatrixContext* ctx);                           \
 	bool		 _name##_validate(_name* m);                                                       \
 	int			 _name##Element_compare(const void* a, const void* b);                             \
 	void		 _name##_rebuild(_name* m);                                                        \
+	void		 _name##_rebuild_merge(_name* m);                                                  \
 	bool		 _name##_shape_equal(_name* a, _name* b);                                          \
 	bool		 _name##_equal(_name* a, _name* b);                                                \
 	bool		 _name##_is_square(_name* m);                                                      \
-	_name*		 _name##_map(_name* m, _data_type (*func)(_data_type, _index_type, _index_type));  \
-	_data_type*	 _name##_max_value(_name* m);                                                      \
-	_data_type*	 _name##_min_value(_name* m);                                                      \
-	_data_type	 _name##_sum(_name* m);                                                            \
-	_data_type	 _name##_mean(_name* m);                                                           \
-	_data_type	 _name##_trace(_name* m);
+	void		 _name##_map_into(_name* out, _name* m,                                            \
+								  _data_type (*func)(_data_type, _index_type, _index_type));       \
+	void _name##_map_inplace(_name* m, _data_type (*func)(_data_type, _index_type, _index_type));  \
+	_name*		 _name##_map(_name* m, _data_type (*func)(_data_type, _index_type, _index_type));
 
 /**
  * @brief You can use this macro to create a matrix type and its methods.
  */
 #define MATRIX(_name, _data_type, _index_type)                                                     \
 	MATRIX_SAFE_GUARD(_name, _data_type, _index_type)                                              \
-	MATRIX_METHOD(_name, _data_type, _index_type)
+	MATRIX_KERNEL(_name, _data_type, _index_type)                                                  \
+	MATRIX_STRUCTURE_METHOD(_name, _data_type, _index_type)                                        \
+	MATRIX_METHOD(_name, _data_type, _index_type)                                                  \
+	MATRIX_EWISE_METHOD(_name, _data_type, _index_type)                                            \
+	MATRIX_BROADCAST_METHOD(_name, _data_type, _index_type)                                        \
+	MATRIX_REDUCE_METHOD(_name, _data_type, _index_type)                                           \
+	MATRIX_SLICE_METHOD(_name, _data_type, _index_type)                                            \
+	MATRIX_VIEW_METHOD(_name, _data_type, _index_type)                                             \
+	MATRIX_SEMIRING(_name, _data_type, _index_type, plus_times, SEMIRING_PLUS, SEMIRING_TIMES, 0,  \
+					1)                                                                             \
+	MATRIX_BATCH_METHOD(_name, _data_type, _index_type)                                            \
+	MATRIX_EXPRESSION_METHOD(_name, _data_type, _index_type)                                       \
+	MATRIX_CHAIN_METHOD(_name, _data_type, _index_type)                                            \
+	MATRIX_SHARED_METHOD(_name, _data_type, _index_type)                                           \
+	MATRIX_ASSEMBLER_METHOD(_name, _data_type, _index_type)                                        \
+	MATRIX_ASYNC_METHOD(_name, _data_type, _index_type)
 
 /**
  * @brief You can use this macro to declare a matrix type and its methods in a header file.
@@ -581,4 +1762,17 @@
 #define DECLARE_MATRIX(_name, _data_type, _index_type)                                             \
 	MATRIX_STRUCT(_name, _data_type, _index_type)                                                  \
 	MATRIX_SAFE_GUARD_DECLARE(_name, _data_type, _index_type)                                      \
-	MATRIX_METHOD_DECLARE(_name, _data_type, _index_type)
+	MATRIX_STRUCTURE_METHOD_DECLARE(_name, _data_type, _index_type)                                \
+	MATRIX_METHOD_DECLARE(_name, _data_type, _index_type)                                          \
+	MATRIX_EWISE_METHOD_DECLARE(_name, _data_type, _index_type)                                    \
+	MATRIX_BROADCAST_METHOD_DECLARE(_name, _data_type, _index_type)                                \
+	MATRIX_REDUCE_METHOD_DECLARE(_name, _data_type, _index_type)                                   \
+	MATRIX_SLICE_METHOD_DECLARE(_name, _data_type, _index_type)                                    \
+	MATRIX_VIEW_METHOD_DECLARE(_name, _data_type, _index_type)                                     \
+	MATRIX_SEMIRING_DECLARE(_name, _data_type, _index_type, plus_times)                            \
+	MATRIX_BATCH_METHOD_DECLARE(_name, _data_type, _index_type)                                    \
+	MATRIX_EXPRESSION_METHOD_DECLARE(_name, _data_type, _index_type)                               \
+	MATRIX_CHAIN_METHOD_DECLARE(_name, _data_type, _index_type)                                    \
+	MATRIX_SHARED_METHOD_DECLARE(_name, _data_type, _index_type)                                   \
+	MATRIX_ASSEMBLER_METHOD_DECLARE(_name, _data_type, _index_type)                                \
+	MATRIX_ASYNC_METHOD_DECLARE(_name, _data_type, _index_type)
@@ -9,13 +9,22 @@
 
 MATRIX_STRUCT(Matrix, f64, u32);
 MATRIX(Matrix, f64, u32);
+MATRIX_STRUCT(Small, f64, u8);
+MATRIX(Small, f64, u8);
 
 void test_operations();
+void test_fused();
+void test_into();
+void test_masked();
+void test_clone();
+void test_rebuild();
+void test_narrow();
 
 int main() {
 	srand(1481);
 
 	Matrix* matrix = Matrix_new(2, 2);
+	assert(matrix->name == NULL);
 	Matrix_rename(matrix, "matrix");
 	assert(strcmp(matrix->name, "matrix") == 0);
 	assert(matrix->data[0].row == 2);
@@ -91,6 +100,12 @@ int main() {
 	Matrix_free(id);
 
 	test_operations();
+	test_fused();
+	test_into();
+	test_masked();
+	test_clone();
+	test_rebuild();
+	test_narrow();
 
 	Matrix* invalid = Matrix_new(3, 3);
 	invalid->data[0].val = 5;
@@ -166,6 +181,14 @@ void test_operations() {
 	assert(Matrix_get(e, 1, 1) == 50.0);
 	Matrix_free(e);
 
+	Matrix* swap = Matrix_from_1d((f64[]){0.0, 1.0, 1.0, 0.0}, 2, 2);
+	Matrix* swap_squared = Matrix_multiply(swap, swap);
+	assert(swap_squared->data[0].val == 2);
+	assert(Matrix_get(swap_squared, 0, 0) == 1.0);
+	assert(Matrix_get(swap_squared, 1, 1) == 1.0);
+	Matrix_free(swap_squared);
+	Matrix_free(swap);
+
 	Matrix* f = Matrix_hadamard(a, b);
 	assert(f->data[0].row == 2);
 	assert(f->data[0].col == 2);
@@ -203,3 +226,301 @@ void test_operations() {
 	Matrix_free(sub);
 	Matrix_free(matrix);
 }
+
+void test_fused() {
+	Matrix* a = Matrix_from_1d((f64[]){1.0, 2.0, 3.0, 4.0}, 2, 2);
+	Matrix* b = Matrix_from_1d((f64[]){5.0, 6.0, 7.0, 8.0}, 2, 2);
+
+	Matrix* axpby = Matrix_axpby(2.0, a, -1.0, b);
+	assert(axpby->data[0].val == 3);
+	assert(Matrix_get(axpby, 0, 0) == -3.0);
+	assert(Matrix_get(axpby, 0, 1) == -2.0);
+	assert(Matrix_get(axpby, 1, 0) == -1.0);
+	assert(Matrix_get(axpby, 1, 1) == 0.0);
+	Matrix_free(axpby);
+
+	Matrix*		   c = Matrix_from_1d((f64[]){1.0, 1.0, 1.0, 1.0}, 2, 2);
+	MatrixElement* before = c->data;
+	Matrix_gemm(2.0, a, b, 3.0, c);
+	assert(c->data == before);
+	assert(c->data[0].val == 4);
+	assert(Matrix_get(c, 0, 0) == 41.0);
+	assert(Matrix_get(c, 0, 1) == 47.0);
+	assert(Matrix_get(c, 1, 0) == 89.0);
+	assert(Matrix_get(c, 1, 1) == 103.0);
+	Matrix_free(c);
+
+	Matrix* d = Matrix_new(2, 2);
+	Matrix_set(d, 0, 0, 1.0);
+	Matrix_gemm(2.0, a, b, 3.0, d);
+	assert(d->data[0].val == 4);
+	assert(Matrix_validate(d));
+	assert(Matrix_get(d, 0, 0) == 41.0);
+	assert(Matrix_get(d, 0, 1) == 44.0);
+	assert(Matrix_get(d, 1, 0) == 86.0);
+	assert(Matrix_get(d, 1, 1) == 100.0);
+	Matrix_free(d);
+
+	Matrix* e = Matrix_multiply(a, b);
+	Matrix_gemm(1.0, a, b, -1.0, e);
+	assert(e->data[0].val == 0);
+	Matrix_free(e);
+
+	// c may be one of the operands, and the in-place pass must not overwrite b while reading it
+	Matrix* product = Matrix_multiply(a, b);
+	Matrix* alias = Matrix_clone(b);
+	Matrix_gemm(1.0, a, alias, 0.0, alias);
+	assert(Matrix_equal(alias, product));
+	Matrix_free(alias);
+	alias = Matrix_clone(a);
+	Matrix_gemm(1.0, alias, b, 0.0, alias);
+	assert(Matrix_equal(alias, product));
+	Matrix_free(alias);
+	Matrix_free(product);
+
+	// a product with many new positions outgrows the first guess and is computed again
+	Matrix* ones = Matrix_new(60, 60);
+	for (u32 i = 0; i < 60; ++i) {
+		Matrix_set(ones, i, 0, 1.0);
+		Matrix_set(ones, 0, i, 1.0);
+	}
+	Matrix* grown = Matrix_new(60, 60);
+	Matrix_set(grown, 5, 5, 1.0);
+	Matrix_gemm(1.0, ones, ones, 1.0, grown);
+	assert(grown->data[0].val == 60 * 60);
+	assert(Matrix_validate(grown));
+	assert(Matrix_get(grown, 0, 0) == 60.0);
+	assert(Matrix_get(grown, 5, 5) == 2.0);
+	assert(Matrix_get(grown, 7, 9) == 1.0);
+	Matrix_free(grown);
+	Matrix_free(ones);
+
+	Matrix_free(a);
+	Matrix_free(b);
+}
+
+f64 drop_odd(f64 val, u32 row, u32 col) { return (row + col) % 2 ? 0 : val; }
+
+void test_into() {
+	Matrix* a = Matrix_from_1d((f64[]){1.0, 2.0, 3.0, 4.0}, 2, 2);
+	Matrix* b = Matrix_from_1d((f64[]){5.0, 6.0, 7.0, 8.0}, 2, 2);
+	Matrix* out = Matrix_new(1, 1);
+
+	const char*	   name = Matrix_get_name(out);
+	MatrixElement* buffer = NULL;
+	for (u32 i = 0; i < 3; ++i) {
+		if (i == 1) {
+			buffer = out->data;
+		}
+		Matrix_multiply_into(out, a, b);
+		Matrix_add_into(out, a, b);
+		Matrix_hadamard_into(out, a, b);
+		Matrix_transpose_into(out, a);
+		Matrix_scale_into(out, b, 3.0);
+	}
+	assert(out->data == buffer);
+	assert(out->name == name);
+	assert(out->data[0].row == 2 && out->data[0].col == 2);
+	assert(Matrix_get(out, 1, 1) == 24.0);
+
+	Matrix_multiply_into(out, a, b);
+	assert(Matrix_get(out, 1, 0) == 43.0);
+	Matrix_add_into(out, a, b);
+	assert(Matrix_get(out, 1, 0) == 10.0);
+	Matrix_hadamard_into(out, a, b);
+	assert(Matrix_get(out, 1, 0) == 21.0);
+	Matrix_transpose_into(out, a);
+	assert(Matrix_get(out, 1, 0) == 2.0);
+
+	Matrix_scale_inplace(out, 2.0);
+	assert(Matrix_get(out, 0, 1) == 6.0);
+	Matrix_map_inplace(out, drop_odd);
+	assert(out->data[0].val == 2);
+	assert(Matrix_get(out, 0, 0) == 2.0);
+	assert(Matrix_get(out, 1, 1) == 8.0);
+	Matrix_scale_inplace(out, 0);
+	assert(out->data[0].val == 0);
+
+	Matrix* exp = Matrix_exp(a, 11);
+	Matrix_exp_into(out, a, 11);
+	assert(Matrix_equal(out, exp));
+	Matrix_exp_into(out, a, 0);
+	assert(out->data[0].val == 2);
+	assert(Matrix_get(out, 0, 0) == 1.0 && Matrix_get(out, 1, 1) == 1.0);
+	Matrix_free(exp);
+
+	Matrix_submatrix_into(out, b, (bool[]){0, 1}, (bool[]){1, 1});
+	assert(out->data[0].row == 1 && out->data[0].col == 2);
+	assert(Matrix_get(out, 0, 0) == 7.0);
+	assert(Matrix_get(out, 0, 1) == 8.0);
+
+	Matrix_free(out);
+	Matrix_free(a);
+	Matrix_free(b);
+}
+
+Matrix* random_pattern(u32 rows, u32 cols, u32 percent) {
+	Matrix* m = Matrix_new(rows, cols);
+	for (u32 i = 0; i < rows; ++i) {
+		for (u32 j = 0; j < cols; ++j) {
+			if ((u32)rand() % 100 < percent) {
+				Matrix_set(m, i, j, rand() % 5 + 1);
+			}
+		}
+	}
+	return m;
+}
+
+void test_masked() {
+	Matrix* a = Matrix_from_1d((f64[]){1.0, 2.0, 3.0, 4.0}, 2, 2);
+	Matrix* b = Matrix_from_1d((f64[]){5.0, 6.0, 7.0, 8.0}, 2, 2);
+	Matrix* diagonal = Matrix_identity(2);
+
+	Matrix* masked = Matrix_multiply_masked(a, b, diagonal, false);
+	assert(masked->data[0].val == 2);
+	assert(Matrix_get(masked, 0, 0) == 19.0);
+	assert(Matrix_get(masked, 1, 1) == 50.0);
+	Matrix_free(masked);
+
+	Matrix* complement = Matrix_multiply_masked(a, b, diagonal, true);
+	assert(complement->data[0].val == 2);
+	assert(Matrix_get(complement, 0, 1) == 22.0);
+	assert(Matrix_get(complement, 1, 0) == 43.0);
+	Matrix_free(complement);
+
+	u32 percents[][3] = {{10, 10, 5}, {90, 90, 2}, {50, 5, 60}};
+	for (u32 k = 0; k < 3; ++k) {
+		Matrix* x = random_pattern(48, 40, percents[k][0]);
+		Matrix* y = random_pattern(40, 56, percents[k][1]);
+		Matrix* mask = random_pattern(48, 56, percents[k][2]);
+		for (u32 i = 1; i <= mask->data[0].val; ++i) {
+			mask->data[i].val = 1.0;
+		}
+
+		Matrix* full = Matrix_multiply(x, y);
+		Matrix* expected = Matrix_hadamard(full, mask);
+		Matrix* rest = Matrix_axpby(1.0, full, -1.0, expected);
+
+		Matrix* got = Matrix_multiply_masked(x, y, mask, false);
+		assert(Matrix_validate(got));
+		assert(Matrix_equal(got, expected));
+		Matrix_multiply_masked_into(got, x, y, mask, true);
+		assert(Matrix_equal(got, rest));
+
+		Matrix_free(got);
+		Matrix_free(rest);
+		Matrix_free(expected);
+		Matrix_free(full);
+		Matrix_free(mask);
+		Matrix_free(y);
+		Matrix_free(x);
+	}
+
+	Matrix_free(diagonal);
+	Matrix_free(a);
+	Matrix_free(b);
+}
+
+void test_clone() {
+	Matrix* a = Matrix_from_1d((f64[]){1.0, 2.0, 0.0, 4.0}, 2, 2);
+	Matrix_rename(a, "a");
+	Matrix* snapshot = Matrix_clone(a);
+	assert(snapshot->data == a->data);
+	assert(strcmp(snapshot->name, a->name) == 0 && snapshot->name == snapshot->label);
+
+	Matrix_set(a, 1, 0, 3.0);
+	assert(snapshot->data != a->data);
+	assert(Matrix_get(a, 1, 0) == 3.0 && Matrix_get(snapshot, 1, 0) == 0.0);
+	assert(snapshot->data[0].val == 3 && a->data[0].val == 4);
+
+	Matrix* shared = Matrix_clone(snapshot);
+	Matrix_reshape(shared, 1, 2);
+	assert(shared->data[0].val == 2 && snapshot->data[0].val == 3);
+	Matrix_free(shared);
+
+	Matrix* out = Matrix_clone(snapshot);
+	Matrix_multiply_into(out, a, a);
+	assert(Matrix_get(out, 1, 1) == 22.0 && Matrix_get(snapshot, 1, 1) == 4.0);
+	Matrix_free(out);
+
+	Matrix* c = Matrix_clone(a);
+	Matrix_gemm(1.0, snapshot, snapshot, 1.0, c);
+	assert(Matrix_get(c, 0, 1) == 12.0 && Matrix_get(a, 0, 1) == 2.0);
+	Matrix_free(c);
+
+	Matrix* squared = Matrix_exp(snapshot, 2);
+	assert(Matrix_get(squared, 0, 1) == 10.0 && snapshot->data[0].val == 3);
+	Matrix_free(squared);
+
+	Matrix_free(a);
+	assert(Matrix_get(snapshot, 0, 1) == 2.0);
+	Matrix_free(snapshot);
+}
+
+void test_rebuild() {
+	// indices that use every byte, with duplicates that must keep their order
+	u32		n = 20000;
+	Matrix* m = Matrix_new(UINT32_MAX, UINT32_MAX);
+	Matrix_reserve(m, n);
+	u32 seed = 7;
+	for (u32 i = 1; i <= n; ++i) {
+		seed = seed * 1103515245 + 12345;
+		u32 row = i % 3 ? seed : seed >> 20;
+		m->data[i] = (MatrixElement){row % 1000 * 4000037, (seed >> 3) % 50 * 16777259, i};
+	}
+	m->data[0].val = n;
+	Matrix* copy = Matrix_clone(m);
+
+	Matrix_rebuild(m);
+	f64 total = 0;
+	for (u32 i = 1; i <= n; ++i) {
+		total += m->data[i].val;
+		if (i > 1) {
+			MatrixElement a = m->data[i - 1], b = m->data[i];
+			assert(a.row < b.row || (a.row == b.row && a.col < b.col) ||
+				   (a.row == b.row && a.col == b.col && a.val < b.val));
+		}
+	}
+	assert(total == (f64)n * (n + 1) / 2);
+
+	Matrix_rebuild_merge(copy);
+	assert(Matrix_validate(copy));
+	u64 at = 1;
+	for (u64 i = 1; i <= copy->data[0].val; ++i) {
+		f64 sum = 0;
+		for (; at <= n && m->data[at].row == copy->data[i].row &&
+			   m->data[at].col == copy->data[i].col;
+			 ++at) {
+			sum += m->data[at].val;
+		}
+		assert(sum == copy->data[i].val);
+	}
+	assert(at == n + 1);
+
+	// a value that cancels out is dropped
+	Matrix* pair = Matrix_new(2, 2);
+	Matrix_reserve(pair, 3);
+	pair->data[1] = (MatrixElement){1, 1, 2};
+	pair->data[2] = (MatrixElement){0, 1, 3};
+	pair->data[3] = (MatrixElement){1, 1, -2};
+	pair->data[0].val = 3;
+	Matrix_rebuild_merge(pair);
+	assert(pair->data[0].val == 1 && Matrix_get(pair, 0, 1) == 3);
+
+	Matrix_free(pair);
+	Matrix_free(copy);
+	Matrix_free(m);
+}
+
+void test_narrow() {
+	// more elements than a u8 index can count still get room for every element
+	f64 dense[20 * 20] = {0};
+	for (u32 i = 0; i < 266; ++i) {
+		dense[i] = i + 1;
+	}
+	Small* m = Small_from_1d(dense, 20, 20);
+	assert(Small_memory(m).capacity >= sizeof(SmallElement) * 267);
+	Small_reserve(m, 1000);
+	assert(Small_memory(m).capacity >= sizeof(SmallElement) * 1001);
+	Small_free(m);
+}
@@ -0,0 +1,357 @@
+#define _GNU_SOURCE
+#include "parallel.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+typedef struct ParallelGroup {
+	ParallelTask task;
+	void*		 ctx;
+	u64			 leaf;
+	u64			 remaining;
+	bool		 detached;
+	void*		 trace;
+} ParallelGroup;
+
+typedef struct ParallelJob {
+	ParallelGroup* group;
+	u64			   begin;
+	u64			   end;
+} ParallelJob;
+
+// the owner pushes and pops at the tail, thieves steal the oldest, largest ranges at the head
+typedef struct ParallelDeque {
+	pthread_mutex_t lock;
+	ParallelJob*	jobs;
+	u64				head;
+	u64				tail;
+	u64				capacity;
+} ParallelDeque;
+
+typedef struct ParallelPool ParallelPool;
+
+typedef struct ParallelWorker {
+	ParallelPool* pool;
+	u32			  slot;
+	pthread_t	  thread;
+} ParallelWorker;
+
+struct ParallelPool {
+	u32				workers;
+	u32				started;
+	ParallelWorker* worker;
+	// slot 0 is shared by the threads outside the pool, slot i by the i-th pool thread
+	ParallelDeque*	deque;
+	u64				queued;
+	u32				sleeping;
+	bool			stop;
+	pthread_mutex_t lock;
+	pthread_cond_t	work;
+	pthread_cond_t	done;
+};
+
+static u32				 configured_threads = 0;
+static bool				 pinned = false;
+static bool				 participates = true;
+static ParallelPool*	 pool = NULL;
+static pthread_mutex_t	 pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local u32 worker_slot = 0;
+
+u32 parallel_threads() {
+	if (configured_threads) {
+		return configured_threads;
+	}
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores > 0 ? (u32)cores : 1;
+}
+
+void parallel_set_threads(u32 threads) {
+	parallel_shutdown();
+	configured_threads = threads;
+}
+
+void parallel_set_affinity(bool pin) {
+	parallel_shutdown();
+	pinned = pin;
+}
+
+void parallel_set_caller_participates(bool participate) {
+	parallel_shutdown();
+	participates = participate;
+}
+
+u32 parallel_thread_index() {
+	static u32				  next_index;
+	static _Thread_local u32  index;
+	static _Thread_local bool assigned;
+	if (!assigned) {
+		index = __atomic_fetch_add(&next_index, 1, __ATOMIC_RELAXED);
+		assigned = true;
+	}
+	return index;
+}
+
+static void deque_push(ParallelDeque* d, ParallelJob job) {
+	pthread_mutex_lock(&d->lock);
+	if (d->tail == d->capacity) {
+		if (d->head > 0) {
+			memmove(d->jobs, d->jobs + d->head, sizeof(ParallelJob) * (d->tail - d->head));
+			__atomic_store_n(&d->tail, d->tail - d->head, __ATOMIC_RELAXED);
+			__atomic_store_n(&d->head, 0, __ATOMIC_RELAXED);
+		} else {
+			d->capacity = d->capacity ? d->capacity * 2 : 64;
+			d->jobs = realloc(d->jobs, sizeof(ParallelJob) * d->capacity);
+		}
+	}
+	d->jobs[d->tail] = job;
+	__atomic_store_n(&d->tail, d->tail + 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&d->lock);
+}
+
+// take the newest job when `steal` is false, the oldest otherwise, if it belongs to `group` or
+// `group` is NULL
+static bool deque_take(ParallelDeque* d, ParallelGroup* group, bool steal, ParallelJob* job) {
+	if (__atomic_load_n(&d->head, __ATOMIC_RELAXED) ==
+		__atomic_load_n(&d->tail, __ATOMIC_ACQUIRE)) {
+		return false;
+	}
+	pthread_mutex_lock(&d->lock);
+	bool found = false;
+	if (d->head < d->tail) {
+		ParallelJob* candidate = steal ? &d->jobs[d->head] : &d->jobs[d->tail - 1];
+		if (group == NULL || candidate->group == group) {
+			*job = *candidate;
+			found = true;
+			if (steal) {
+				__atomic_store_n(&d->head, d->head + 1, __ATOMIC_RELAXED);
+			} else {
+				__atomic_store_n(&d->tail, d->tail - 1, __ATOMIC_RELAXED);
+			}
+			if (d->head == d->tail) {
+				__atomic_store_n(&d->head, 0, __ATOMIC_RELAXED);
+				__atomic_store_n(&d->tail, 0, __ATOMIC_RELAXED);
+			}
+		}
+	}
+	pthread_mutex_unlock(&d->lock);
+	return found;
+}
+
+static bool pool_take(ParallelPool* p, u32 slot, ParallelGroup* group, ParallelJob* job) {
+	u32 slots = p->workers + 1;
+	for (u32 i = 0; i < slots; ++i) {
+		u32 from = (slot + i) % slots;
+		if (deque_take(&p->deque[from], group, from != slot, job)) {
+			__atomic_sub_fetch(&p->queued, 1, __ATOMIC_SEQ_CST);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void pool_push(ParallelPool* p, u32 slot, ParallelJob job) {
+	deque_push(&p->deque[slot], job);
+	__atomic_add_fetch(&p->queued, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&p->sleeping, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock(&p->lock);
+		pthread_cond_signal(&p->work);
+		pthread_mutex_unlock(&p->lock);
+	}
+}
+
+static void pool_run(ParallelPool* p, u32 slot, ParallelJob job) {
+	ParallelGroup* group = job.group;
+	while (job.end - job.begin > group->leaf) {
+		u64 mid = job.begin + (job.end - job.begin) / 2;
+		pool_push(p, slot, (ParallelJob){group, mid, job.end});
+		job.end = mid;
+	}
+	// the pieces are accounted to the operation that started the group, whichever thread runs them
+	void* trace = matrix_trace_adopt(group->trace);
+	group->task(group->ctx, job.begin, job.end);
+	matrix_trace_adopt(trace);
+	if (group->detached) {
+		free(group);
+		return;
+	}
+	if (__atomic_sub_fetch(&group->remaining, job.end - job.begin, __ATOMIC_ACQ_REL) == 0) {
+		pthread_mutex_lock(&p->lock);
+		pthread_cond_broadcast(&p->done);
+		pthread_mutex_unlock(&p->lock);
+	}
+}
+
+static void pin_thread(u32 core) {
+#ifdef __linux__
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cores <= 0) {
+		return;
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core % cores, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+#else
+	(void)core;
+#endif
+}
+
+static void* pool_work(void* arg) {
+	ParallelWorker* worker = arg;
+	ParallelPool*	p = worker->pool;
+	worker_slot = worker->slot;
+	if (pinned) {
+		pin_thread(participates ? worker->slot : worker->slot - 1);
+	}
+
+	ParallelJob job;
+	for (;;) {
+		if (pool_take(p, worker->slot, NULL, &job)) {
+			pool_run(p, worker->slot, job);
+			continue;
+		}
+		pthread_mutex_lock(&p->lock);
+		__atomic_add_fetch(&p->sleeping, 1, __ATOMIC_SEQ_CST);
+		while (!p->stop && __atomic_load_n(&p->queued, __ATOMIC_SEQ_CST) == 0) {
+			pthread_cond_wait(&p->work, &p->lock);
+		}
+		__atomic_sub_fetch(&p->sleeping, 1, __ATOMIC_SEQ_CST);
+		// pending jobs are still run when stopping, so spawned tasks are never dropped
+		bool stop = p->stop && __atomic_load_n(&p->queued, __ATOMIC_SEQ_CST) == 0;
+		pthread_mutex_unlock(&p->lock);
+		if (stop) {
+			return NULL;
+		}
+	}
+}
+
+static ParallelPool* pool_start() {
+	u32			  threads = parallel_threads();
+	ParallelPool* p = malloc(sizeof(ParallelPool));
+	p->workers = participates ? threads - 1 : threads;
+	p->started = 0;
+	p->worker = malloc(sizeof(ParallelWorker) * p->workers);
+	p->deque = calloc(p->workers + 1, sizeof(ParallelDeque));
+	for (u32 i = 0; i <= p->workers; ++i) {
+		pthread_mutex_init(&p->deque[i].lock, NULL);
+	}
+	p->queued = 0;
+	p->sleeping = 0;
+	p->stop = false;
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->work, NULL);
+	pthread_cond_init(&p->done, NULL);
+
+	for (u32 i = 0; i < p->workers; ++i) {
+		p->worker[i] = (ParallelWorker){p, i + 1, 0};
+		if (pthread_create(&p->worker[i].thread, NULL, pool_work, &p->worker[i]) != 0) {
+			break;
+		}
+		++p->started;
+	}
+	return p;
+}
+
+static ParallelPool* pool_get() {
+	ParallelPool* p = __atomic_load_n(&pool, __ATOMIC_ACQUIRE);
+	if (p) {
+		return p;
+	}
+	pthread_mutex_lock(&pool_lock);
+	if (pool == NULL) {
+		__atomic_store_n(&pool, pool_start(), __ATOMIC_RELEASE);
+	}
+	p = pool;
+	pthread_mutex_unlock(&pool_lock);
+	return p;
+}
+
+void parallel_shutdown() {
+	pthread_mutex_lock(&pool_lock);
+	ParallelPool* p = pool;
+	if (p) {
+		pthread_mutex_lock(&p->lock);
+		p->stop = true;
+		pthread_cond_broadcast(&p->work);
+		pthread_mutex_unlock(&p->lock);
+		for (u32 i = 0; i < p->started; ++i) {
+			pthread_join(p->worker[i].thread, NULL);
+		}
+		for (u32 i = 0; i <= p->workers; ++i) {
+			pthread_mutex_destroy(&p->deque[i].lock);
+			free(p->deque[i].jobs);
+		}
+		pthread_mutex_destroy(&p->lock);
+		pthread_cond_destroy(&p->work);
+		pthread_cond_destroy(&p->done);
+		free(p->deque);
+		free(p->worker);
+		free(p);
+		__atomic_store_n(&pool, NULL, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&pool_lock);
+}
+
+void parallel_for(u64 n, u64 grain, ParallelTask task, void* ctx) {
+	if (n == 0) {
+		return;
+	}
+	if (grain == 0) {
+		grain = 1;
+	}
+
+	u64 threads = parallel_threads();
+	if (threads <= 1 || n <= grain) {
+		task(ctx, 0, n);
+		return;
+	}
+	ParallelPool* p = pool_get();
+	if (p->started == 0) {
+		task(ctx, 0, n);
+		return;
+	}
+
+	u64			  pieces = threads * PARALLEL_SPLIT;
+	u64			  leaf = (n + pieces - 1) / pieces;
+	void*		  trace = matrix_trace_current();
+	ParallelGroup group = {task, ctx, leaf > grain ? leaf : grain, n, false, trace};
+	ParallelJob	  root = {&group, 0, n};
+
+	// a thread waiting for its group only runs pieces of that group, so a nested call never runs
+	// unrelated work with the allocator or arena of the task that is waiting
+	u32	 slot = worker_slot;
+	bool help = participates || slot != 0;
+	if (help) {
+		pool_run(p, slot, root);
+	} else {
+		pool_push(p, slot, root);
+	}
+	ParallelJob job;
+	while (__atomic_load_n(&group.remaining, __ATOMIC_ACQUIRE)) {
+		if (help && pool_take(p, slot, &group, &job)) {
+			pool_run(p, slot, job);
+			continue;
+		}
+		pthread_mutex_lock(&p->lock);
+		while (__atomic_load_n(&group.remaining, __ATOMIC_ACQUIRE)) {
+			pthread_cond_wait(&p->done, &p->lock);
+		}
+		pthread_mutex_unlock(&p->lock);
+	}
+}
+
+void parallel_spawn(ParallelTask task, void* ctx) {
+	ParallelPool* p = parallel_threads() > 1 ? pool_get() : NULL;
+	if (p == NULL || p->started == 0) {
+		task(ctx, 0, 1);
+		return;
+	}
+	ParallelGroup* group = malloc(sizeof(ParallelGroup));
+	*group = (ParallelGroup){task, ctx, 1, 1, true, matrix_trace_current()};
+	pool_push(p, worker_slot, (ParallelJob){group, 0, 1});
+}
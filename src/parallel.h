@@ -0,0 +1,72 @@
+/**
+ * @file parallel.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Fork-join helpers shared by the parallel matrix kernels.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include "oxidation.h"
+
+/**
+ * @brief Number of pieces per thread `parallel_for` splits a range into at most, more pieces
+ * balance uneven work better but cost more scheduling.
+ */
+#define PARALLEL_SPLIT 8
+
+/**
+ * @brief A unit of parallel work, called with the half-open range [begin, end) it should process.
+ */
+typedef void (*ParallelTask)(void* ctx, u64 begin, u64 end);
+
+/**
+ * @brief Number of threads the parallel kernels may use, defaults to the number of online cores.
+ */
+u32 parallel_threads();
+
+/**
+ * @brief Set the number of threads the parallel kernels may use, 0 restores the default. The
+ * pool is restarted with the new size, so no parallel kernel may be running.
+ */
+void parallel_set_threads(u32 threads);
+
+/**
+ * @brief Pin every pool thread to its own core. Off by default. The pool is restarted, so no
+ * parallel kernel may be running.
+ */
+void parallel_set_affinity(bool pinned);
+
+/**
+ * @brief Let the thread that calls `parallel_for` work on its own range instead of only waiting
+ * for the pool, which then has one thread less. On by default. Pool threads always work while they
+ * wait for a nested `parallel_for`. The pool is restarted, so no parallel kernel may be running.
+ */
+void parallel_set_caller_participates(bool participates);
+
+/**
+ * @brief Stop and join the pool threads. The next `parallel_for` starts them again.
+ */
+void parallel_shutdown();
+
+/**
+ * @brief A small number that identifies the calling thread, assigned in the order threads first
+ * ask for it. Use it to pick a per-thread slot.
+ */
+u32 parallel_thread_index();
+
+/**
+ * @brief Run `task` on pieces of [0, n) of at least `grain` items on the shared work-stealing
+ * pool, and return once every piece is done. Pieces are split off lazily, so idle threads steal
+ * the larger halves of a busy thread's range. Calls from inside a task, and calls from several
+ * threads at once, share the same pool threads instead of starting new ones.
+ */
+void parallel_for(u64 n, u64 grain, ParallelTask task, void* ctx);
+
+/**
+ * @brief Run `task` on [0, 1) on the pool without waiting for it. It runs on the calling thread
+ * before this returns when the pool has no threads.
+ */
+void parallel_spawn(ParallelTask task, void* ctx);
@@ -0,0 +1,183 @@
+#include "parallel.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+#define ITEMS 100000
+
+static void mark(void* ctx, u64 begin, u64 end) {
+	u8* seen = ctx;
+	for (u64 i = begin; i < end; ++i) {
+		++seen[i];
+	}
+}
+
+static void count_threads(void* ctx, u64 begin, u64 end) {
+	u64* threads = ctx;
+	for (u64 i = begin; i < end; ++i) {
+		__atomic_or_fetch(threads, (u64)1 << (parallel_thread_index() % 64), __ATOMIC_RELAXED);
+	}
+}
+
+static void nested(void* ctx, u64 begin, u64 end) {
+	u8* seen = ctx;
+	for (u64 i = begin; i < end; ++i) {
+		parallel_for(ITEMS / 100, 1, mark, seen + i * (ITEMS / 100));
+	}
+}
+
+static void* caller(void* arg) {
+	u8* seen = arg;
+	for (u32 round = 0; round < 20; ++round) {
+		parallel_for(ITEMS, 64, mark, seen);
+		parallel_for(10, 1, nested, seen);
+	}
+	return NULL;
+}
+
+static void check(u8* seen, u8 times) {
+	for (u64 i = 0; i < ITEMS; ++i) {
+		assert(seen[i] == times);
+	}
+}
+
+static Matrix* random_matrix(u32 row, u32 col, u32 nnz, u32 seed) {
+	Matrix* m = Matrix_new(row, col);
+	Matrix_reserve(m, nnz);
+	for (u32 i = 1; i <= nnz; ++i) {
+		seed = seed * 1103515245 + 12345;
+		m->data[i] = (MatrixElement){(seed >> 8) % row, i % col, (seed >> 4) % 7 + 1};
+	}
+	m->data[0].val = nnz;
+	Matrix_rebuild(m);
+	u64 n = 0;
+	for (u64 i = 1; i <= nnz; ++i) {
+		if (n == 0 || m->data[i].row != m->data[n].row || m->data[i].col != m->data[n].col) {
+			m->data[++n] = m->data[i];
+		}
+	}
+	m->data[0].val = n;
+	return m;
+}
+
+static Matrix* shuffled(u32 nnz, u32 seed) {
+	Matrix* m = Matrix_new(300, 70000);
+	Matrix_reserve(m, nnz);
+	for (u32 i = 1; i <= nnz; ++i) {
+		seed = seed * 1103515245 + 12345;
+		u32 col = i % 5 ? (seed >> 4) % 70000 : i % 3;
+		m->data[i] = (MatrixElement){(seed >> 8) % 300, col, i};
+	}
+	m->data[0].val = nnz;
+	return m;
+}
+
+static void test_sort() {
+	parallel_set_threads(1);
+	Matrix* serial = shuffled(50000, 3);
+	Matrix_rebuild(serial);
+	parallel_set_threads(4);
+	Matrix* parallel = shuffled(50000, 3);
+	Matrix_rebuild(parallel);
+	// the radix passes are stable, so duplicates end up in the same order either way
+	assert(memcmp(serial->data, parallel->data, sizeof(MatrixElement) * 50001) == 0);
+	Matrix_free(parallel);
+	Matrix_free(serial);
+}
+
+static void test_kernels() {
+	Matrix* a = random_matrix(500, 400, 20000, 7);
+	Matrix* b = random_matrix(400, 300, 15000, 11);
+	f64*	dense = Matrix_to_1d(a);
+
+	parallel_set_threads(1);
+	Matrix* product = Matrix_multiply(a, b);
+	Matrix* transposed = Matrix_transpose(a);
+	Matrix* sorted = Matrix_transpose(transposed);
+	for (u64 i = 1, n = sorted->data[0].val; i <= n / 2; ++i) {
+		MatrixElement e = sorted->data[i];
+		sorted->data[i] = sorted->data[n + 1 - i];
+		sorted->data[n + 1 - i] = e;
+	}
+
+	parallel_set_threads(4);
+	Matrix* p = Matrix_multiply(a, b);
+	assert(Matrix_validate(p) && Matrix_equal(p, product));
+	Matrix* t = Matrix_transpose(a);
+	assert(Matrix_validate(t) && Matrix_equal(t, transposed));
+	Matrix_rebuild(sorted);
+	assert(Matrix_validate(sorted) && Matrix_equal(sorted, a));
+	Matrix* back = Matrix_from_1d(dense, 500, 400);
+	assert(Matrix_validate(back) && Matrix_equal(back, a));
+	f64* again = Matrix_to_1d(back);
+	for (u32 i = 0; i < 500 * 400; ++i) {
+		assert(again[i] == dense[i]);
+	}
+
+	free(again);
+	free(dense);
+	Matrix_free(back);
+	Matrix_free(t);
+	Matrix_free(p);
+	Matrix_free(sorted);
+	Matrix_free(transposed);
+	Matrix_free(product);
+	Matrix_free(b);
+	Matrix_free(a);
+}
+
+int main() {
+	u8* seen = calloc(ITEMS, 1);
+
+	parallel_set_threads(4);
+	parallel_for(ITEMS, 1, mark, seen);
+	check(seen, 1);
+	u64 threads = 0;
+	parallel_for(ITEMS, 1, count_threads, &threads);
+	assert(threads != 0);
+
+	parallel_for(100, 1, nested, seen);
+	check(seen, 2);
+
+	pthread_t callers[3];
+	u8*		  own[3];
+	for (u32 t = 0; t < 3; ++t) {
+		own[t] = calloc(ITEMS, 1);
+		pthread_create(&callers[t], NULL, caller, own[t]);
+	}
+	for (u32 t = 0; t < 3; ++t) {
+		pthread_join(callers[t], NULL);
+		for (u64 i = 0; i < ITEMS; ++i) {
+			assert(own[t][i] == (i < ITEMS / 10 ? 40 : 20));
+		}
+		free(own[t]);
+	}
+
+	for (u64 i = 0; i < ITEMS; ++i) {
+		seen[i] = 0;
+	}
+	parallel_set_caller_participates(false);
+	parallel_set_affinity(true);
+	parallel_for(ITEMS, 1, mark, seen);
+	parallel_for(100, 1, nested, seen);
+	check(seen, 2);
+	parallel_set_affinity(false);
+	parallel_set_caller_participates(true);
+
+	test_kernels();
+	test_sort();
+
+	parallel_set_threads(0);
+	parallel_shutdown();
+	free(seen);
+
+	return EXIT_SUCCESS;
+}
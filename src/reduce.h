@@ -0,0 +1,565 @@
+/**
+ * @file reduce.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Per-row and per-column reductions and matrix norms.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <string.h>
+
+#include "oxidation.h"
+#include "parallel.h"
+#include "utils.h"
+
+/**
+ * @brief Number of elements a reduction hands to one thread at a time.
+ */
+#define MATRIX_REDUCE_GRAIN 4096
+
+/**
+ * @brief Reductions over the stored elements of each row or column. A row or column without
+ * stored elements reduces to 0.
+ */
+typedef enum MatrixReduce {
+	MATRIX_REDUCE_SUM,
+	MATRIX_REDUCE_ABS_SUM,
+	MATRIX_REDUCE_MIN,
+	MATRIX_REDUCE_MAX,
+	MATRIX_REDUCE_COUNT,
+} MatrixReduce;
+
+/**
+ * @brief Number of elements in each block of a whole-matrix reduction. Blocks are reduced in
+ * parallel and their results are combined in block order, so the result does not depend on the
+ * number of threads.
+ */
+#define MATRIX_SUM_BLOCK 4096
+
+/**
+ * @brief Number of blocks a whole-matrix reduction hands to one thread at a time.
+ */
+#define MATRIX_SUM_GRAIN 16
+
+/**
+ * @brief How `_sum_with` adds up the elements: with several independent accumulators, with
+ * Kahan compensation, or by pairwise (cascade) summation.
+ */
+typedef enum MatrixSum {
+	MATRIX_SUM_FAST,
+	MATRIX_SUM_KAHAN,
+	MATRIX_SUM_PAIRWISE,
+} MatrixSum;
+
+/**
+ * @brief What a whole-matrix reduction looks at: the stored values, their magnitudes (for
+ * `_norm_max`) or their squares (for `_norm_frobenius`).
+ */
+typedef enum MatrixValue {
+	MATRIX_VALUE_PLAIN,
+	MATRIX_VALUE_ABS,
+	MATRIX_VALUE_SQUARE,
+} MatrixValue;
+
+#define MATRIX_REDUCE_METHOD(_name, _data_type, _index_type)                                       \
+	typedef struct _name##ReduceJob {                                                              \
+		const _name##Element* e;                                                                   \
+		u64					  count;                                                               \
+		MatrixReduce		  op;                                                                  \
+		u64					  blocks;                                                              \
+		_index_type			  cols;                                                                \
+		_data_type*			  val;                                                                 \
+		_index_type*		  arg;                                                                 \
+		u8*					  seen;                                                                \
+		MatrixSum			  mode;                                                                \
+		MatrixValue			  value;                                                               \
+		_data_type*			  out;                                                                 \
+		_index_type*		  out_arg;                                                             \
+	} _name##ReduceJob;                                                                            \
+                                                                                                   \
+	static inline _data_type _name##_value(_data_type x, MatrixValue value) {                      \
+		if (value == MATRIX_VALUE_SQUARE) {                                                        \
+			return x * x;                                                                          \
+		}                                                                                          \
+		return value == MATRIX_VALUE_ABS && x < 0 ? -x : x;                                        \
+	}                                                                                              \
+                                                                                                   \
+	static _data_type _name##_kernel_sum(const _name##Element* e, u64 n, MatrixValue value) {      \
+		_data_type s0 = 0, s1 = 0, s2 = 0, s3 = 0;                                                 \
+		u64		   i = 0;                                                                          \
+		for (; i + 4 <= n; i += 4) {                                                               \
+			s0 += _name##_value(e[i].val, value);                                                  \
+			s1 += _name##_value(e[i + 1].val, value);                                              \
+			s2 += _name##_value(e[i + 2].val, value);                                              \
+			s3 += _name##_value(e[i + 3].val, value);                                              \
+		}                                                                                          \
+		for (; i < n; ++i) {                                                                       \
+			s0 += _name##_value(e[i].val, value);                                                  \
+		}                                                                                          \
+		return (s0 + s1) + (s2 + s3);                                                              \
+	}                                                                                              \
+                                                                                                   \
+	static _data_type _name##_kernel_sum_kahan(const _name##Element* e, u64 n,                     \
+											   MatrixValue value) {                                \
+		_data_type sum = 0, carry = 0;                                                             \
+		for (u64 i = 0; i < n; ++i) {                                                              \
+			_data_type y = _name##_value(e[i].val, value) - carry;                                 \
+			_data_type t = sum + y;                                                                \
+			carry = (t - sum) - y;                                                                 \
+			sum = t;                                                                               \
+		}                                                                                          \
+		return sum;                                                                                \
+	}                                                                                              \
+                                                                                                   \
+	static _data_type _name##_kernel_sum_pairwise(const _name##Element* e, u64 n,                  \
+												  MatrixValue value) {                             \
+		if (n <= 128) {                                                                            \
+			return _name##_kernel_sum(e, n, value);                                                \
+		}                                                                                          \
+		return _name##_kernel_sum_pairwise(e, n / 2, value) +                                      \
+			   _name##_kernel_sum_pairwise(e + n / 2, n - n / 2, value);                           \
+	}                                                                                              \
+                                                                                                   \
+	static _data_type _name##_kernel_extreme(const _name##Element* e, u64 n, MatrixReduce op,      \
+											 MatrixValue value) {                                  \
+		_data_type m0 = _name##_value(e[0].val, value), m1 = m0, m2 = m0, m3 = m0;                 \
+		u64		   i = 0;                                                                          \
+		if (op == MATRIX_REDUCE_MAX) {                                                             \
+			for (; i + 4 <= n; i += 4) {                                                           \
+				_data_type x0 = _name##_value(e[i].val, value);                                    \
+				_data_type x1 = _name##_value(e[i + 1].val, value);                                \
+				_data_type x2 = _name##_value(e[i + 2].val, value);                                \
+				_data_type x3 = _name##_value(e[i + 3].val, value);                                \
+				m0 = x0 > m0 ? x0 : m0;                                                            \
+				m1 = x1 > m1 ? x1 : m1;                                                            \
+				m2 = x2 > m2 ? x2 : m2;                                                            \
+				m3 = x3 > m3 ? x3 : m3;                                                            \
+			}                                                                                      \
+			for (; i < n; ++i) {                                                                   \
+				_data_type x = _name##_value(e[i].val, value);                                     \
+				m0 = x > m0 ? x : m0;                                                              \
+			}                                                                                      \
+			m0 = m1 > m0 ? m1 : m0;                                                                \
+			m2 = m3 > m2 ? m3 : m2;                                                                \
+			return m2 > m0 ? m2 : m0;                                                              \
+		}                                                                                          \
+		for (; i + 4 <= n; i += 4) {                                                               \
+			_data_type x0 = _name##_value(e[i].val, value);                                        \
+			_data_type x1 = _name##_value(e[i + 1].val, value);                                    \
+			_data_type x2 = _name##_value(e[i + 2].val, value);                                    \
+			_data_type x3 = _name##_value(e[i + 3].val, value);                                    \
+			m0 = x0 < m0 ? x0 : m0;                                                                \
+			m1 = x1 < m1 ? x1 : m1;                                                                \
+			m2 = x2 < m2 ? x2 : m2;                                                                \
+			m3 = x3 < m3 ? x3 : m3;                                                                \
+		}                                                                                          \
+		for (; i < n; ++i) {                                                                       \
+			_data_type x = _name##_value(e[i].val, value);                                         \
+			m0 = x < m0 ? x : m0;                                                                  \
+		}                                                                                          \
+		m0 = m1 < m0 ? m1 : m0;                                                                    \
+		m2 = m3 < m2 ? m3 : m2;                                                                    \
+		return m2 < m0 ? m2 : m0;                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_reduce_blocks_task(void* ctx, u64 begin, u64 end) {                        \
+		_name##ReduceJob* job = ctx;                                                               \
+		for (u64 b = begin; b < end; ++b) {                                                        \
+			const _name##Element* e = job->e + b * MATRIX_SUM_BLOCK;                               \
+			u64					  n = job->count - b * MATRIX_SUM_BLOCK;                           \
+			n = n < MATRIX_SUM_BLOCK ? n : MATRIX_SUM_BLOCK;                                       \
+			if (job->op == MATRIX_REDUCE_MIN || job->op == MATRIX_REDUCE_MAX) {                    \
+				job->val[b] = _name##_kernel_extreme(e, n, job->op, job->value);                   \
+			} else if (job->mode == MATRIX_SUM_KAHAN) {                                            \
+				job->val[b] = _name##_kernel_sum_kahan(e, n, job->value);                          \
+			} else if (job->mode == MATRIX_SUM_PAIRWISE) {                                         \
+				job->val[b] = _name##_kernel_sum_pairwise(e, n, job->value);                       \
+			} else {                                                                               \
+				job->val[b] = _name##_kernel_sum(e, n, job->value);                                \
+			}                                                                                      \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static _data_type _name##_reduce_partials(const _data_type* v, u64 n, MatrixSum mode) {        \
+		_data_type sum = 0, carry = 0;                                                             \
+		if (mode == MATRIX_SUM_PAIRWISE && n > 2) {                                                \
+			return _name##_reduce_partials(v, n / 2, mode) +                                       \
+				   _name##_reduce_partials(v + n / 2, n - n / 2, mode);                            \
+		}                                                                                          \
+		for (u64 i = 0; i < n; ++i) {                                                              \
+			if (mode == MATRIX_SUM_KAHAN) {                                                        \
+				_data_type y = v[i] - carry;                                                       \
+				_data_type t = sum + y;                                                            \
+				carry = (t - sum) - y;                                                             \
+				sum = t;                                                                           \
+			} else {                                                                               \
+				sum += v[i];                                                                       \
+			}                                                                                      \
+		}                                                                                          \
+		return sum;                                                                                \
+	}                                                                                              \
+                                                                                                   \
+	static _data_type _name##_reduce_all(_name* m, MatrixReduce op, MatrixSum mode,                \
+										 MatrixValue value) {                                      \
+		u64 count = m->data[0].val, blocks = (count + MATRIX_SUM_BLOCK - 1) / MATRIX_SUM_BLOCK;    \
+		if (count == 0) {                                                                          \
+			return 0;                                                                              \
+		}                                                                                          \
+                                                                                                   \
+		_name##ReduceJob job = {m->data + 1,                                                       \
+								count,                                                             \
+								op,                                                                \
+								blocks,                                                            \
+								0,                                                                 \
+								NULL,                                                              \
+								NULL,                                                              \
+								NULL,                                                              \
+								mode,                                                              \
+								value,                                                             \
+								NULL,                                                              \
+								NULL};                                                             \
+		job.val = scratch_alloc(sizeof(_data_type) * blocks);                                      \
+		parallel_for(blocks, MATRIX_SUM_GRAIN, _name##_reduce_blocks_task, &job);                  \
+                                                                                                   \
+		_data_type ans = job.val[0];                                                               \
+		if (op == MATRIX_REDUCE_MIN || op == MATRIX_REDUCE_MAX) {                                  \
+			for (u64 b = 1; b < blocks; ++b) {                                                     \
+				bool better = op == MATRIX_REDUCE_MIN ? job.val[b] < ans : job.val[b] > ans;       \
+				ans = better ? job.val[b] : ans;                                                   \
+			}                                                                                      \
+		} else {                                                                                   \
+			ans = _name##_reduce_partials(job.val, blocks, mode);                                  \
+		}                                                                                          \
+		scratch_free(job.val);                                                                     \
+		return ans;                                                                                \
+	}                                                                                              \
+                                                                                                   \
+	_data_type _name##_sum_with(_name* m, MatrixSum mode) {                                        \
+		return _name##_reduce_all(m, MATRIX_REDUCE_SUM, mode, MATRIX_VALUE_PLAIN);                 \
+	}                                                                                              \
+                                                                                                   \
+	_data_type _name##_sum(_name* m) { return _name##_sum_with(m, MATRIX_SUM_FAST); }              \
+                                                                                                   \
+	_data_type _name##_mean(_name* m) {                                                            \
+		return m->data[0].val ? _name##_sum(m) / m->data[0].val : 0;                               \
+	}                                                                                              \
+                                                                                                   \
+	_data_type _name##_max_value(_name* m) {                                                       \
+		return _name##_reduce_all(m, MATRIX_REDUCE_MAX, MATRIX_SUM_FAST, MATRIX_VALUE_PLAIN);      \
+	}                                                                                              \
+                                                                                                   \
+	_data_type _name##_min_value(_name* m) {                                                       \
+		return _name##_reduce_all(m, MATRIX_REDUCE_MIN, MATRIX_SUM_FAST, MATRIX_VALUE_PLAIN);      \
+	}                                                                                              \
+                                                                                                   \
+	_data_type _name##_trace(_name* m) {                                                           \
+		const _name##Element* e = m->data + 1;                                                     \
+		u64					  n = m->data[0].val, pos = 0;                                         \
+		_index_type			  r = 0;                                                               \
+		_data_type			  ans = 0;                                                             \
+		while (pos < n) {                                                                          \
+			_name##Element key = {r, r, 0};                                                        \
+			pos = _name##_kernel_gallop(e, pos, n, &key);                                          \
+			if (pos == n) {                                                                        \
+				break;                                                                             \
+			}                                                                                      \
+			if (e[pos].row == r && e[pos].col == r) {                                              \
+				ans += e[pos].val;                                                                 \
+				++r;                                                                               \
+			} else {                                                                               \
+				r = e[pos].row > r ? e[pos].row : r + 1;                                           \
+			}                                                                                      \
+		}                                                                                          \
+		return ans;                                                                                \
+	}                                                                                              \
+                                                                                                   \
+	static _data_type _name##_kernel_reduce(const _name##Element* e, u64 n, MatrixReduce op,       \
+											_index_type* arg) {                                    \
+		_data_type ans = 0;                                                                        \
+		u64		   best = 0;                                                                       \
+		switch (op) {                                                                              \
+			case MATRIX_REDUCE_SUM:                                                                \
+				for (u64 i = 0; i < n; ++i) {                                                      \
+					ans += e[i].val;                                                               \
+				}                                                                                  \
+				break;                                                                             \
+			case MATRIX_REDUCE_ABS_SUM:                                                            \
+				for (u64 i = 0; i < n; ++i) {                                                      \
+					ans += e[i].val < 0 ? -e[i].val : e[i].val;                                    \
+				}                                                                                  \
+				break;                                                                             \
+			case MATRIX_REDUCE_MIN:                                                                \
+				ans = e[0].val;                                                                    \
+				for (u64 i = 1; i < n; ++i) {                                                      \
+					if (e[i].val < ans) {                                                          \
+						ans = e[i].val;                                                            \
+						best = i;                                                                  \
+					}                                                                              \
+				}                                                                                  \
+				break;                                                                             \
+			case MATRIX_REDUCE_MAX:                                                                \
+				ans = e[0].val;                                                                    \
+				for (u64 i = 1; i < n; ++i) {                                                      \
+					if (e[i].val > ans) {                                                          \
+						ans = e[i].val;                                                            \
+						best = i;                                                                  \
+					}                                                                              \
+				}                                                                                  \
+				break;                                                                             \
+			case MATRIX_REDUCE_COUNT:                                                              \
+				ans = n;                                                                           \
+				break;                                                                             \
+		}                                                                                          \
+		if (arg) {                                                                                 \
+			*arg = e[best].col;                                                                    \
+		}                                                                                          \
+		return ans;                                                                                \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_reduce_rows_task(void* ctx, u64 begin, u64 end) {                          \
+		_name##ReduceJob*	  job = ctx;                                                           \
+		const _name##Element* e = job->e;                                                          \
+		while (begin > 0 && begin < job->count && e[begin].row == e[begin - 1].row) {              \
+			++begin;                                                                               \
+		}                                                                                          \
+		while (end > 0 && end < job->count && e[end].row == e[end - 1].row) {                      \
+			++end;                                                                                 \
+		}                                                                                          \
+		for (u64 i = begin; i < end;) {                                                            \
+			u64 j = i;                                                                             \
+			while (j < end && e[j].row == e[i].row) {                                              \
+				++j;                                                                               \
+			}                                                                                      \
+			_index_type* arg = job->arg ? job->arg + e[i].row : NULL;                              \
+			job->val[e[i].row] = _name##_kernel_reduce(e + i, j - i, job->op, arg);                \
+			i = j;                                                                                 \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	/* block 0 reduces straight into the output, the others into partials merged afterwards */     \
+	static void _name##_reduce_cols_task(void* ctx, u64 begin, u64 end) {                          \
+		_name##ReduceJob* job = ctx;                                                               \
+		for (u64 b = begin; b < end; ++b) {                                                        \
+			const _name##Element* e = job->e;                                                      \
+			u64					  lo = job->count * b / job->blocks;                               \
+			u64					  hi = job->count * (b + 1) / job->blocks;                         \
+			_data_type*			  val = b ? job->val + (b - 1) * job->cols : job->out;             \
+			_index_type*		  arg = job->out_arg;                                              \
+			u8*					  seen = job->seen + b * job->cols;                                \
+			if (arg && b) {                                                                        \
+				arg = job->arg + (b - 1) * job->cols;                                              \
+			}                                                                                      \
+			memset(val, 0, sizeof(_data_type) * job->cols);                                        \
+			switch (job->op) {                                                                     \
+				case MATRIX_REDUCE_SUM:                                                            \
+					for (u64 i = lo; i < hi; ++i) {                                                \
+						val[e[i].col] += e[i].val;                                                 \
+					}                                                                              \
+					break;                                                                         \
+				case MATRIX_REDUCE_ABS_SUM:                                                        \
+					for (u64 i = lo; i < hi; ++i) {                                                \
+						val[e[i].col] += e[i].val < 0 ? -e[i].val : e[i].val;                      \
+					}                                                                              \
+					break;                                                                         \
+				case MATRIX_REDUCE_MIN:                                                            \
+				case MATRIX_REDUCE_MAX:                                                            \
+					memset(seen, 0, job->cols);                                                    \
+					for (u64 i = lo; i < hi; ++i) {                                                \
+						_data_type	x = e[i].val;                                                  \
+						_index_type c = e[i].col;                                                  \
+						bool		min = job->op == MATRIX_REDUCE_MIN;                            \
+						if (!seen[c] || (min ? x < val[c] : x > val[c])) {                         \
+							seen[c] = 1;                                                           \
+							val[c] = x;                                                            \
+							if (arg) {                                                             \
+								arg[c] = e[i].row;                                                 \
+							}                                                                      \
+						}                                                                          \
+					}                                                                              \
+					break;                                                                         \
+				case MATRIX_REDUCE_COUNT:                                                          \
+					for (u64 i = lo; i < hi; ++i) {                                                \
+						++val[e[i].col];                                                           \
+					}                                                                              \
+					break;                                                                         \
+			}                                                                                      \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static void _name##_reduce_rows_run(_name* m, MatrixReduce op, _data_type* out,                \
+										_index_type* arg) {                                        \
+		_name##ReduceJob job = {m->data + 1,                                                       \
+								m->data[0].val,                                                    \
+								op,                                                                \
+								0,                                                                 \
+								0,                                                                 \
+								out,                                                               \
+								arg,                                                               \
+								NULL,                                                              \
+								0,                                                                 \
+								MATRIX_VALUE_PLAIN,                                                \
+								NULL,                                                              \
+								NULL};                                                             \
+		for (_index_type r = 0; r < m->data[0].row; ++r) {                                         \
+			out[r] = 0;                                                                            \
+			if (arg) {                                                                             \
+				arg[r] = m->data[0].col;                                                           \
+			}                                                                                      \
+		}                                                                                          \
+		parallel_for(job.count, MATRIX_REDUCE_GRAIN, _name##_reduce_rows_task, &job);              \
+	}                                                                                              \
+                                                                                                   \
+	/* the partials take (blocks - 1) * cols entries, so there are never more blocks than stored   \
+	 * elements per column, as in _transpose_parallel */                                           \
+	static void _name##_reduce_cols_run(_name* m, MatrixReduce op, _data_type* out,                \
+										_index_type* arg) {                                        \
+		u64 cols = m->data[0].col, nnz = m->data[0].val, blocks = nnz / MATRIX_REDUCE_GRAIN;       \
+		if (blocks > parallel_threads()) {                                                         \
+			blocks = parallel_threads();                                                           \
+		}                                                                                          \
+		if (blocks > nnz / (cols + 1)) {                                                           \
+			blocks = nnz / (cols + 1);                                                             \
+		}                                                                                          \
+		if (blocks == 0) {                                                                         \
+			blocks = 1;                                                                            \
+		}                                                                                          \
+                                                                                                   \
+		bool			 extreme = op == MATRIX_REDUCE_MIN || op == MATRIX_REDUCE_MAX;             \
+		_name##ReduceJob job = {m->data + 1,                                                       \
+								nnz,                                                               \
+								op,                                                                \
+								blocks,                                                            \
+								cols,                                                              \
+								NULL,                                                              \
+								NULL,                                                              \
+								NULL,                                                              \
+								0,                                                                 \
+								MATRIX_VALUE_PLAIN,                                                \
+								out,                                                               \
+								arg};                                                              \
+		if (blocks > 1) {                                                                          \
+			job.val = scratch_alloc(sizeof(_data_type) * (blocks - 1) * cols);                     \
+		}                                                                                          \
+		if (blocks > 1 && arg) {                                                                   \
+			job.arg = scratch_alloc(sizeof(_index_type) * (blocks - 1) * cols);                    \
+		}                                                                                          \
+		if (extreme) {                                                                             \
+			job.seen = scratch_alloc(blocks * cols);                                               \
+		}                                                                                          \
+		for (u64 c = 0; arg && c < cols; ++c) {                                                    \
+			arg[c] = m->data[0].row;                                                               \
+		}                                                                                          \
+		parallel_for(blocks, 1, _name##_reduce_cols_task, &job);                                   \
+                                                                                                   \
+		for (u64 b = 1; b < blocks; ++b) {                                                         \
+			const _data_type* val = job.val + (b - 1) * cols;                                      \
+			const u8*		  seen = extreme ? job.seen + b * cols : NULL;                         \
+			for (u64 c = 0; c < cols; ++c) {                                                       \
+				if (!extreme) {                                                                    \
+					out[c] += val[c];                                                              \
+					continue;                                                                      \
+				}                                                                                  \
+				bool better = op == MATRIX_REDUCE_MIN ? val[c] < out[c] : val[c] > out[c];         \
+				if (seen[c] && (!job.seen[c] || better)) {                                         \
+					job.seen[c] = 1;                                                               \
+					out[c] = val[c];                                                               \
+					if (arg) {                                                                     \
+						arg[c] = job.arg[(b - 1) * cols + c];                                      \
+					}                                                                              \
+				}                                                                                  \
+			}                                                                                      \
+		}                                                                                          \
+                                                                                                   \
+		scratch_free(job.seen);                                                                    \
+		scratch_free(job.arg);                                                                     \
+		scratch_free(job.val);                                                                     \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_reduce_rows(_name* m, MatrixReduce op, _data_type* out) {                         \
+		_name##_reduce_rows_run(m, op, out, NULL);                                                 \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_reduce_cols(_name* m, MatrixReduce op, _data_type* out) {                         \
+		_name##_reduce_cols_run(m, op, out, NULL);                                                 \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_argmax_rows(_name* m, _index_type* out) {                                         \
+		_data_type* val = scratch_alloc(sizeof(_data_type) * m->data[0].row);                      \
+		_name##_reduce_rows_run(m, MATRIX_REDUCE_MAX, val, out);                                   \
+		scratch_free(val);                                                                         \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_argmin_rows(_name* m, _index_type* out) {                                         \
+		_data_type* val = scratch_alloc(sizeof(_data_type) * m->data[0].row);                      \
+		_name##_reduce_rows_run(m, MATRIX_REDUCE_MIN, val, out);                                   \
+		scratch_free(val);                                                                         \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_argmax_cols(_name* m, _index_type* out) {                                         \
+		_data_type* val = scratch_alloc(sizeof(_data_type) * m->data[0].col);                      \
+		_name##_reduce_cols_run(m, MATRIX_REDUCE_MAX, val, out);                                   \
+		scratch_free(val);                                                                         \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_argmin_cols(_name* m, _index_type* out) {                                         \
+		_data_type* val = scratch_alloc(sizeof(_data_type) * m->data[0].col);                      \
+		_name##_reduce_cols_run(m, MATRIX_REDUCE_MIN, val, out);                                   \
+		scratch_free(val);                                                                         \
+	}                                                                                              \
+                                                                                                   \
+	_data_type _name##_norm_one(_name* m) {                                                        \
+		_data_type* sum = scratch_alloc(sizeof(_data_type) * m->data[0].col);                      \
+		_data_type	ans = 0;                                                                       \
+		_name##_reduce_cols(m, MATRIX_REDUCE_ABS_SUM, sum);                                        \
+		for (_index_type c = 0; c < m->data[0].col; ++c) {                                         \
+			ans = sum[c] > ans ? sum[c] : ans;                                                     \
+		}                                                                                          \
+		scratch_free(sum);                                                                         \
+		return ans;                                                                                \
+	}                                                                                              \
+                                                                                                   \
+	_data_type _name##_norm_inf(_name* m) {                                                        \
+		_data_type* sum = scratch_alloc(sizeof(_data_type) * m->data[0].row);                      \
+		_data_type	ans = 0;                                                                       \
+		_name##_reduce_rows(m, MATRIX_REDUCE_ABS_SUM, sum);                                        \
+		for (_index_type r = 0; r < m->data[0].row; ++r) {                                         \
+			ans = sum[r] > ans ? sum[r] : ans;                                                     \
+		}                                                                                          \
+		scratch_free(sum);                                                                         \
+		return ans;                                                                                \
+	}                                                                                              \
+                                                                                                   \
+	_data_type _name##_norm_frobenius_with(_name* m, MatrixSum mode) {                             \
+		return sqrt(_name##_reduce_all(m, MATRIX_REDUCE_SUM, mode, MATRIX_VALUE_SQUARE));          \
+	}                                                                                              \
+                                                                                                   \
+	_data_type _name##_norm_frobenius(_name* m) {                                                  \
+		return _name##_norm_frobenius_with(m, MATRIX_SUM_FAST);                                    \
+	}                                                                                              \
+                                                                                                   \
+	_data_type _name##_norm_max(_name* m) {                                                        \
+		return _name##_reduce_all(m, MATRIX_REDUCE_MAX, MATRIX_SUM_FAST, MATRIX_VALUE_ABS);        \
+	}
+
+#define MATRIX_REDUCE_METHOD_DECLARE(_name, _data_type, _index_type)                               \
+	void	   _name##_reduce_rows(_name* m, MatrixReduce op, _data_type* out);                    \
+	void	   _name##_reduce_cols(_name* m, MatrixReduce op, _data_type* out);                    \
+	void	   _name##_argmax_rows(_name* m, _index_type* out);                                    \
+	void	   _name##_argmin_rows(_name* m, _index_type* out);                                    \
+	void	   _name##_argmax_cols(_name* m, _index_type* out);                                    \
+	void	   _name##_argmin_cols(_name* m, _index_type* out);                                    \
+	_data_type _name##_norm_one(_name* m);                                                         \
+	_data_type _name##_norm_inf(_name* m);                                                         \
+	_data_type _name##_norm_frobenius_with(_name* m, MatrixSum mode);                              \
+	_data_type _name##_norm_frobenius(_name* m);                                                   \
+	_data_type _name##_norm_max(_name* m);                                                         \
+	_data_type _name##_sum_with(_name* m, MatrixSum mode);                                         \
+	_data_type _name##_sum(_name* m);                                                              \
+	_data_type _name##_mean(_name* m);                                                             \
+	_data_type _name##_max_value(_name* m);                                                        \
+	_data_type _name##_min_value(_name* m);                                                        \
+	_data_type _name##_trace(_name* m);
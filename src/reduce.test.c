@@ -0,0 +1,159 @@
+#include "reduce.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+int main() {
+	srand(1481);
+	parallel_set_threads(4);
+
+	Matrix* m = Matrix_from_1d((f64[]){1.0, -5.0, 3.0, 0.0, 0.0, 0.0, -2.0, 4.0, 2.0}, 3, 3);
+	f64		rows[3], cols[3];
+	u32		arg[3];
+
+	Matrix_reduce_rows(m, MATRIX_REDUCE_SUM, rows);
+	assert(rows[0] == -1.0 && rows[1] == 0.0 && rows[2] == 4.0);
+	Matrix_reduce_cols(m, MATRIX_REDUCE_ABS_SUM, cols);
+	assert(cols[0] == 3.0 && cols[1] == 9.0 && cols[2] == 5.0);
+	Matrix_reduce_rows(m, MATRIX_REDUCE_COUNT, rows);
+	assert(rows[0] == 3.0 && rows[1] == 0.0 && rows[2] == 3.0);
+	Matrix_reduce_cols(m, MATRIX_REDUCE_MIN, cols);
+	assert(cols[0] == -2.0 && cols[1] == -5.0 && cols[2] == 2.0);
+
+	Matrix_argmax_rows(m, arg);
+	assert(arg[0] == 2 && arg[1] == 3 && arg[2] == 1);
+	Matrix_argmin_rows(m, arg);
+	assert(arg[0] == 1 && arg[2] == 0);
+	Matrix_argmax_cols(m, arg);
+	assert(arg[0] == 0 && arg[1] == 2 && arg[2] == 0);
+	Matrix_argmin_cols(m, arg);
+	assert(arg[0] == 2 && arg[1] == 0 && arg[2] == 2);
+
+	assert(Matrix_norm_one(m) == 9.0);
+	assert(Matrix_norm_inf(m) == 9.0);
+	assert(Matrix_norm_max(m) == 5.0);
+	assert(Matrix_norm_frobenius(m) == sqrt(59.0));
+	Matrix_free(m);
+
+	u32		size = 400;
+	Matrix* big = Matrix_new(size, size);
+	Matrix_reserve(big, size * size);
+	u64 n = 0;
+	for (u32 i = 0; i < size; ++i) {
+		for (u32 j = 0; j < size; ++j) {
+			if (rand() % 8 == 0) {
+				big->data[++n] = (MatrixElement){i, j, rand() % 19 - 9};
+			}
+		}
+	}
+	big->data[0].val = n;
+
+	f64 sums[400], maxs[400], counts[400], expected_sums[400] = {0}, expected_maxs[400];
+	u32 args[400], expected_args[400];
+	Matrix_reduce_cols(big, MATRIX_REDUCE_SUM, sums);
+	Matrix_reduce_cols(big, MATRIX_REDUCE_MAX, maxs);
+	Matrix_reduce_cols(big, MATRIX_REDUCE_COUNT, counts);
+	Matrix_argmax_cols(big, args);
+	for (u32 c = 0; c < size; ++c) {
+		expected_args[c] = size;
+	}
+	for (u64 i = 1; i <= n; ++i) {
+		MatrixElement e = big->data[i];
+		expected_sums[e.col] += e.val;
+		if (expected_args[e.col] == size || e.val > expected_maxs[e.col]) {
+			expected_maxs[e.col] = e.val;
+			expected_args[e.col] = e.row;
+		}
+	}
+	f64 squares = 0, largest = 0;
+	for (u64 i = 1; i <= n; ++i) {
+		squares += big->data[i].val * big->data[i].val;
+		largest = fabs(big->data[i].val) > largest ? fabs(big->data[i].val) : largest;
+	}
+	assert(Matrix_norm_frobenius(big) == sqrt(squares));
+	assert(Matrix_norm_max(big) == largest);
+
+	u64 total = 0;
+	for (u32 c = 0; c < size; ++c) {
+		assert(sums[c] == expected_sums[c]);
+		assert(maxs[c] == expected_maxs[c]);
+		assert(args[c] == expected_args[c]);
+		total += counts[c];
+	}
+	assert(total == n);
+
+	Matrix* t = Matrix_transpose(big);
+	f64		row_sums[400];
+	u32		row_args[400];
+	Matrix_reduce_rows(t, MATRIX_REDUCE_SUM, row_sums);
+	Matrix_argmax_rows(t, row_args);
+	for (u32 r = 0; r < size; ++r) {
+		assert(row_sums[r] == sums[r]);
+		assert(row_args[r] == args[r]);
+	}
+	assert(Matrix_norm_one(big) == Matrix_norm_inf(t));
+	Matrix_free(t);
+	Matrix_free(big);
+
+	Matrix* wide = Matrix_new(1, 100000);
+	Matrix_reserve(wide, 100000);
+	for (u32 i = 0; i < 100000; ++i) {
+		wide->data[i + 1] = (MatrixElement){0, i, i % 2 ? 1e-3 : 1e8 + i};
+	}
+	wide->data[0].val = 100000;
+	f64 kahan = Matrix_sum_with(wide, MATRIX_SUM_KAHAN);
+	f64 pairwise = Matrix_sum_with(wide, MATRIX_SUM_PAIRWISE);
+	f64 exact = 50000 * 1e8 + 2500000000.0 - 50000.0 + 50.0;
+	assert(fabs(kahan - exact) <= fabs(Matrix_sum(wide) - exact));
+	assert(fabs(pairwise - exact) < 1.0);
+	f64 frobenius = Matrix_norm_frobenius_with(wide, MATRIX_SUM_KAHAN);
+	for (u32 threads = 1; threads <= 8; threads *= 2) {
+		parallel_set_threads(threads);
+		assert(Matrix_sum_with(wide, MATRIX_SUM_KAHAN) == kahan);
+		assert(Matrix_sum_with(wide, MATRIX_SUM_PAIRWISE) == pairwise);
+		assert(Matrix_norm_frobenius_with(wide, MATRIX_SUM_KAHAN) == frobenius);
+		assert(Matrix_norm_max(wide) == 1e8 + 99998);
+	}
+	assert(Matrix_max_value(wide) == 1e8 + 99998);
+	assert(Matrix_min_value(wide) == 1e-3);
+
+	// a single row spread over many columns is reduced in one block, not one dense partial per
+	// thread
+	f64* wide_cols = malloc(sizeof(f64) * 100000);
+	u32* wide_args = malloc(sizeof(u32) * 100000);
+	Matrix_reduce_cols(wide, MATRIX_REDUCE_SUM, wide_cols);
+	Matrix_argmin_cols(wide, wide_args);
+	assert(wide_cols[7] == 1e-3 && wide_cols[8] == 1e8 + 8 && wide_cols[99999] == 1e-3);
+	assert(wide_args[0] == 0 && wide_args[99999] == 0);
+	free(wide_args);
+	free(wide_cols);
+	Matrix_free(wide);
+
+	Matrix* diagonal = Matrix_new(1000, 1000);
+	Matrix_set(diagonal, 0, 5, 1.0);
+	Matrix_set(diagonal, 3, 3, 2.0);
+	Matrix_set(diagonal, 3, 4, 7.0);
+	Matrix_set(diagonal, 500, 2, 7.0);
+	Matrix_set(diagonal, 600, 600, 3.0);
+	Matrix_set(diagonal, 999, 999, 4.0);
+	assert(Matrix_trace(diagonal) == 9.0);
+	assert(Matrix_sum(diagonal) == 24.0);
+	assert(Matrix_mean(diagonal) == 4.0);
+	Matrix_free(diagonal);
+
+	// the mean of a matrix without elements is 0 instead of a division by zero
+	Matrix* empty = Matrix_new(3, 3);
+	assert(Matrix_mean(empty) == 0.0);
+	Matrix_free(empty);
+
+	parallel_set_threads(0);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+/**
+ * @file semiring.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Sparse products over user-supplied semirings.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include <string.h>
+
+#include "oxidation.h"
+#include "trace.h"
+
+#define SEMIRING_PLUS(x, y)	 ((x) + (y))
+#define SEMIRING_TIMES(x, y) ((x) * (y))
+#define SEMIRING_MIN(x, y)	 ((x) < (y) ? (x) : (y))
+#define SEMIRING_MAX(x, y)	 ((x) > (y) ? (x) : (y))
+#define SEMIRING_OR(x, y)	 ((x) || (y))
+#define SEMIRING_AND(x, y)	 ((x) && (y))
+
+/**
+ * @brief Generate the products of a matrix type over a semiring. `_add_op` and `_mul_op` are
+ * function-like macros that are expanded inline into the kernels, `_zero` is the identity of
+ * `_add_op` and the value of every entry that is not stored, and `_one` is the identity of
+ * `_mul_op`. Entries equal to `_zero` are dropped from the results; every other value, including
+ * 0, is stored. Must be used after `MATRIX`, whose kernels it builds on.
+ *
+ * For example, `MATRIX_SEMIRING(Graph, f64, u32, min_plus, SEMIRING_MIN, SEMIRING_PLUS,
+ * INFINITY, 0)` generates `Graph_min_plus_multiply`, `Graph_min_plus_exp` and so on.
+ */
+#define MATRIX_SEMIRING(_name, _data_type, _index_type, _semiring, _add_op, _mul_op, _zero, _one)  \
+	static inline u64 _name##_##_semiring##_emit(_name##Element* out, u64 n, _index_type row,      \
+												 _index_type col, _data_type val) {                \
+		if (val == (_data_type)(_zero)) {                                                          \
+			return n;                                                                              \
+		}                                                                                          \
+		if (out) {                                                                                 \
+			out[n] = (_name##Element){row, col, val};                                              \
+		}                                                                                          \
+		return n + 1;                                                                              \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_##_semiring##_flush_row(_name##Workspace* w, u64 touched, _index_type row,  \
+											   _index_type cols, _name##Element* out) {            \
+		u64 n = 0;                                                                                 \
+		if (!_name##_kernel_sort_touched(w, touched, cols)) {                                      \
+			for (_index_type c = 0; c < cols; ++c) {                                               \
+				if (w->mark[c] == w->stamp) {                                                      \
+					n = _name##_##_semiring##_emit(out, n, row, c, w->acc[c]);                     \
+				}                                                                                  \
+			}                                                                                      \
+			return n;                                                                              \
+		}                                                                                          \
+		for (u64 x = 0; x < touched; ++x) {                                                        \
+			n = _name##_##_semiring##_emit(out, n, row, w->list[x], w->acc[w->list[x]]);           \
+		}                                                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_##_semiring##_kernel(const _name##Element* a, u64 na,                       \
+											const _name##Element* b, _index_type cols,             \
+											_name##Workspace* w, u64 limit, bool* overflow,        \
+											_name##Element* out) {                                 \
+		u64 n = 0, i = 0;                                                                          \
+		while (i < na) {                                                                           \
+			_index_type row = a[i].row;                                                            \
+			u64			touched = 0;                                                               \
+			++w->stamp;                                                                            \
+			for (; i < na && a[i].row == row; ++i) {                                               \
+				for (u64 x = w->ptr[a[i].col]; x < w->ptr[a[i].col + 1]; ++x) {                    \
+					_index_type col = b[x].col;                                                    \
+					_data_type	val = _mul_op(a[i].val, b[x].val);                                 \
+					if (w->mark[col] != w->stamp) {                                                \
+						w->mark[col] = w->stamp;                                                   \
+						w->acc[col] = val;                                                         \
+						w->list[touched++] = col;                                                  \
+					} else {                                                                       \
+						w->acc[col] = _add_op(w->acc[col], val);                                   \
+					}                                                                              \
+				}                                                                                  \
+			}                                                                                      \
+			if (out && n + touched > limit) {                                                      \
+				out = NULL;                                                                        \
+				*overflow = true;                                                                  \
+			}                                                                                      \
+			n += _name##_##_semiring##_flush_row(w, touched, row, cols, out ? out + n : NULL);     \
+		}                                                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_##_semiring##_multiply_into(_name* out, _name* a, _name* b) {                     \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##_detach(out);                                                                       \
+		_name##Workspace w = _name##_workspace_new(a->data[0].col, b->data[0].col);                \
+		_name##_kernel_row_ptr(b->data + 1, b->data[0].val, a->data[0].col, w.ptr);                \
+                                                                                                   \
+		bool overflow = false;                                                                     \
+		u64	 nnz = _name##_##_semiring##_kernel(a->data + 1, a->data[0].val, b->data + 1,          \
+												b->data[0].col, &w, ((u64)1 << out->size) - 1,     \
+												&overflow, out->data + 1);                         \
+		if (overflow) {                                                                            \
+			_name##_reserve(out, nnz);                                                             \
+			_name##_##_semiring##_kernel(a->data + 1, a->data[0].val, b->data + 1, b->data[0].col, \
+										 &w, UINT64_MAX, NULL, out->data + 1);                     \
+		}                                                                                          \
+		out->data[0].val = nnz;                                                                    \
+		out->data[0].row = a->data[0].row;                                                         \
+		out->data[0].col = b->data[0].col;                                                         \
+                                                                                                   \
+		_name##_workspace_free(&w);                                                                \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_##_semiring##_multiply(_name* a, _name* b) {                                    \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* m = _name##_new(a->data[0].row, b->data[0].col);                                    \
+		_name##_##_semiring##_multiply_into(m, a, b);                                              \
+		return m;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_##_semiring##_mxv(_name* m, const _data_type* x, _data_type* y) {                 \
+		for (_index_type r = 0; r < m->data[0].row; ++r) {                                         \
+			y[r] = _zero;                                                                          \
+		}                                                                                          \
+		for (u64 i = 1; i <= m->data[0].val; ++i) {                                                \
+			_name##Element e = m->data[i];                                                         \
+			y[e.row] = _add_op(y[e.row], _mul_op(e.val, x[e.col]));                                \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_##_semiring##_identity(_index_type size) {                                      \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* m = _name##_new(size, size);                                                        \
+		_name##_reserve(m, size);                                                                  \
+		for (_index_type i = 0; i < size; ++i) {                                                   \
+			m->data[i + 1] = (_name##Element){i, i, _one};                                         \
+		}                                                                                          \
+		m->data[0].val = size;                                                                     \
+		return m;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_##_semiring##_add(_name* a, _name* b) {                                         \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* m = _name##_new(a->data[0].row, a->data[0].col);                                    \
+		_name##_reserve(m, a->data[0].val + b->data[0].val);                                       \
+                                                                                                   \
+		_name##Element *x = a->data + 1, *y = b->data + 1, *out = m->data + 1;                     \
+		u64				na = a->data[0].val, nb = b->data[0].val, i = 0, j = 0, n = 0;             \
+		while (i < na || j < nb) {                                                                 \
+			if (j >= nb || (i < na && (x[i].row < y[j].row ||                                      \
+									   (x[i].row == y[j].row && x[i].col < y[j].col)))) {          \
+				n = _name##_##_semiring##_emit(out, n, x[i].row, x[i].col, x[i].val);              \
+				++i;                                                                               \
+			} else if (i < na && x[i].row == y[j].row && x[i].col == y[j].col) {                   \
+				n = _name##_##_semiring##_emit(out, n, x[i].row, x[i].col,                         \
+											   _add_op(x[i].val, y[j].val));                       \
+				++i, ++j;                                                                          \
+			} else {                                                                               \
+				n = _name##_##_semiring##_emit(out, n, y[j].row, y[j].col, y[j].val);              \
+				++j;                                                                               \
+			}                                                                                      \
+		}                                                                                          \
+		m->data[0].val = n;                                                                        \
+		return m;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_##_semiring##_exp_into(_name* out, _name* m, i64 exp) {                           \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_index_type size = m->data[0].row;                                                         \
+		if (exp <= 0) {                                                                            \
+			_name* identity = _name##_##_semiring##_identity(size);                                \
+			_name##_assign(out, identity);                                                         \
+			_name##_free(identity);                                                                \
+			return;                                                                                \
+		}                                                                                          \
+                                                                                                   \
+		_name* base = _name##_clone(m);                                                            \
+		_name* tmp = _name##_new(size, size);                                                      \
+		bool   started = false;                                                                    \
+                                                                                                   \
+		while (exp > 0) {                                                                          \
+			if (exp % 2 == 1) {                                                                    \
+				if (started) {                                                                     \
+					_name##_##_semiring##_multiply_into(tmp, out, base);                           \
+					_name##_swap(out, tmp);                                                        \
+				} else {                                                                           \
+					_name##_assign(out, base);                                                     \
+					started = true;                                                                \
+				}                                                                                  \
+			}                                                                                      \
+			exp >>= 1;                                                                             \
+			if (exp > 0) {                                                                         \
+				_name##_##_semiring##_multiply_into(tmp, base, base);                              \
+				_name##_swap(base, tmp);                                                           \
+			}                                                                                      \
+		}                                                                                          \
+                                                                                                   \
+		_name##_free(tmp);                                                                         \
+		_name##_free(base);                                                                        \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_##_semiring##_exp(_name* m, i64 exp) {                                          \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* ans = _name##_new(m->data[0].row, m->data[0].row);                                  \
+		_name##_##_semiring##_exp_into(ans, m, exp);                                               \
+		return ans;                                                                                \
+	}
+
+#define MATRIX_SEMIRING_DECLARE(_name, _data_type, _index_type, _semiring)                         \
+	void   _name##_##_semiring##_multiply_into(_name* out, _name* a, _name* b);                    \
+	_name* _name##_##_semiring##_multiply(_name* a, _name* b);                                     \
+	void   _name##_##_semiring##_mxv(_name* m, const _data_type* x, _data_type* y);                \
+	_name* _name##_##_semiring##_identity(_index_type size);                                       \
+	_name* _name##_##_semiring##_add(_name* a, _name* b);                                          \
+	void   _name##_##_semiring##_exp_into(_name* out, _name* m, i64 exp);                          \
+	_name* _name##_##_semiring##_exp(_name* m, i64 exp);
@@ -0,0 +1,107 @@
+#include "semiring.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+MATRIX_SEMIRING(Matrix, f64, u32, min_plus, SEMIRING_MIN, SEMIRING_PLUS, INFINITY, 0);
+MATRIX_SEMIRING(Matrix, f64, u32, max_times, SEMIRING_MAX, SEMIRING_TIMES, 0, 1);
+MATRIX_SEMIRING(Matrix, f64, u32, or_and, SEMIRING_OR, SEMIRING_AND, 0, 1);
+
+int main() {
+	srand(1481);
+
+	// 0 -> 1 -> 2 -> 3, with a long shortcut 0 -> 3
+	Matrix* graph = Matrix_new(4, 4);
+	Matrix_set(graph, 0, 1, 1.0);
+	Matrix_set(graph, 1, 2, 2.0);
+	Matrix_set(graph, 2, 3, 3.0);
+	Matrix_set(graph, 0, 3, 10.0);
+
+	Matrix* two = Matrix_min_plus_multiply(graph, graph);
+	assert(two->data[0].val == 2);
+	assert(Matrix_get(two, 0, 2) == 3.0);
+	assert(Matrix_get(two, 1, 3) == 5.0);
+	Matrix_free(two);
+
+	Matrix* identity = Matrix_min_plus_identity(4);
+	assert(identity->data[0].val == 4);
+	assert(identity->data[1].val == 0.0);
+	Matrix* hop = Matrix_min_plus_add(graph, identity);
+	assert(hop->data[0].val == 8);
+
+	Matrix* paths = Matrix_min_plus_exp(hop, 3);
+	assert(Matrix_validate(paths));
+	assert(Matrix_find(paths, 2, 2).exists);
+	assert(Matrix_get(paths, 0, 3) == 6.0);
+	assert(Matrix_get(paths, 0, 2) == 3.0);
+	assert(!Matrix_find(paths, 3, 0).exists);
+
+	Matrix* short_paths = Matrix_min_plus_exp(hop, 1);
+	assert(Matrix_equal(short_paths, hop));
+	assert(Matrix_get(short_paths, 0, 3) == 10.0);
+	Matrix_min_plus_exp_into(short_paths, hop, 0);
+	assert(Matrix_equal(short_paths, identity));
+	Matrix_free(short_paths);
+
+	f64 dist[4] = {0, INFINITY, INFINITY, INFINITY}, next[4];
+	Matrix* back = Matrix_transpose(hop);
+	for (u32 k = 0; k < 3; ++k) {
+		Matrix_min_plus_mxv(back, dist, next);
+		for (u32 i = 0; i < 4; ++i) {
+			dist[i] = next[i];
+		}
+	}
+	assert(dist[1] == 1.0 && dist[2] == 3.0 && dist[3] == 6.0);
+	Matrix_free(back);
+
+	Matrix* self = Matrix_or_and_identity(4);
+	Matrix* step = Matrix_or_and_add(graph, self);
+	Matrix* reach = Matrix_or_and_exp(step, 3);
+	assert(reach->data[0].val == 10);
+	assert(Matrix_get(reach, 0, 3) == 1.0);
+	assert(Matrix_get(reach, 3, 0) == 0.0);
+	Matrix_free(reach);
+	Matrix_free(step);
+	Matrix_free(self);
+
+	Matrix* best = Matrix_max_times_multiply(graph, graph);
+	assert(Matrix_get(best, 0, 2) == 2.0);
+	Matrix_free(best);
+
+	Matrix* random = Matrix_new(30, 30);
+	for (u32 i = 0; i < 200; ++i) {
+		Matrix_set(random, rand() % 30, rand() % 30, rand() % 9 + 1);
+	}
+	Matrix* expected = Matrix_multiply(random, random);
+	Matrix* product = Matrix_plus_times_multiply(random, random);
+	assert(Matrix_equal(product, expected));
+	Matrix_free(product);
+	Matrix_free(expected);
+
+	f64 x[30], y[30], z[30];
+	for (u32 i = 0; i < 30; ++i) {
+		x[i] = i + 1;
+	}
+	Matrix_plus_times_mxv(random, x, y);
+	for (u32 i = 0; i < 30; ++i) {
+		z[i] = 0;
+		for (u32 j = 0; j < 30; ++j) {
+			z[i] += Matrix_get(random, i, j) * x[j];
+		}
+		assert(y[i] == z[i]);
+	}
+	Matrix_free(random);
+
+	Matrix_free(paths);
+	Matrix_free(hop);
+	Matrix_free(identity);
+	Matrix_free(graph);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file shared.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief A handle that publishes versions of a matrix to lock-free readers.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+
+#include "epoch.h"
+#include "oxidation.h"
+
+/**
+ * @brief A `_name##Shared` holds the current version of a matrix. Readers take a snapshot, which
+ * stays valid and unchanged until they release it, without taking a lock. A writer edits a private
+ * copy, which shares the elements of the current version until it changes them, and publishes it
+ * as the next version. The previous version is freed once the readers that may still use it are
+ * done.
+ */
+#define MATRIX_SHARED_STRUCT(_name, _data_type, _index_type)                                       \
+	typedef struct _name##Shared {                                                                 \
+		_name*		 current;                                                                      \
+		MatrixEpoch* epoch;                                                                        \
+	} _name##Shared;                                                                               \
+                                                                                                   \
+	typedef struct _name##Snapshot {                                                               \
+		_name* m;                                                                                  \
+		u32	   token;                                                                              \
+	} _name##Snapshot;
+
+#define MATRIX_SHARED_METHOD(_name, _data_type, _index_type)                                       \
+	_name##Shared* _name##Shared_new(_name* m) {                                                   \
+		_name##Shared* s = malloc(sizeof(_name##Shared));                                          \
+		/* naming an anonymous matrix writes to it, so it happens before readers can see it */     \
+		_name##_get_name(m);                                                                       \
+		s->current = m;                                                                            \
+		s->epoch = matrix_epoch_new();                                                             \
+		return s;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##Shared_free(_name##Shared* s) {                                                    \
+		_name##_free(s->current);                                                                  \
+		matrix_epoch_free(s->epoch);                                                               \
+		free(s);                                                                                   \
+	}                                                                                              \
+                                                                                                   \
+	_name##Snapshot _name##Shared_acquire(_name##Shared* s) {                                      \
+		u32 token = matrix_epoch_enter(s->epoch);                                                  \
+		return (_name##Snapshot){__atomic_load_n(&s->current, __ATOMIC_ACQUIRE), token};           \
+	}                                                                                              \
+                                                                                                   \
+	void _name##Shared_release(_name##Shared* s, _name##Snapshot* snapshot) {                      \
+		matrix_epoch_leave(s->epoch, snapshot->token);                                             \
+		snapshot->m = NULL;                                                                        \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##Shared_edit(_name##Shared* s) {                                                  \
+		_name##Snapshot snapshot = _name##Shared_acquire(s);                                       \
+		_name*			m = _name##_clone(snapshot.m);                                             \
+		_name##Shared_release(s, &snapshot);                                                       \
+		return m;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##Shared_publish(_name##Shared* s, _name* m) {                                       \
+		_name##_get_name(m);                                                                       \
+		_name##_free(matrix_epoch_publish(s->epoch, (void**)&s->current, m));                      \
+	}
+
+#define MATRIX_SHARED_METHOD_DECLARE(_name, _data_type, _index_type)                               \
+	_name##Shared*	_name##Shared_new(_name* m);                                                   \
+	void			_name##Shared_free(_name##Shared* s);                                          \
+	_name##Snapshot _name##Shared_acquire(_name##Shared* s);                                       \
+	void			_name##Shared_release(_name##Shared* s, _name##Snapshot* snapshot);            \
+	_name*			_name##Shared_edit(_name##Shared* s);                                          \
+	void			_name##Shared_publish(_name##Shared* s, _name* m);
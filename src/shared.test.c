@@ -0,0 +1,90 @@
+#include "shared.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+#define SIZE	 64
+#define VERSIONS 200
+
+static MatrixShared* shared;
+static bool			 done;
+
+static void* reader(void* arg) {
+	u64* reads = arg;
+	f64	 x[SIZE], y[SIZE];
+	for (u32 i = 0; i < SIZE; ++i) {
+		x[i] = 1;
+	}
+	while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+		MatrixSnapshot snapshot = MatrixShared_acquire(shared);
+		Matrix*		   m = snapshot.m;
+		f64			   version = Matrix_get(m, 0, 0);
+		// published matrices are already named, so asking for the name does not write
+		assert(strlen(Matrix_get_name(m)) > 0);
+		for (u64 i = 1; i <= m->data[0].val; ++i) {
+			assert(m->data[i].val == version);
+		}
+		Matrix_plus_times_mxv(m, x, y);
+		for (u32 i = 0; i < SIZE; ++i) {
+			assert(y[i] == version * SIZE);
+		}
+		MatrixShared_release(shared, &snapshot);
+		__atomic_add_fetch(reads, 1, __ATOMIC_RELEASE);
+	}
+	return NULL;
+}
+
+int main() {
+	Matrix* m = Matrix_new(SIZE, SIZE);
+	for (u32 i = 0; i < SIZE; ++i) {
+		for (u32 j = 0; j < SIZE; ++j) {
+			Matrix_set(m, i, j, 1);
+		}
+	}
+	shared = MatrixShared_new(m);
+
+	MatrixSnapshot snapshot = MatrixShared_acquire(shared);
+	Matrix*		   edit = MatrixShared_edit(shared);
+	assert(edit != snapshot.m && edit->data == snapshot.m->data);
+	MatrixShared_release(shared, &snapshot);
+	assert(snapshot.m == NULL);
+	Matrix_free(edit);
+
+	pthread_t threads[4];
+	u64		  reads[4] = {0};
+	for (u32 t = 0; t < 4; ++t) {
+		pthread_create(&threads[t], NULL, reader, &reads[t]);
+	}
+	for (u32 v = 2; v <= VERSIONS; ++v) {
+		Matrix* next = MatrixShared_edit(shared);
+		for (u64 i = 1; i <= next->data[0].val; ++i) {
+			Matrix_set(next, next->data[i].row, next->data[i].col, v);
+		}
+		MatrixShared_publish(shared, next);
+	}
+	for (u32 t = 0; t < 4; ++t) {
+		while (__atomic_load_n(&reads[t], __ATOMIC_ACQUIRE) == 0) {
+			sched_yield();
+		}
+	}
+	__atomic_store_n(&done, true, __ATOMIC_RELEASE);
+	for (u32 t = 0; t < 4; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+
+	snapshot = MatrixShared_acquire(shared);
+	assert(Matrix_get(snapshot.m, SIZE - 1, SIZE - 1) == VERSIONS);
+	MatrixShared_release(shared, &snapshot);
+	MatrixShared_free(shared);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,198 @@
+/**
+ * @file slice.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Extracting ranges and index lists of rows and columns.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include "ewise.h"
+#include "oxidation.h"
+#include "trace.h"
+#include "utils.h"
+
+/**
+ * @brief Generate `_name##_slice`, which copies the half-open block `[r0, r1) x [c0, c1)`, and
+ * `_name##_gather`, which copies the rows and columns named by strictly increasing index lists.
+ * Rows are located by binary search, so both cost the size of the output plus log factors
+ * instead of the size of the whole matrix. `_name##_submatrix` is a gather over boolean masks.
+ */
+#define MATRIX_SLICE_METHOD(_name, _data_type, _index_type)                                        \
+	static u64 _name##_row_begin(const _name##Element* e, u64 lo, u64 n, _index_type row) {        \
+		_name##Element key = {row, 0, 0};                                                          \
+		return _name##_kernel_gallop(e, lo, n, &key);                                              \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_index_gallop(const _index_type* v, u64 lo, u64 n, _index_type key) {        \
+		u64 hi = lo, step = 1;                                                                     \
+		while (hi < n && v[hi] < key) {                                                            \
+			lo = hi + 1;                                                                           \
+			hi += step;                                                                            \
+			step <<= 1;                                                                            \
+		}                                                                                          \
+		if (hi > n) {                                                                              \
+			hi = n;                                                                                \
+		}                                                                                          \
+		while (lo < hi) {                                                                          \
+			u64 mid = lo + (hi - lo) / 2;                                                          \
+			if (v[mid] < key) {                                                                    \
+				lo = mid + 1;                                                                      \
+			} else {                                                                               \
+				hi = mid;                                                                          \
+			}                                                                                      \
+		}                                                                                          \
+		return lo;                                                                                 \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_slice_pass(_name* m, _index_type r0, _index_type r1, _index_type c0,        \
+								  _index_type c1, _name##Element* out) {                           \
+		const _name##Element* e = m->data + 1;                                                     \
+		u64					  n = m->data[0].val, total = 0;                                       \
+		for (u64 pos = _name##_row_begin(e, 0, n, r0); pos < n && e[pos].row < r1;) {              \
+			_index_type	   row = e[pos].row;                                                       \
+			u64			   next = _name##_row_begin(e, pos, n, row + 1);                           \
+			_name##Element lower = {row, c0, 0}, upper = {row, c1, 0};                             \
+			u64			   lo = _name##_kernel_gallop(e, pos, next, &lower);                       \
+			u64			   hi = _name##_kernel_gallop(e, lo, next, &upper);                        \
+			for (u64 i = lo; out && i < hi; ++i) {                                                 \
+				out[total + i - lo] = (_name##Element){row - r0, e[i].col - c0, e[i].val};         \
+			}                                                                                      \
+			total += hi - lo;                                                                      \
+			pos = next;                                                                            \
+		}                                                                                          \
+		return total;                                                                              \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##_gather_pass(_name* m, const _index_type* rows, u64 nrows,                   \
+								   const _index_type* cols, u64 ncols, _name##Element* out) {      \
+		const _name##Element* e = m->data + 1;                                                     \
+		u64					  n = m->data[0].val, total = 0, pos = 0;                              \
+		for (u64 r = 0; r < nrows; ++r) {                                                          \
+			_index_type row = rows ? rows[r] : (_index_type)r;                                     \
+			pos = _name##_row_begin(e, pos, n, row);                                               \
+			u64 end = _name##_row_begin(e, pos, n, row + 1), len = end - pos;                      \
+			if (!cols) {                                                                           \
+				for (u64 i = pos; out && i < end; ++i) {                                           \
+					out[total + i - pos] = (_name##Element){r, e[i].col, e[i].val};                \
+				}                                                                                  \
+				total += len;                                                                      \
+			} else if (len * MATRIX_GALLOP_RATIO < ncols) {                                        \
+				for (u64 i = pos, j = 0; i < end && j < ncols; ++i) {                              \
+					j = _name##_index_gallop(cols, j, ncols, e[i].col);                            \
+					if (j < ncols && cols[j] == e[i].col) {                                        \
+						if (out) {                                                                 \
+							out[total] = (_name##Element){r, j, e[i].val};                         \
+						}                                                                          \
+						++total;                                                                   \
+					}                                                                              \
+				}                                                                                  \
+			} else if (ncols * MATRIX_GALLOP_RATIO < len) {                                        \
+				for (u64 i = pos, j = 0; i < end && j < ncols; ++j) {                              \
+					_name##Element key = {row, cols[j], 0};                                        \
+					i = _name##_kernel_gallop(e, i, end, &key);                                    \
+					if (i < end && e[i].col == cols[j]) {                                          \
+						if (out) {                                                                 \
+							out[total] = (_name##Element){r, j, e[i].val};                         \
+						}                                                                          \
+						++total;                                                                   \
+					}                                                                              \
+				}                                                                                  \
+			} else {                                                                               \
+				for (u64 i = pos, j = 0; i < end && j < ncols;) {                                  \
+					if (e[i].col < cols[j]) {                                                      \
+						++i;                                                                       \
+					} else if (e[i].col > cols[j]) {                                               \
+						++j;                                                                       \
+					} else {                                                                       \
+						if (out) {                                                                 \
+							out[total] = (_name##Element){r, j, e[i].val};                         \
+						}                                                                          \
+						++total, ++i, ++j;                                                         \
+					}                                                                              \
+				}                                                                                  \
+			}                                                                                      \
+		}                                                                                          \
+		return total;                                                                              \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_slice_into(_name* out, _name* m, _index_type r0, _index_type r1, _index_type c0,  \
+							_index_type c1) {                                                      \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		r1 = r1 < m->data[0].row ? r1 : m->data[0].row;                                            \
+		c1 = c1 < m->data[0].col ? c1 : m->data[0].col;                                            \
+		r0 = r0 < r1 ? r0 : r1;                                                                    \
+		c0 = c0 < c1 ? c0 : c1;                                                                    \
+		u64 nnz = _name##_slice_pass(m, r0, r1, c0, c1, NULL);                                     \
+		_name##_reserve(out, nnz);                                                                 \
+		_name##_slice_pass(m, r0, r1, c0, c1, out->data + 1);                                      \
+		out->data[0] = (_name##Element){r1 - r0, c1 - c0, nnz};                                    \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_slice(_name* m, _index_type r0, _index_type r1, _index_type c0,                 \
+						 _index_type c1) {                                                         \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* s = _name##_new(0, 0);                                                              \
+		_name##_slice_into(s, m, r0, r1, c0, c1);                                                  \
+		return s;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_gather_into(_name* out, _name* m, const _index_type* rows, u64 nrows,             \
+							 const _index_type* cols, u64 ncols) {                                 \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		nrows = rows ? nrows : m->data[0].row;                                                     \
+		ncols = cols ? ncols : m->data[0].col;                                                     \
+		u64 nnz = _name##_gather_pass(m, rows, nrows, cols, ncols, NULL);                          \
+		_name##_reserve(out, nnz);                                                                 \
+		_name##_gather_pass(m, rows, nrows, cols, ncols, out->data + 1);                           \
+		out->data[0] = (_name##Element){nrows, ncols, nnz};                                        \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_gather(_name* m, const _index_type* rows, u64 nrows, const _index_type* cols,   \
+						  u64 ncols) {                                                             \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* g = _name##_new(0, 0);                                                              \
+		_name##_gather_into(g, m, rows, nrows, cols, ncols);                                       \
+		return g;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##_submatrix_into(_name* out, _name* m, bool* rows, bool* cols) {                    \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_index_type* row_list = scratch_alloc(sizeof(_index_type) * m->data[0].row);               \
+		_index_type* col_list = scratch_alloc(sizeof(_index_type) * m->data[0].col);               \
+		u64			 nrows = 0, ncols = 0;                                                         \
+		for (_index_type i = 0; i < m->data[0].row; ++i) {                                         \
+			if (rows[i]) {                                                                         \
+				row_list[nrows++] = i;                                                             \
+			}                                                                                      \
+		}                                                                                          \
+		for (_index_type i = 0; i < m->data[0].col; ++i) {                                         \
+			if (cols[i]) {                                                                         \
+				col_list[ncols++] = i;                                                             \
+			}                                                                                      \
+		}                                                                                          \
+		_name##_gather_into(out, m, row_list, nrows, col_list, ncols);                             \
+		scratch_free(col_list);                                                                    \
+		scratch_free(row_list);                                                                    \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##_submatrix(_name* m, bool* rows, bool* cols) {                                   \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* sub = _name##_new(0, 0);                                                            \
+		_name##_submatrix_into(sub, m, rows, cols);                                                \
+		return sub;                                                                                \
+	}
+
+#define MATRIX_SLICE_METHOD_DECLARE(_name, _data_type, _index_type)                                \
+	void   _name##_slice_into(_name* out, _name* m, _index_type r0, _index_type r1,                \
+							  _index_type c0, _index_type c1);                                     \
+	_name* _name##_slice(_name* m, _index_type r0, _index_type r1, _index_type c0,                 \
+						 _index_type c1);                                                          \
+	void   _name##_gather_into(_name* out, _name* m, const _index_type* rows, u64 nrows,           \
+							   const _index_type* cols, u64 ncols);                                \
+	_name* _name##_gather(_name* m, const _index_type* rows, u64 nrows, const _index_type* cols,   \
+						  u64 ncols);                                                              \
+	void   _name##_submatrix_into(_name* out, _name* m, bool* rows, bool* cols);                   \
+	_name* _name##_submatrix(_name* m, bool* rows, bool* cols);
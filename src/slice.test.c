@@ -0,0 +1,98 @@
+#include "slice.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+int main() {
+	srand(1481);
+
+	Matrix* m = Matrix_from_1d((f64[]){1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12}, 3, 4);
+
+	Matrix* s = Matrix_slice(m, 1, 3, 1, 3);
+	assert(s->data[0].row == 2 && s->data[0].col == 2 && s->data[0].val == 4);
+	assert(Matrix_get(s, 0, 0) == 6.0 && Matrix_get(s, 1, 1) == 11.0);
+	Matrix_slice_into(s, m, 2, 100, 3, 100);
+	assert(s->data[0].row == 1 && s->data[0].col == 1 && Matrix_get(s, 0, 0) == 12.0);
+	Matrix_slice_into(s, m, 2, 1, 0, 4);
+	assert(s->data[0].row == 0 && s->data[0].val == 0);
+	Matrix_free(s);
+
+	Matrix* g = Matrix_gather(m, (u32[]){0, 2}, 2, (u32[]){1, 2}, 2);
+	assert(g->data[0].row == 2 && g->data[0].col == 2 && g->data[0].val == 4);
+	assert(Matrix_get(g, 0, 0) == 2.0 && Matrix_get(g, 1, 1) == 11.0);
+	Matrix_gather_into(g, m, NULL, 0, (u32[]){3}, 1);
+	assert(g->data[0].row == 3 && g->data[0].col == 1);
+	assert(Matrix_get(g, 2, 0) == 12.0);
+	Matrix_gather_into(g, m, (u32[]){1}, 1, NULL, 0);
+	assert(g->data[0].col == 4 && g->data[0].val == 4 && Matrix_get(g, 0, 3) == 8.0);
+	Matrix_free(g);
+	Matrix_free(m);
+
+	u32		size = 500;
+	Matrix* big = Matrix_new(size, size);
+	Matrix_reserve(big, size * size);
+	u64 n = 0;
+	for (u32 i = 0; i < size; ++i) {
+		for (u32 j = 0; j < size; ++j) {
+			if (rand() % 4 == 0) {
+				big->data[++n] = (MatrixElement){i, j, rand() % 9 + 1};
+			}
+		}
+	}
+	big->data[0].val = n;
+
+	Matrix* band = Matrix_slice(big, 100, 200, 37, 420);
+	assert(Matrix_validate(band));
+	u64 expected = 0;
+	for (u64 i = 1; i <= n; ++i) {
+		MatrixElement e = big->data[i];
+		if (e.row >= 100 && e.row < 200 && e.col >= 37 && e.col < 420) {
+			assert(Matrix_get(band, e.row - 100, e.col - 37) == e.val);
+			++expected;
+		}
+	}
+	assert(band->data[0].val == expected);
+	Matrix_free(band);
+
+	u32	 rows[100], sparse_cols[3] = {5, 250, 499}, dense_cols[400];
+	bool row_mask[500] = {0}, col_mask[500] = {0};
+	for (u32 i = 0; i < 100; ++i) {
+		rows[i] = i * 5 + 2;
+		row_mask[rows[i]] = true;
+	}
+	for (u32 i = 0; i < 400; ++i) {
+		dense_cols[i] = i + i / 4;
+		col_mask[dense_cols[i]] = true;
+	}
+	for (u32 k = 0; k < 2; ++k) {
+		u32*	cols = k ? dense_cols : sparse_cols;
+		u64		ncols = k ? 400 : 3;
+		Matrix* picked = Matrix_gather(big, rows, 100, cols, ncols);
+		assert(Matrix_validate(picked));
+		u64 count = 0;
+		for (u32 r = 0; r < 100; ++r) {
+			for (u32 c = 0; c < ncols; ++c) {
+				f64 val = Matrix_get(big, rows[r], cols[c]);
+				assert(Matrix_get(picked, r, c) == val);
+				count += val != 0;
+			}
+		}
+		assert(picked->data[0].val == count);
+		Matrix_free(picked);
+	}
+
+	Matrix* masked = Matrix_submatrix(big, row_mask, col_mask);
+	Matrix* gathered = Matrix_gather(big, rows, 100, dense_cols, 400);
+	assert(Matrix_equal(masked, gathered));
+	Matrix_free(gathered);
+	Matrix_free(masked);
+	Matrix_free(big);
+
+	return EXIT_SUCCESS;
+}
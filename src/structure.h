@@ -0,0 +1,131 @@
+/**
+ * @file structure.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Structure tags that let kernels skip work on identity, diagonal and triangular matrices.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include "oxidation.h"
+
+/**
+ * @brief Facts known about the elements of a matrix, kept in its `tags`. A tag is only set when
+ * it is certainly true, and writing into a matrix clears its tags. A tag also sets the tags it
+ * implies, so a diagonal matrix is tagged as upper, lower and symmetric as well.
+ */
+typedef enum MatrixStructure {
+	MATRIX_STRUCTURE_IDENTITY = 1 << 0,
+	MATRIX_STRUCTURE_SCALED_IDENTITY = 1 << 1,
+	MATRIX_STRUCTURE_DIAGONAL = 1 << 2,
+	MATRIX_STRUCTURE_UPPER = 1 << 3,
+	MATRIX_STRUCTURE_LOWER = 1 << 4,
+	MATRIX_STRUCTURE_SYMMETRIC = 1 << 5,
+	MATRIX_STRUCTURE_ZERO = 1 << 6,
+} MatrixStructure;
+
+/**
+ * @brief Add the tags implied by `tags`.
+ */
+static inline u8 matrix_structure_close(u8 tags) {
+	if (tags & MATRIX_STRUCTURE_IDENTITY) {
+		tags |= MATRIX_STRUCTURE_SCALED_IDENTITY;
+	}
+	if (tags & MATRIX_STRUCTURE_SCALED_IDENTITY) {
+		tags |= MATRIX_STRUCTURE_DIAGONAL;
+	}
+	if ((tags & MATRIX_STRUCTURE_UPPER) && (tags & MATRIX_STRUCTURE_LOWER)) {
+		tags |= MATRIX_STRUCTURE_DIAGONAL;
+	}
+	if (tags & MATRIX_STRUCTURE_DIAGONAL) {
+		tags |= MATRIX_STRUCTURE_UPPER | MATRIX_STRUCTURE_LOWER | MATRIX_STRUCTURE_SYMMETRIC;
+	}
+	return tags;
+}
+
+/**
+ * @brief Tags of `a * b` given the tags of `a` and `b`.
+ */
+static inline u8 matrix_structure_product(u8 a, u8 b) {
+	return matrix_structure_close(a & b & ~MATRIX_STRUCTURE_SYMMETRIC & ~MATRIX_STRUCTURE_ZERO);
+}
+
+/**
+ * @brief Tags of an element-wise combination of `a` and `b` that maps two zeros to zero.
+ */
+static inline u8 matrix_structure_ewise(u8 a, u8 b) {
+	return a & b &
+		   (MATRIX_STRUCTURE_DIAGONAL | MATRIX_STRUCTURE_UPPER | MATRIX_STRUCTURE_LOWER |
+			MATRIX_STRUCTURE_SYMMETRIC);
+}
+
+/**
+ * @brief Tags of an element-wise combination of `a` and `b` that only keeps the positions stored
+ * in both.
+ */
+static inline u8 matrix_structure_intersect(u8 a, u8 b) {
+	u8 pattern = MATRIX_STRUCTURE_DIAGONAL | MATRIX_STRUCTURE_UPPER | MATRIX_STRUCTURE_LOWER;
+	return matrix_structure_close(((a | b) & pattern) | (a & b & MATRIX_STRUCTURE_SYMMETRIC));
+}
+
+/**
+ * @brief Tags of the transpose of a matrix tagged `tags`.
+ */
+static inline u8 matrix_structure_transpose(u8 tags) {
+	u8 swapped = tags & ~(MATRIX_STRUCTURE_UPPER | MATRIX_STRUCTURE_LOWER);
+	if (tags & MATRIX_STRUCTURE_UPPER) {
+		swapped |= MATRIX_STRUCTURE_LOWER;
+	}
+	if (tags & MATRIX_STRUCTURE_LOWER) {
+		swapped |= MATRIX_STRUCTURE_UPPER;
+	}
+	return swapped;
+}
+
+#define MATRIX_STRUCTURE_METHOD(_name, _data_type, _index_type)                                    \
+	u8 _name##_structure(_name* m) {                                                               \
+		if (m->data[0].val != 0) {                                                                 \
+			return m->tags;                                                                        \
+		}                                                                                          \
+		u8 tags = MATRIX_STRUCTURE_ZERO;                                                           \
+		if (m->data[0].row == m->data[0].col) {                                                    \
+			tags |= matrix_structure_close(MATRIX_STRUCTURE_SCALED_IDENTITY);                      \
+		}                                                                                          \
+		return tags;                                                                               \
+	}                                                                                              \
+                                                                                                   \
+	u8 _name##_infer_structure(_name* m) {                                                         \
+		const _name##Element* e = m->data + 1;                                                     \
+		u64					  n = m->data[0].val;                                                  \
+		u8					  tags = 0;                                                            \
+		if (m->data[0].row == m->data[0].col) {                                                    \
+			bool upper = true, lower = true, same = true, ones = true, symmetric = true;           \
+			for (u64 i = 0; i < n; ++i) {                                                          \
+				upper &= e[i].row <= e[i].col;                                                     \
+				lower &= e[i].row >= e[i].col;                                                     \
+				same &= e[i].val == e[0].val;                                                      \
+				ones &= e[i].val == 1;                                                             \
+			}                                                                                      \
+			for (u64 i = 0; i < n && symmetric && !(upper && lower); ++i) {                        \
+				_name##Element key = {e[i].col, e[i].row, 0};                                      \
+				u64			   j = _name##_kernel_gallop(e, 0, n, &key);                           \
+				symmetric = j < n && e[j].row == key.row && e[j].col == key.col &&                 \
+							e[j].val == e[i].val;                                                  \
+			}                                                                                      \
+			tags |= upper ? MATRIX_STRUCTURE_UPPER : 0;                                            \
+			tags |= lower ? MATRIX_STRUCTURE_LOWER : 0;                                            \
+			tags |= symmetric ? MATRIX_STRUCTURE_SYMMETRIC : 0;                                    \
+			if (upper && lower && n == (u64)m->data[0].row) {                                      \
+				tags |= ones ? MATRIX_STRUCTURE_IDENTITY : 0;                                      \
+				tags |= same ? MATRIX_STRUCTURE_SCALED_IDENTITY : 0;                               \
+			}                                                                                      \
+		}                                                                                          \
+		m->tags = matrix_structure_close(tags);                                                    \
+		return _name##_structure(m);                                                               \
+	}
+
+#define MATRIX_STRUCTURE_METHOD_DECLARE(_name, _data_type, _index_type)                            \
+	u8 _name##_structure(_name* m);                                                                \
+	u8 _name##_infer_structure(_name* m);
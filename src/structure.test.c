@@ -0,0 +1,108 @@
+#include "structure.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+int main() {
+	Matrix* id = Matrix_identity(3);
+	Matrix* a = Matrix_from_1d((f64[]){1, 2, 0, 4, 5, 6, 0, 8, 9}, 3, 3);
+	assert(id->tags & MATRIX_STRUCTURE_IDENTITY);
+	assert(id->tags & MATRIX_STRUCTURE_SYMMETRIC && id->tags & MATRIX_STRUCTURE_UPPER);
+	assert(a->tags == 0);
+
+	Matrix* copy = Matrix_multiply(id, a);
+	assert(copy->data == a->data);
+	Matrix_multiply_into(copy, a, id);
+	assert(copy->data == a->data);
+	Matrix_set(copy, 0, 0, 7.0);
+	assert(copy->data != a->data && Matrix_get(a, 0, 0) == 1.0);
+
+	Matrix* d = Matrix_from_1d((f64[]){2, 0, 0, 0, 0, 0, 0, 0, -1}, 3, 3);
+	Matrix* plain = Matrix_from_1d((f64[]){2, 0, 0, 0, 0, 0, 0, 0, -1}, 3, 3);
+	u8		tags = Matrix_infer_structure(d);
+	assert(tags & MATRIX_STRUCTURE_DIAGONAL && !(tags & MATRIX_STRUCTURE_SCALED_IDENTITY));
+	assert(plain->tags == 0);
+
+	Matrix* left = Matrix_multiply(d, a);
+	Matrix* expected = Matrix_multiply(plain, a);
+	assert(Matrix_equal(left, expected) && Matrix_validate(left));
+	Matrix* right = Matrix_multiply(a, d);
+	Matrix_multiply_into(expected, a, plain);
+	assert(Matrix_equal(right, expected) && Matrix_validate(right));
+
+	Matrix* cube = Matrix_exp(d, 3);
+	Matrix_exp_into(expected, plain, 3);
+	assert(Matrix_equal(cube, expected));
+	assert(cube->tags & MATRIX_STRUCTURE_DIAGONAL);
+	Matrix_exp_into(cube, id, 5);
+	assert(cube->data == id->data);
+
+	Matrix* twice = Matrix_scale(id, 2.0);
+	assert(twice->tags & MATRIX_STRUCTURE_SCALED_IDENTITY);
+	assert(!(twice->tags & MATRIX_STRUCTURE_IDENTITY));
+	Matrix_multiply_into(expected, twice, d);
+	assert(expected->tags & MATRIX_STRUCTURE_DIAGONAL);
+	assert(Matrix_get(expected, 0, 0) == 4.0 && Matrix_get(expected, 2, 2) == -2.0);
+
+	Matrix* upper = Matrix_from_1d((f64[]){1, 2, 3, 0, 4, 5, 0, 0, 6}, 3, 3);
+	assert(Matrix_infer_structure(upper) == MATRIX_STRUCTURE_UPPER);
+	Matrix_multiply_into(expected, upper, upper);
+	assert(expected->tags == MATRIX_STRUCTURE_UPPER);
+	Matrix_transpose_into(expected, upper);
+	assert(expected->tags == MATRIX_STRUCTURE_LOWER);
+	assert(Matrix_infer_structure(expected) == MATRIX_STRUCTURE_LOWER);
+	Matrix_add_into(expected, upper, d);
+	assert(expected->tags == MATRIX_STRUCTURE_UPPER);
+	Matrix_add_into(expected, upper, a);
+	assert(expected->tags == 0);
+	Matrix_hadamard_into(expected, upper, d);
+	assert(expected->tags & MATRIX_STRUCTURE_DIAGONAL);
+
+	Matrix* symmetric = Matrix_from_1d((f64[]){1, 2, 0, 2, 0, 3, 0, 3, 5}, 3, 3);
+	assert(Matrix_infer_structure(symmetric) == MATRIX_STRUCTURE_SYMMETRIC);
+	Matrix* t = Matrix_transpose(symmetric);
+	assert(t->data == symmetric->data);
+	Matrix_set(symmetric, 0, 1, 9.0);
+	assert(symmetric->tags == 0 && Matrix_get(t, 0, 1) == 2.0);
+
+	Matrix* zero = Matrix_new(3, 3);
+	assert(Matrix_structure(zero) & MATRIX_STRUCTURE_ZERO);
+	Matrix_multiply_into(expected, a, zero);
+	assert(expected->data[0].val == 0 && expected->data[0].col == 3);
+
+	// elements written directly drop the tags, so the fast paths do not see a stale identity
+	Matrix* edited = Matrix_identity(3);
+	edited->data[1].val = 5;
+	Matrix_rebuild(edited);
+	assert(edited->tags == 0);
+	Matrix_multiply_into(expected, edited, a);
+	assert(Matrix_get(expected, 0, 0) == 5.0 && Matrix_get(expected, 1, 0) == 4.0);
+	Matrix_exp_into(expected, edited, 2);
+	assert(Matrix_get(expected, 0, 0) == 25.0 && Matrix_get(expected, 2, 2) == 1.0);
+	Matrix_transpose_into(expected, edited);
+	assert(Matrix_get(expected, 0, 0) == 5.0);
+	Matrix_free(edited);
+
+	Matrix_free(zero);
+	Matrix_free(t);
+	Matrix_free(symmetric);
+	Matrix_free(upper);
+	Matrix_free(twice);
+	Matrix_free(cube);
+	Matrix_free(right);
+	Matrix_free(expected);
+	Matrix_free(left);
+	Matrix_free(plain);
+	Matrix_free(d);
+	Matrix_free(copy);
+	Matrix_free(a);
+	Matrix_free(id);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+#include "trace.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_SLOTS 256
+
+typedef struct TraceEntry {
+	const char*		 op;
+	MatrixTraceStats stats;
+} TraceEntry;
+
+static TraceEntry	   trace_entries[TRACE_SLOTS] = {{"(untraced)", {0, 0, 0, 0, 0}}};
+static u32			   trace_count = 1;
+static i64			   trace_live = 0;
+static i64			   trace_peak = 0;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool			   trace_enabled = false;
+
+static _Thread_local TraceEntry* thread_entry;
+static _Thread_local i64		 thread_live;
+static _Thread_local i64		 thread_high;
+
+static TraceEntry* trace_find(const char* op) {
+	for (u32 i = 0; i < trace_count; ++i) {
+		if (trace_entries[i].op == op || strcmp(trace_entries[i].op, op) == 0) {
+			return &trace_entries[i];
+		}
+	}
+	return NULL;
+}
+
+static void trace_account(i64 bytes, bool alloc, bool realloc) {
+	pthread_mutex_lock(&trace_lock);
+	TraceEntry* entry = thread_entry ? thread_entry : &trace_entries[0];
+	entry->stats.allocs += alloc;
+	entry->stats.reallocs += realloc;
+	entry->stats.bytes += bytes > 0 ? (u64)bytes : 0;
+	trace_live += bytes;
+	trace_peak = trace_live > trace_peak ? trace_live : trace_peak;
+	pthread_mutex_unlock(&trace_lock);
+
+	thread_live += bytes;
+	thread_high = thread_live > thread_high ? thread_live : thread_high;
+}
+
+MatrixTraceFrame matrix_trace_enter(const char* op) {
+	MatrixTraceFrame frame = {thread_entry, thread_live};
+	if (thread_entry) {
+		return frame;
+	}
+	__atomic_store_n(&trace_enabled, true, __ATOMIC_RELAXED);
+	pthread_mutex_lock(&trace_lock);
+	TraceEntry* entry = trace_find(op);
+	if (entry == NULL) {
+		entry = trace_count < TRACE_SLOTS ? &trace_entries[trace_count++] : &trace_entries[0];
+		if (entry != &trace_entries[0]) {
+			*entry = (TraceEntry){op, {0, 0, 0, 0, 0}};
+		}
+	}
+	++entry->stats.calls;
+	pthread_mutex_unlock(&trace_lock);
+	thread_entry = entry;
+	thread_high = thread_live;
+	return frame;
+}
+
+void matrix_trace_leave(MatrixTraceFrame* frame) {
+	if (frame->previous || thread_entry == NULL) {
+		return;
+	}
+	u64 peak = (u64)(thread_high - frame->live);
+	pthread_mutex_lock(&trace_lock);
+	thread_entry->stats.peak = peak > thread_entry->stats.peak ? peak : thread_entry->stats.peak;
+	pthread_mutex_unlock(&trace_lock);
+	thread_entry = NULL;
+}
+
+void matrix_trace_alloc(u64 bytes) { trace_account((i64)bytes, true, false); }
+
+void matrix_trace_release(u64 bytes) { trace_account(-(i64)bytes, false, false); }
+
+void matrix_trace_resize(u64 from, u64 to) { trace_account((i64)to - (i64)from, false, true); }
+
+void* matrix_trace_current() { return thread_entry; }
+
+void* matrix_trace_adopt(void* entry) {
+	TraceEntry* previous = thread_entry;
+	thread_entry = entry;
+	return previous;
+}
+
+bool matrix_trace_enabled() { return __atomic_load_n(&trace_enabled, __ATOMIC_RELAXED); }
+
+bool matrix_trace_get(const char* op, MatrixTraceStats* stats) {
+	pthread_mutex_lock(&trace_lock);
+	TraceEntry* entry = trace_find(op);
+	if (entry) {
+		*stats = entry->stats;
+	}
+	pthread_mutex_unlock(&trace_lock);
+	return entry != NULL;
+}
+
+u64 matrix_trace_live() { return trace_live > 0 ? (u64)trace_live : 0; }
+
+u64 matrix_trace_peak() { return (u64)trace_peak; }
+
+static int trace_compare(const void* a, const void* b) {
+	u64 x = ((const TraceEntry*)a)->stats.bytes, y = ((const TraceEntry*)b)->stats.bytes;
+	return (x < y) - (x > y);
+}
+
+void matrix_trace_dump(FILE* file) {
+	TraceEntry entries[TRACE_SLOTS];
+	pthread_mutex_lock(&trace_lock);
+	u32 count = trace_count;
+	i64 live = trace_live, peak = trace_peak;
+	memcpy(entries, trace_entries, sizeof(TraceEntry) * count);
+	pthread_mutex_unlock(&trace_lock);
+
+	qsort(entries, count, sizeof(TraceEntry), trace_compare);
+	fprintf(file, "%-40s %10s %10s %10s %14s %14s\n", "operation", "calls", "allocs", "reallocs",
+			"bytes", "peak");
+	for (u32 i = 0; i < count; ++i) {
+		MatrixTraceStats s = entries[i].stats;
+		if (s.calls == 0 && s.allocs == 0 && s.reallocs == 0) {
+			continue;
+		}
+		fprintf(file, "%-40s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %14" PRIu64 " %14" PRIu64,
+				entries[i].op, s.calls, s.allocs, s.reallocs, s.bytes, s.peak);
+		fprintf(file, "\n");
+	}
+	fprintf(file, "live %" PRIi64 " bytes, peak %" PRIi64 " bytes\n", live, peak);
+}
+
+void matrix_trace_reset() {
+	pthread_mutex_lock(&trace_lock);
+	for (u32 i = 0; i < trace_count; ++i) {
+		trace_entries[i].stats = (MatrixTraceStats){0, 0, 0, 0, 0};
+	}
+	trace_peak = trace_live;
+	pthread_mutex_unlock(&trace_lock);
+}
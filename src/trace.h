@@ -0,0 +1,110 @@
+/**
+ * @file trace.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Memory accounting of matrices and per-operation allocation tracing.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include "oxidation.h"
+
+/**
+ * @brief The memory of one matrix. `used` and `capacity` count the bytes of its element storage
+ * that hold elements and that are allocated, `slack` is the difference. `overhead` counts the
+ * struct and the name. `shared` is set when the storage is shared with a clone, in which case it
+ * is accounted to every matrix sharing it.
+ */
+typedef struct MatrixMemory {
+	u64	 used;
+	u64	 capacity;
+	u64	 slack;
+	u64	 overhead;
+	u32	 reallocs;
+	bool shared;
+} MatrixMemory;
+
+/**
+ * @brief Allocation statistics of one operation, such as `MyMatrix_multiply`. Allocations are
+ * accounted to the outermost traced operation running on the calling thread. `peak` is the most
+ * bytes a single call held at once on top of what was live when it started.
+ */
+typedef struct MatrixTraceStats {
+	u64 calls;
+	u64 allocs;
+	u64 reallocs;
+	u64 bytes;
+	u64 peak;
+} MatrixTraceStats;
+
+/**
+ * @brief Define `MATRIX_TRACE` before including `matrix.h` to record the allocations of every
+ * generated operation. Without it the hooks compile to nothing.
+ */
+#ifdef MATRIX_TRACE
+#define MATRIX_TRACE_SCOPE()                                                                       \
+	MatrixTraceFrame _matrix_trace_frame __attribute__((cleanup(matrix_trace_leave))) =           \
+		matrix_trace_enter(__func__)
+#define MATRIX_TRACE_ALLOC(_bytes) matrix_trace_alloc(_bytes)
+#define MATRIX_TRACE_RELEASE(_bytes) matrix_trace_release(_bytes)
+#define MATRIX_TRACE_RESIZE(_from, _to) matrix_trace_resize(_from, _to)
+#else
+#define MATRIX_TRACE_SCOPE() ((void)0)
+#define MATRIX_TRACE_ALLOC(_bytes) ((void)0)
+#define MATRIX_TRACE_RELEASE(_bytes) ((void)0)
+#define MATRIX_TRACE_RESIZE(_from, _to) ((void)0)
+#endif
+
+typedef struct MatrixTraceFrame {
+	void* previous;
+	i64	  live;
+} MatrixTraceFrame;
+
+MatrixTraceFrame matrix_trace_enter(const char* op);
+void			 matrix_trace_leave(MatrixTraceFrame* frame);
+void			 matrix_trace_alloc(u64 bytes);
+void			 matrix_trace_release(u64 bytes);
+void			 matrix_trace_resize(u64 from, u64 to);
+
+/**
+ * @brief The operation the calling thread accounts its allocations to, or NULL. `parallel_for`
+ * and `parallel_spawn` hand it to the pool threads that run their tasks.
+ */
+void* matrix_trace_current();
+
+/**
+ * @brief Account the allocations of the calling thread to `entry`, a value returned by
+ * `matrix_trace_current`. Returns the previous one, to be restored afterwards.
+ */
+void* matrix_trace_adopt(void* entry);
+
+/**
+ * @brief Whether an operation was ever traced in the process. Library code compiled without
+ * `MATRIX_TRACE`, such as the scratch cache, only accounts its memory from then on.
+ */
+bool matrix_trace_enabled();
+
+/**
+ * @brief Copy the statistics of `op` into `stats`. Returns false if `op` was never traced.
+ */
+bool matrix_trace_get(const char* op, MatrixTraceStats* stats);
+
+/**
+ * @brief Bytes of matrix memory currently live, and the most that ever was, in the process.
+ */
+u64 matrix_trace_live();
+u64 matrix_trace_peak();
+
+/**
+ * @brief Print a table of every traced operation, sorted by the bytes they allocated.
+ */
+void matrix_trace_dump(FILE* file);
+
+/**
+ * @brief Forget every statistic. The live bytes are kept, since that memory is still allocated.
+ */
+void matrix_trace_reset();
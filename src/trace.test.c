@@ -0,0 +1,90 @@
+#define MATRIX_TRACE
+
+#include "trace.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+int main() {
+	Matrix*		 m = Matrix_new(100, 100);
+	MatrixMemory memory = Matrix_memory(m);
+	assert(memory.used == sizeof(MatrixElement) && memory.capacity == 2 * sizeof(MatrixElement));
+	assert(memory.reallocs == 0 && !memory.shared);
+	for (u32 i = 0; i < 100; ++i) {
+		Matrix_set(m, i, (i * 7) % 100, i + 1);
+	}
+	memory = Matrix_memory(m);
+	assert(memory.used == 101 * sizeof(MatrixElement));
+	assert(memory.capacity == 128 * sizeof(MatrixElement));
+	assert(memory.slack == 27 * sizeof(MatrixElement) && memory.reallocs == 6);
+	assert(memory.overhead == sizeof(Matrix));
+	Matrix_rename(m, "a name too long to be stored inline");
+	assert(Matrix_memory(m).overhead == sizeof(Matrix) + strlen(m->name) + 1);
+
+	Matrix* c = Matrix_clone(m);
+	assert(Matrix_memory(c).shared && Matrix_memory(m).shared);
+	Matrix_set(c, 0, 0, 5);
+	assert(!Matrix_memory(m).shared && Matrix_memory(c).reallocs == 1);
+	Matrix_free(c);
+
+	scratch_trim();
+	matrix_trace_reset();
+	u64		live = matrix_trace_live();
+	Matrix* p = Matrix_multiply(m, m);
+	Matrix* e = Matrix_exp(m, 5);
+
+	MatrixTraceStats stats;
+	assert(matrix_trace_get("Matrix_multiply", &stats));
+	assert(stats.calls == 1 && stats.allocs == 6 && stats.bytes > 0 && stats.peak > 0);
+	assert(matrix_trace_get("Matrix_exp", &stats));
+	assert(stats.calls == 1 && stats.allocs > 3 && stats.peak >= stats.bytes / 4);
+	assert(matrix_trace_get("Matrix_new", &stats) && stats.calls == 0);
+	assert(matrix_trace_live() > live && matrix_trace_peak() >= matrix_trace_live());
+
+	// the workspaces stay live in the scratch cache until it is trimmed
+	Matrix_free(e);
+	Matrix_free(p);
+	assert(matrix_trace_live() > live);
+	scratch_trim();
+	assert(matrix_trace_live() == live);
+
+
+	FILE* file = tmpfile();
+	matrix_trace_dump(file);
+	rewind(file);
+	char line[256];
+	bool found = false;
+	while (fgets(line, sizeof(line), file)) {
+		found |= strncmp(line, "Matrix_exp ", 11) == 0;
+	}
+	fclose(file);
+	assert(found);
+
+	// pieces run by the pool threads are accounted to the operation that started them
+	parallel_set_threads(4);
+	Matrix* big = Matrix_new(2000, 2000);
+	Matrix_reserve(big, 40000);
+	for (u32 i = 0; i < 40000; ++i) {
+		big->data[i + 1] = (MatrixElement){i / 20, (i * 37) % 2000, 1.0};
+	}
+	big->data[0].val = 40000;
+	Matrix_rebuild_merge(big);
+	matrix_trace_reset();
+	Matrix* square = Matrix_multiply(big, big);
+	assert(matrix_trace_get("(untraced)", &stats) && stats.allocs == 0);
+	assert(matrix_trace_get("Matrix_multiply", &stats) && stats.allocs > 6);
+	Matrix_free(square);
+	Matrix_free(big);
+	parallel_set_threads(0);
+
+	Matrix_free(m);
+
+	return EXIT_SUCCESS;
+}
@@ -1,10 +1,161 @@
 #include "utils.h"
 
+#include <pthread.h>
+#include <stddef.h>
+
+#include "trace.h"
+
+#define SCRATCH_SLOTS 16
+
+typedef union {
+	struct {
+		u64					   capacity;
+		const MatrixAllocator* allocator;
+		bool				   arena;
+		bool				   traced;
+	};
+	max_align_t align;
+} ScratchHeader;
+
+typedef struct {
+	ScratchHeader* block[SCRATCH_SLOTS];
+	u32			   count;
+	u64			   held;
+} ScratchCache;
+
+static _Thread_local ScratchCache scratch_cache;
+static pthread_key_t			  scratch_key;
+static pthread_once_t			  scratch_once = PTHREAD_ONCE_INIT;
+
+static _Thread_local u64  random_state;
+static _Thread_local bool random_seeded;
+static u64				  random_streams;
+
+// a cached block stays accounted as live until it is released
+static void scratch_drop(ScratchHeader* block) {
+	if (block->traced) {
+		matrix_trace_release(sizeof(ScratchHeader) + block->capacity);
+	}
+	matrix_release(block->allocator, block);
+}
+
+static void scratch_release(void* arg) {
+	ScratchCache* cache = arg;
+	for (u32 i = 0; i < cache->count; ++i) {
+		scratch_drop(cache->block[i]);
+	}
+	cache->count = 0;
+	cache->held = 0;
+}
+
+static void scratch_init() { pthread_key_create(&scratch_key, scratch_release); }
+
 char* random_name(u32 length) {
 	char* str = malloc(sizeof(char) * (length + 1));
+	random_fill(str, length);
+	return str;
+}
+
+void random_seed(u64 seed) {
+	random_state = seed;
+	random_seeded = true;
+}
+
+static u64 random_next() {
+	if (!random_seeded) {
+		random_seed(__atomic_add_fetch(&random_streams, 1, __ATOMIC_RELAXED) * 0xD1B54A32D192ED03);
+	}
+	u64 z = (random_state += 0x9E3779B97F4A7C15);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+	return z ^ (z >> 31);
+}
+
+void random_fill(char* str, u32 length) {
+	u64 bits = 0;
 	for (u32 i = 0; i < length; ++i) {
-		str[i] = (char)(rand() % 26 + 97);
+		if (i % 8 == 0) {
+			bits = random_next();
+		}
+		str[i] = (char)((bits & 0xFF) % 26 + 97);
+		bits >>= 8;
 	}
 	str[length] = '\0';
-	return str;
 }
+
+void* scratch_alloc(u64 bytes) {
+	MatrixArena* arena = matrix_arena_current();
+	if (arena) {
+		const MatrixAllocator* allocator = matrix_arena_allocator(arena);
+		ScratchHeader*		   block = matrix_alloc(allocator, sizeof(ScratchHeader) + bytes);
+		block->capacity = bytes;
+		block->allocator = allocator;
+		block->arena = true;
+		block->traced = false;
+		return block + 1;
+	}
+
+	ScratchCache* cache = &scratch_cache;
+	u32			  best = SCRATCH_SLOTS;
+	for (u32 i = 0; i < cache->count; ++i) {
+		if (cache->block[i]->capacity >= bytes &&
+			(best == SCRATCH_SLOTS || cache->block[i]->capacity < cache->block[best]->capacity)) {
+			best = i;
+		}
+	}
+	if (best != SCRATCH_SLOTS) {
+		ScratchHeader* block = cache->block[best];
+		cache->block[best] = cache->block[--cache->count];
+		cache->held -= block->capacity;
+		return block + 1;
+	}
+
+	pthread_once(&scratch_once, scratch_init);
+	pthread_setspecific(scratch_key, cache);
+	const MatrixAllocator* allocator = matrix_allocator_get();
+	ScratchHeader*		   block = matrix_alloc(allocator, sizeof(ScratchHeader) + bytes);
+	block->capacity = bytes;
+	block->allocator = allocator;
+	block->arena = false;
+	block->traced = matrix_trace_enabled();
+	if (block->traced) {
+		matrix_trace_alloc(sizeof(ScratchHeader) + bytes);
+	}
+	return block + 1;
+}
+
+void scratch_free(void* ptr) {
+	if (ptr == NULL) {
+		return;
+	}
+	ScratchCache*  cache = &scratch_cache;
+	ScratchHeader* block = (ScratchHeader*)ptr - 1;
+	if (block->arena) {
+		return;
+	}
+	if (block->capacity > MATRIX_SCRATCH_LIMIT) {
+		scratch_drop(block);
+		return;
+	}
+
+	/* make room by dropping the smallest blocks, as long as they are smaller than this one */
+	while (cache->count == SCRATCH_SLOTS || cache->held + block->capacity > MATRIX_SCRATCH_LIMIT) {
+		u32 smallest = 0;
+		for (u32 i = 1; i < cache->count; ++i) {
+			if (cache->block[i]->capacity < cache->block[smallest]->capacity) {
+				smallest = i;
+			}
+		}
+		if (cache->count == 0 || cache->block[smallest]->capacity >= block->capacity) {
+			scratch_drop(block);
+			return;
+		}
+		cache->held -= cache->block[smallest]->capacity;
+		scratch_drop(cache->block[smallest]);
+		cache->block[smallest] = cache->block[--cache->count];
+	}
+	cache->block[cache->count++] = block;
+	cache->held += block->capacity;
+}
+
+void scratch_trim() { scratch_release(&scratch_cache); }
@@ -9,6 +9,45 @@
 
 #pragma once
 
+#include "allocator.h"
 #include "oxidation.h"
 
 char* random_name(u32 length);
+
+/**
+ * @brief Write `length` random lowercase letters and a terminator into `str`. Every thread draws
+ * from its own generator, so this takes no lock and does not touch the state of `rand`.
+ */
+void random_fill(char* str, u32 length);
+
+/**
+ * @brief Seed the generator of the calling thread, which is otherwise seeded per thread.
+ */
+void random_seed(u64 seed);
+
+/**
+ * @brief Bytes of returned scratch buffers each thread keeps for reuse. A buffer that would push
+ * the cache over the limit goes back to the allocator once no smaller cached buffer can make room.
+ */
+#ifndef MATRIX_SCRATCH_LIMIT
+#define MATRIX_SCRATCH_LIMIT ((u64)64 << 20)
+#endif
+
+/**
+ * @brief Get a temporary buffer of at least `bytes` bytes from the calling thread's scratch cache,
+ * or from the process-wide allocator when none is large enough. The content is uninitialized.
+ * Give it back with `scratch_free` so the next kernel can reuse it. Inside `matrix_arena_begin`,
+ * the buffer comes from the arena instead.
+ */
+void* scratch_alloc(u64 bytes);
+
+/**
+ * @brief Return a buffer obtained from `scratch_alloc` to the calling thread's scratch cache.
+ */
+void scratch_free(void* ptr);
+
+/**
+ * @brief Release every buffer held by the calling thread's scratch cache, for example after a
+ * large computation that will not run again.
+ */
+void scratch_trim();
@@ -1,15 +1,76 @@
 #include "utils.h"
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "fixture.test.h"
+
+static void* draw(void* arg) {
+	char* name = arg;
+	for (u32 i = 0; i < 1000; ++i) {
+		random_fill(name, 8);
+	}
+	return NULL;
+}
+
 int main() {
-	srand(1481);
+	random_seed(1481);
 
 	char* name = random_name(4);
-	assert(strcmp(name, "ptyz") == 0);
+	assert(strcmp(name, "olxw") == 0);
+	free(name);
+
+	srand(1481);
+	int expected = rand();
+	srand(1481);
+	char buffer[20];
+	random_fill(buffer, 19);
+	assert(strlen(buffer) == 19 && rand() == expected);
+	for (u32 i = 0; i < 19; ++i) {
+		assert(buffer[i] >= 'a' && buffer[i] <= 'z');
+	}
+
+	pthread_t threads[4];
+	char	  names[4][9];
+	for (u32 i = 0; i < 4; ++i) {
+		pthread_create(&threads[i], NULL, draw, names[i]);
+	}
+	for (u32 i = 0; i < 4; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+	assert(strcmp(names[0], names[1]) != 0 && strlen(names[3]) == 8);
+
+	Counter			counter = {0, 0};
+	MatrixAllocator counting = counting_allocator(&counter);
+	scratch_trim();
+	matrix_allocator_set(&counting);
+	void* small = scratch_alloc(1000);
+	scratch_free(small);
+	assert(scratch_alloc(500) == small);
+	scratch_free(small);
+	assert(counter.allocs == 1 && counter.releases == 0);
+
+	// a buffer over the limit is released at once instead of being kept by the cache
+	void* large = scratch_alloc(MATRIX_SCRATCH_LIMIT + 1);
+	scratch_free(large);
+	assert(counter.allocs == 2 && counter.releases == 1);
+
+	// smaller cached buffers make room first, then a buffer that still does not fit is released
+	void* half = scratch_alloc(MATRIX_SCRATCH_LIMIT / 2 + 1);
+	void* other = scratch_alloc(MATRIX_SCRATCH_LIMIT / 2 + 1);
+	scratch_free(half);
+	scratch_free(other);
+	assert(counter.allocs == 4 && counter.releases == 3);
+	void* kept = scratch_alloc(100);
+	assert(kept == half);
+	scratch_free(kept);
+
+	scratch_trim();
+	assert(counter.releases == counter.allocs);
+	matrix_allocator_set(NULL);
 
 	return EXIT_SUCCESS;
 }
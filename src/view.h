@@ -0,0 +1,275 @@
+/**
+ * @file view.h
+ * @author Jacob Lin (hi@jacoblin.cool)
+ * @brief Read-only views of row ranges, scaled and transposed matrices.
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022 Jacob Lin. Released under the MIT license.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "buffer.h"
+#include "oxidation.h"
+#include "reduce.h"
+#include "trace.h"
+#include "utils.h"
+
+/**
+ * @brief A view reads `count` elements of `parent`, starting at `begin`. A transposed view reads
+ * them through `order`, the positions of the parent elements sorted by column, which is built on
+ * the first read and shared by every view derived from it. `offset` is subtracted from the rows
+ * and `scale` multiplies the values. The parent must not change while a view of it is in use.
+ */
+#define MATRIX_VIEW_STRUCT(_name, _data_type, _index_type)                                         \
+	typedef struct _name##View {                                                                   \
+		_name*		parent;                                                                        \
+		u64			begin;                                                                         \
+		u64			count;                                                                         \
+		_index_type offset;                                                                        \
+		_index_type row;                                                                           \
+		_index_type col;                                                                           \
+		_data_type	scale;                                                                         \
+		bool		transposed;                                                                    \
+		u64*		order;                                                                         \
+	} _name##View;
+
+#define MATRIX_VIEW_METHOD(_name, _data_type, _index_type)                                         \
+	static void _name##View_index(_name##View* v) {                                                \
+		if (!v->transposed || v->order) {                                                          \
+			return;                                                                                \
+		}                                                                                          \
+		const _name##Element* e = v->parent->data + 1;                                             \
+		u64					  n = v->parent->data[0].val;                                          \
+		_index_type			  cols = v->parent->data[0].col;                                       \
+		u64*				  pos = scratch_alloc(sizeof(u64) * ((u64)cols + 1));                  \
+		memset(pos, 0, sizeof(u64) * ((u64)cols + 1));                                             \
+		for (u64 i = 0; i < n; ++i) {                                                              \
+			++pos[e[i].col + 1];                                                                   \
+		}                                                                                          \
+		for (_index_type c = 0; c < cols; ++c) {                                                   \
+			pos[c + 1] += pos[c];                                                                  \
+		}                                                                                          \
+		/* a buffer remembers its allocator, so the index is released where it came from even if   \
+		 * the allocator changed since */                                                          \
+		v->order = buffer_alloc(matrix_allocator_resolve(_name##_hook), sizeof(u64) * (n + 1));    \
+		for (u64 i = 0; i < n; ++i) {                                                              \
+			v->order[pos[e[i].col]++] = i;                                                         \
+		}                                                                                          \
+		scratch_free(pos);                                                                         \
+	}                                                                                              \
+                                                                                                   \
+	static inline _name##Element _name##View_element(const _name##View* v, u64 i) {                \
+		_name##Element x;                                                                          \
+		if (v->transposed) {                                                                       \
+			_name##Element p = v->parent->data[v->order[v->begin + i] + 1];                        \
+			x = (_name##Element){p.col, p.row, p.val};                                             \
+		} else {                                                                                   \
+			x = v->parent->data[v->begin + i + 1];                                                 \
+		}                                                                                          \
+		x.row -= v->offset;                                                                        \
+		x.val *= v->scale;                                                                         \
+		return x;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##View_lower(const _name##View* v, _index_type row, _index_type col) {         \
+		_name##Element key = {row, col, 0};                                                        \
+		u64			   lo = 0, hi = v->count;                                                      \
+		while (lo < hi) {                                                                          \
+			u64			   mid = lo + (hi - lo) / 2;                                               \
+			_name##Element x = _name##View_element(v, mid);                                        \
+			if (_name##_kernel_less(&x, &key)) {                                                   \
+				lo = mid + 1;                                                                      \
+			} else {                                                                               \
+				hi = mid;                                                                          \
+			}                                                                                      \
+		}                                                                                          \
+		return lo;                                                                                 \
+	}                                                                                              \
+                                                                                                   \
+	_name##View _name##View_of(_name* m) {                                                         \
+		return (_name##View){m, 0, m->data[0].val, 0, m->data[0].row, m->data[0].col, 1, false,    \
+							 NULL};                                                                \
+	}                                                                                              \
+                                                                                                   \
+	_name##View _name##View_transposed(_name* m) {                                                 \
+		return (_name##View){m, 0, m->data[0].val, 0, m->data[0].col, m->data[0].row, 1, true,     \
+							 NULL};                                                                \
+	}                                                                                              \
+                                                                                                   \
+	_name##View _name##View_rows(_name##View* v, _index_type r0, _index_type r1) {                 \
+		r1 = r1 < v->row ? r1 : v->row;                                                            \
+		r0 = r0 < r1 ? r0 : r1;                                                                    \
+		_name##View_index(v);                                                                      \
+		u64			lo = _name##View_lower(v, r0, 0), hi = _name##View_lower(v, r1, 0);            \
+		_name##View s = *v;                                                                        \
+		s.begin = v->begin + lo;                                                                   \
+		s.count = hi - lo;                                                                         \
+		s.offset = v->offset + r0;                                                                 \
+		s.row = r1 - r0;                                                                           \
+		return s;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	_name##View _name##View_scaled(_name##View* v, _data_type alpha) {                             \
+		_name##View_index(v);                                                                      \
+		_name##View s = *v;                                                                        \
+		s.scale *= alpha;                                                                          \
+		return s;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##View_free(_name##View* v) {                                                        \
+		buffer_release(v->order);                                                                  \
+		v->order = NULL;                                                                           \
+	}                                                                                              \
+                                                                                                   \
+	u64 _name##View_nnz(_name##View* v) { return v->count; }                                       \
+                                                                                                   \
+	_name##Element _name##View_at(_name##View* v, u64 i) {                                         \
+		_name##View_index(v);                                                                      \
+		return _name##View_element(v, i);                                                          \
+	}                                                                                              \
+                                                                                                   \
+	_data_type _name##View_get(_name##View* v, _index_type row, _index_type col) {                 \
+		_name##View_index(v);                                                                      \
+		u64 i = _name##View_lower(v, row, col);                                                    \
+		if (i < v->count) {                                                                        \
+			_name##Element x = _name##View_element(v, i);                                          \
+			if (x.row == row && x.col == col) {                                                    \
+				return x.val;                                                                      \
+			}                                                                                      \
+		}                                                                                          \
+		return 0;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	_data_type _name##View_sum(_name##View* v) {                                                   \
+		_name##View_index(v);                                                                      \
+		_data_type ans = 0;                                                                        \
+		for (u64 i = 0; i < v->count; ++i) {                                                       \
+			ans += _name##View_element(v, i).val;                                                  \
+		}                                                                                          \
+		return ans;                                                                                \
+	}                                                                                              \
+                                                                                                   \
+	void _name##View_reduce_rows(_name##View* v, MatrixReduce op, _data_type* out) {               \
+		_name##View_index(v);                                                                      \
+		memset(out, 0, sizeof(_data_type) * (u64)v->row);                                          \
+		for (u64 i = 0; i < v->count;) {                                                           \
+			_name##Element x = _name##View_element(v, i);                                          \
+			_index_type	   row = x.row;                                                            \
+			_data_type	   ans = op == MATRIX_REDUCE_MIN || op == MATRIX_REDUCE_MAX ? x.val : 0;   \
+			for (; i < v->count && (x = _name##View_element(v, i)).row == row; ++i) {              \
+				switch (op) {                                                                      \
+					case MATRIX_REDUCE_SUM:                                                        \
+						ans += x.val;                                                              \
+						break;                                                                     \
+					case MATRIX_REDUCE_ABS_SUM:                                                    \
+						ans += x.val < 0 ? -x.val : x.val;                                         \
+						break;                                                                     \
+					case MATRIX_REDUCE_MIN:                                                        \
+						ans = x.val < ans ? x.val : ans;                                           \
+						break;                                                                     \
+					case MATRIX_REDUCE_MAX:                                                        \
+						ans = x.val > ans ? x.val : ans;                                           \
+						break;                                                                     \
+					case MATRIX_REDUCE_COUNT:                                                      \
+						++ans;                                                                     \
+						break;                                                                     \
+				}                                                                                  \
+			}                                                                                      \
+			out[row] = ans;                                                                        \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	void _name##View_materialize_into(_name* out, _name##View* v) {                                \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##View_index(v);                                                                      \
+		_name##_reserve(out, v->count);                                                            \
+		u64 n = 0;                                                                                 \
+		for (u64 i = 0; i < v->count; ++i) {                                                       \
+			_name##Element x = _name##View_element(v, i);                                          \
+			n = _name##_kernel_emit(out->data + 1, n, x.row, x.col, x.val);                        \
+		}                                                                                          \
+		out->data[0] = (_name##Element){v->row, v->col, n};                                        \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##View_materialize(_name##View* v) {                                               \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* m = _name##_new(v->row, v->col);                                                    \
+		_name##View_materialize_into(m, v);                                                        \
+		return m;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	static u64 _name##View_gemm(const _name##View* a, const _name##View* b, _name##Workspace* w,   \
+								u64 limit, bool* overflow, _name##Element* out) {                  \
+		u64 n = 0;                                                                                 \
+		for (u64 i = 0; i < a->count;) {                                                           \
+			_name##Element x = _name##View_element(a, i);                                          \
+			_index_type	   row = x.row;                                                            \
+			u64			   touched = 0;                                                            \
+			++w->stamp;                                                                            \
+			for (; i < a->count && (x = _name##View_element(a, i)).row == row; ++i) {              \
+				for (u64 k = w->ptr[x.col]; k < w->ptr[x.col + 1]; ++k) {                          \
+					_name##Element y = _name##View_element(b, k);                                  \
+					_name##_kernel_accumulate(w, &touched, y.col, x.val * y.val);                  \
+				}                                                                                  \
+			}                                                                                      \
+			if (out && n + touched > limit) {                                                      \
+				out = NULL;                                                                        \
+				*overflow = true;                                                                  \
+			}                                                                                      \
+			n += _name##_kernel_flush_row(w, touched, row, b->col, out ? out + n : NULL);          \
+		}                                                                                          \
+		return n;                                                                                  \
+	}                                                                                              \
+                                                                                                   \
+	void _name##View_multiply_into(_name* out, _name##View* a, _name##View* b) {                   \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name##View_index(a);                                                                      \
+		_name##View_index(b);                                                                      \
+		_name##_detach(out);                                                                       \
+		_name##Workspace w = _name##_workspace_new(a->col, b->col);                                \
+		memset(w.ptr, 0, sizeof(u64) * ((u64)a->col + 1));                                         \
+		for (u64 k = 0; k < b->count; ++k) {                                                       \
+			++w.ptr[_name##View_element(b, k).row + 1];                                            \
+		}                                                                                          \
+		for (_index_type r = 0; r < a->col; ++r) {                                                 \
+			w.ptr[r + 1] += w.ptr[r];                                                              \
+		}                                                                                          \
+                                                                                                   \
+		bool overflow = false;                                                                     \
+		u64 nnz = _name##View_gemm(a, b, &w, ((u64)1 << out->size) - 1, &overflow, out->data + 1); \
+		if (overflow) {                                                                            \
+			_name##_reserve(out, nnz);                                                             \
+			_name##View_gemm(a, b, &w, UINT64_MAX, NULL, out->data + 1);                           \
+		}                                                                                          \
+		out->data[0] = (_name##Element){a->row, b->col, nnz};                                      \
+                                                                                                   \
+		_name##_workspace_free(&w);                                                                \
+	}                                                                                              \
+                                                                                                   \
+	_name* _name##View_multiply(_name##View* a, _name##View* b) {                                  \
+		MATRIX_TRACE_SCOPE();                                                                      \
+		_name* m = _name##_new(a->row, b->col);                                                    \
+		_name##View_multiply_into(m, a, b);                                                        \
+		return m;                                                                                  \
+	}
+
+#define MATRIX_VIEW_METHOD_DECLARE(_name, _data_type, _index_type)                                 \
+	_name##View	   _name##View_of(_name* m);                                                       \
+	_name##View	   _name##View_transposed(_name* m);                                               \
+	_name##View	   _name##View_rows(_name##View* v, _index_type r0, _index_type r1);               \
+	_name##View	   _name##View_scaled(_name##View* v, _data_type alpha);                           \
+	void		   _name##View_free(_name##View* v);                                               \
+	u64			   _name##View_nnz(_name##View* v);                                                \
+	_name##Element _name##View_at(_name##View* v, u64 i);                                          \
+	_data_type	   _name##View_get(_name##View* v, _index_type row, _index_type col);              \
+	_data_type	   _name##View_sum(_name##View* v);                                                \
+	void		   _name##View_reduce_rows(_name##View* v, MatrixReduce op, _data_type* out);      \
+	void		   _name##View_materialize_into(_name* out, _name##View* v);                       \
+	_name*		   _name##View_materialize(_name##View* v);                                        \
+	void		   _name##View_multiply_into(_name* out, _name##View* a, _name##View* b);          \
+	_name*		   _name##View_multiply(_name##View* a, _name##View* b);
@@ -0,0 +1,102 @@
+#include "view.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fixture.test.h"
+#include "matrix.h"
+
+MATRIX_STRUCT(Matrix, f64, u32);
+MATRIX(Matrix, f64, u32);
+
+int main() {
+	srand(1481);
+
+	Matrix*		  m = Matrix_from_1d((f64[]){1, 0, 2, 0, 3, 0, 4, 0, 5, 6, 0, 7}, 4, 3);
+	MatrixView	  all = MatrixView_of(m);
+	MatrixView	  band = MatrixView_rows(&all, 1, 3);
+	MatrixView	  half = MatrixView_scaled(&band, 0.5);
+	MatrixView	  t = MatrixView_transposed(m);
+	MatrixView	  t_band = MatrixView_rows(&t, 2, 3);
+	MatrixElement x = MatrixView_at(&band, 0);
+	assert(x.row == 0 && x.col == 1 && x.val == 3.0);
+	assert(MatrixView_nnz(&band) == 3 && band.row == 2 && band.col == 3);
+	assert(MatrixView_get(&half, 1, 2) == 2.5 && MatrixView_get(&half, 0, 0) == 0.0);
+	assert(MatrixView_sum(&half) == 6.0);
+	assert(t.row == 3 && t.col == 4);
+	assert(MatrixView_get(&t, 2, 3) == 7.0 && MatrixView_get(&t, 0, 1) == 0.0);
+	assert(MatrixView_nnz(&t_band) == 3 && MatrixView_get(&t_band, 0, 2) == 5.0);
+
+	Matrix* dense = MatrixView_materialize(&t);
+	Matrix* expected = Matrix_transpose(m);
+	assert(Matrix_equal(dense, expected));
+	MatrixView_materialize_into(dense, &t_band);
+	assert(dense->data[0].row == 1 && dense->data[0].val == 3);
+	assert(Matrix_get(dense, 0, 3) == 7.0);
+	Matrix_free(expected);
+	Matrix_free(dense);
+	MatrixView_free(&t);
+	Matrix_free(m);
+
+	u32		size = 200;
+	Matrix* big = Matrix_new(size, size);
+	Matrix_reserve(big, size * size);
+	u64 n = 0;
+	for (u32 i = 0; i < size; ++i) {
+		for (u32 j = 0; j < size; ++j) {
+			if (rand() % 10 == 0) {
+				big->data[++n] = (MatrixElement){i, j, rand() % 9 - 4};
+			}
+		}
+	}
+	big->data[0].val = n;
+
+	MatrixView whole = MatrixView_of(big);
+	MatrixView transposed = MatrixView_transposed(big);
+	MatrixView rows = MatrixView_rows(&whole, 50, 120);
+	MatrixView scaled = MatrixView_scaled(&transposed, 2.0);
+	Matrix*	   product = MatrixView_multiply(&rows, &scaled);
+
+	Matrix* slice = Matrix_slice(big, 50, 120, 0, size);
+	Matrix* t_big = Matrix_transpose(big);
+	Matrix_scale_inplace(t_big, 2.0);
+	Matrix* reference = Matrix_multiply(slice, t_big);
+	assert(Matrix_validate(product));
+	assert(Matrix_equal(product, reference));
+
+	f64 view_sums[200], matrix_sums[200];
+	MatrixView_reduce_rows(&transposed, MATRIX_REDUCE_MAX, view_sums);
+	Matrix_reduce_cols(big, MATRIX_REDUCE_MAX, matrix_sums);
+	for (u32 c = 0; c < size; ++c) {
+		assert(view_sums[c] == matrix_sums[c]);
+	}
+	MatrixView_reduce_rows(&rows, MATRIX_REDUCE_SUM, view_sums);
+	Matrix_reduce_rows(slice, MATRIX_REDUCE_SUM, matrix_sums);
+	for (u32 r = 0; r < 70; ++r) {
+		assert(view_sums[r] == matrix_sums[r]);
+	}
+
+	Matrix_free(reference);
+	Matrix_free(t_big);
+	Matrix_free(slice);
+	Matrix_free(product);
+	MatrixView_free(&transposed);
+	Matrix_free(big);
+
+	// the column order of a transposed view comes from the matrix allocator too
+	Counter			counter = {0, 0};
+	MatrixAllocator counting = counting_allocator(&counter);
+	Matrix_use_allocator(&counting);
+	Matrix*	   small = Matrix_identity(4);
+	u64		   before = counting_live(&counter);
+	MatrixView flipped = MatrixView_transposed(small);
+	assert(MatrixView_get(&flipped, 2, 2) == 1.0 && counting_live(&counter) == before + 1);
+	MatrixView_free(&flipped);
+	assert(counting_live(&counter) == before);
+	Matrix_free(small);
+	assert(counting_live(&counter) == 0);
+	Matrix_use_allocator(NULL);
+
+	return EXIT_SUCCESS;
+}